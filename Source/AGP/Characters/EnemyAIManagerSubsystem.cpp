@@ -0,0 +1,507 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyAIManagerSubsystem.h"
+#include "EngineUtils.h"
+#include "PlayerCharacter.h"
+#include "AGP/Pathfinding/PathfindingSubsystem.h"
+#include "Components/BoxComponent.h"
+#include "Perception/PawnSensingComponent.h"
+
+static TAutoConsoleVariable<int32> CVarEnemyAIBatched(
+	TEXT("AGP.EnemyAI.Batched"),
+	0,
+	TEXT("Enemies that begin play while this is on are updated together by the enemy AI manager instead of ticking ")
+	TEXT("themselves. 0 leaves each enemy running its own AI in its tick. Compare the two with ")
+	TEXT("AGP.Pathfinding.BenchmarkEnemyAI before turning this on by default."));
+
+// How close an enemy has to walk past a hiding spot to go and examine it.
+static constexpr float HidingSpotNoticeDistance = 280.0f;
+// How long an enemy spends examining a hiding spot before it hides there.
+static constexpr float ExamineDuration = 5.0f;
+
+void UEnemyAIManagerSubsystem::Deinitialize()
+{
+	for (int32 i = 0; i < Enemies.Num(); i++)
+	{
+		CancelPathRequest(i);
+		StopTrackingPath(i);
+		if (Enemies[i])
+		{
+			Enemies[i]->BatchedAIIndex = INDEX_NONE;
+		}
+	}
+	Enemies.Reset();
+	Super::Deinitialize();
+}
+
+void UEnemyAIManagerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TickEnemies(DeltaTime);
+}
+
+TStatId UEnemyAIManagerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEnemyAIManagerSubsystem, STATGROUP_Tickables);
+}
+
+bool UEnemyAIManagerSubsystem::IsBatchingEnabled()
+{
+	return CVarEnemyAIBatched.GetValueOnGameThread() != 0;
+}
+
+void UEnemyAIManagerSubsystem::RegisterEnemy(AEnemyCharacter* Enemy)
+{
+	if (!Enemy || Enemy->BatchedAIIndex != INDEX_NONE) return;
+
+	if (!bGatheredHidingSpots)
+	{
+		GatherHidingSpots();
+	}
+	if (!PathfindingSubsystem)
+	{
+		PathfindingSubsystem = GetWorld()->GetSubsystem<UPathfindingSubsystem>();
+	}
+
+	Enemy->BatchedAIIndex = Enemies.Num();
+	Enemies.Add(Enemy);
+	SensedPlayers.Add(Enemy->SensedCharacter);
+	States.Add(EEnemyState::Patrol);
+	Locations.Add(Enemy->GetActorLocation());
+	LastGoodLocations.Add(Enemy->GetActorLocation());
+	MoveInputs.Add(FVector::ZeroVector);
+	ExamineTimers.Add(0.0f);
+	TargetSpots.Add(INDEX_NONE);
+	AtSpots.Add(false);
+	PatrolRoutes.AddDefaulted();
+	PendingPathRequests.Add(0);
+	Paths.AddDefaulted();
+	TrackedPathIds.Add(0);
+	AcceptanceRadii.Add(Enemy->PathfindingError);
+	FallThresholds.Add(Enemy->FallThreshold);
+	RespawnLocations.Add(Enemy->RespawnLocation);
+	ExaminedSpots.Add(false, HidingSpots.Num());
+}
+
+void UEnemyAIManagerSubsystem::UnregisterEnemy(AEnemyCharacter* Enemy)
+{
+	if (!Enemy || !Enemies.IsValidIndex(Enemy->BatchedAIIndex) || Enemies[Enemy->BatchedAIIndex] != Enemy) return;
+
+	RemoveEnemyAt(Enemy->BatchedAIIndex);
+	Enemy->BatchedAIIndex = INDEX_NONE;
+}
+
+void UEnemyAIManagerSubsystem::RemoveEnemyAt(int32 Index)
+{
+	CancelPathRequest(Index);
+	StopTrackingPath(Index);
+
+	const int32 LastIndex = Enemies.Num() - 1;
+	const int32 NumSpots = HidingSpots.Num();
+	if (Index != LastIndex)
+	{
+		Enemies[LastIndex]->BatchedAIIndex = Index;
+		for (int32 Spot = 0; Spot < NumSpots; Spot++)
+		{
+			const bool bExamined = ExaminedSpots[LastIndex * NumSpots + Spot];
+			ExaminedSpots[Index * NumSpots + Spot] = bExamined;
+		}
+		// Swap the paths rather than moving them so the removed enemy's allocation goes to the end and is freed there.
+		Swap(Paths[Index], Paths[LastIndex]);
+	}
+	ExaminedSpots.RemoveAt(LastIndex * NumSpots, NumSpots);
+
+	Enemies.RemoveAtSwap(Index, 1, false);
+	SensedPlayers.RemoveAtSwap(Index, 1, false);
+	States.RemoveAtSwap(Index, 1, false);
+	Locations.RemoveAtSwap(Index, 1, false);
+	LastGoodLocations.RemoveAtSwap(Index, 1, false);
+	MoveInputs.RemoveAtSwap(Index, 1, false);
+	ExamineTimers.RemoveAtSwap(Index, 1, false);
+	TargetSpots.RemoveAtSwap(Index, 1, false);
+	AtSpots.RemoveAtSwap(Index, 1);
+	PatrolRoutes.RemoveAtSwap(Index, 1, false);
+	PendingPathRequests.RemoveAtSwap(Index, 1, false);
+	Paths.RemoveAt(LastIndex, 1, false);
+	TrackedPathIds.RemoveAtSwap(Index, 1, false);
+	AcceptanceRadii.RemoveAtSwap(Index, 1, false);
+	FallThresholds.RemoveAtSwap(Index, 1, false);
+	RespawnLocations.RemoveAtSwap(Index, 1, false);
+}
+
+void UEnemyAIManagerSubsystem::SetSensedPlayer(AEnemyCharacter* Enemy, APlayerCharacter* Player)
+{
+	if (Enemy && SensedPlayers.IsValidIndex(Enemy->BatchedAIIndex))
+	{
+		SensedPlayers[Enemy->BatchedAIIndex] = Player;
+	}
+}
+
+void UEnemyAIManagerSubsystem::GatherHidingSpots()
+{
+	bGatheredHidingSpots = true;
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		AActor* CheckActor = *It;
+		if (!CheckActor->ActorHasTag("HideableObject")) continue;
+
+		// Hiding spots don't move, so where to walk to for each of them is worked out once here rather than every tick.
+		HidingSpots.Add(CheckActor);
+		HidingSpotLocations.Add(CheckActor->GetActorLocation());
+		if (const UBoxComponent* BoxCollider = CheckActor->FindComponentByClass<UBoxComponent>())
+		{
+			FVector SpotLocation = BoxCollider->GetComponentLocation();
+			SpotLocation.Z -= 96;  // Adjust if needed to ensure it's at ground level
+			HidingSpotTargets.Add(SpotLocation);
+			HidingSpotHasCollider.Add(true);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("No BoxCollider found for the hiding spot %s."), *CheckActor->GetName())
+			HidingSpotTargets.Add(HidingSpotLocations.Last());
+			HidingSpotHasCollider.Add(false);
+		}
+	}
+	UE_LOG(LogTemp, Log, TEXT("Enemy AI manager found %d hiding spots"), HidingSpots.Num())
+}
+
+int32 UEnemyAIManagerSubsystem::FindNearestHidingSpot(const FVector& Location, float& OutDistance) const
+{
+	int32 NearestSpot = INDEX_NONE;
+	float NearestDistanceSquared = MAX_FLT;
+	for (int32 Spot = 0; Spot < HidingSpotLocations.Num(); Spot++)
+	{
+		const float DistanceSquared = FVector::DistSquared(Location, HidingSpotLocations[Spot]);
+		if (DistanceSquared < NearestDistanceSquared)
+		{
+			NearestDistanceSquared = DistanceSquared;
+			NearestSpot = Spot;
+		}
+	}
+	OutDistance = FMath::Sqrt(NearestDistanceSquared);
+	return NearestSpot;
+}
+
+void UEnemyAIManagerSubsystem::GoToHidingSpot(int32 Index)
+{
+	if (TargetSpots[Index] == INDEX_NONE)
+	{
+		float Distance;
+		TargetSpots[Index] = FindNearestHidingSpot(Locations[Index], Distance);
+		if (TargetSpots[Index] == INDEX_NONE) return;
+	}
+
+	const int32 Spot = TargetSpots[Index];
+	if (!HidingSpotHasCollider[Spot]) return;
+
+	const FVector& SpotLocation = HidingSpotTargets[Spot];
+	MoveInputs[Index] += (SpotLocation - Locations[Index]).GetSafeNormal();
+	if (FVector::Distance(Locations[Index], SpotLocation) < AcceptanceRadii[Index])
+	{
+		AtSpots[Index] = true;
+	}
+}
+
+void UEnemyAIManagerSubsystem::TickEnemies(float DeltaTime)
+{
+	const int32 NumEnemies = Enemies.Num();
+	const int32 NumSpots = HidingSpots.Num();
+	if (NumEnemies == 0) return;
+
+	// Read where every enemy is once, the rest of the phases only look at the copies.
+	for (int32 i = 0; i < NumEnemies; i++)
+	{
+		Locations[i] = Enemies[i]->GetActorLocation();
+		MoveInputs[i] = FVector::ZeroVector;
+	}
+
+	// Enemies that have fallen out of the world go back to their respawn location and start patrolling again. All
+	// they do for the rest of this tick is look for a new path from there.
+	Respawned.Init(false, NumEnemies);
+	Respawns.Reset();
+	for (int32 i = 0; i < NumEnemies; i++)
+	{
+		if (Locations[i].Z < FallThresholds[i])
+		{
+			Respawned[i] = true;
+			Respawns.Add(i);
+			Locations[i] = RespawnLocations[i];
+			States[i] = EEnemyState::Patrol;
+			Paths[i].Reset();
+			PatrolRoutes[i] = FNavigationPatrolRoute();
+			// Any path still being found started from where the enemy fell so it is no use anymore.
+			CancelPathRequest(i);
+			StopTrackingPath(i);
+		}
+	}
+
+	// Forget players the enemies can't see anymore. Only enemies that saw someone need a line of sight check.
+	for (int32 i = 0; i < NumEnemies; i++)
+	{
+		APlayerCharacter*& Player = SensedPlayers[i];
+		if (!Player || Respawned[i]) continue;
+
+		const UPawnSensingComponent* PawnSensingComponent = Enemies[i]->PawnSensingComponent;
+		if (!IsValid(Player) || (PawnSensingComponent && !PawnSensingComponent->HasLineOfSightTo(Player)))
+		{
+			Player = nullptr;
+		}
+	}
+
+	// Hiding and examining enemies are updated before the patrolling ones so that those which only start examining
+	// this tick, or only finish examining this tick, wait until the next one to act on their new state.
+	for (int32 i = 0; i < NumEnemies; i++)
+	{
+		if (States[i] != EEnemyState::Hiding || Respawned[i]) continue;
+
+		GoToHidingSpot(i);
+		Paths[i].Reset();
+	}
+
+	// Enemies walk to the hiding spot they are examining and look at it for a while before hiding in it.
+	for (int32 i = 0; i < NumEnemies; i++)
+	{
+		if (States[i] != EEnemyState::Examine || Respawned[i]) continue;
+
+		if (!AtSpots[i])
+		{
+			GoToHidingSpot(i);
+			continue;
+		}
+
+		ExamineTimers[i] += DeltaTime;
+		if (ExamineTimers[i] >= ExamineDuration)
+		{
+			ExaminedSpots[i * NumSpots + TargetSpots[i]] = true;
+			TargetSpots[i] = INDEX_NONE;
+			ExamineTimers[i] = 0.0f;
+			AtSpots[i] = false;
+			States[i] = EEnemyState::Hiding;
+		}
+	}
+
+	// Patrolling enemies at the end of their path step to the next node of their patrol circuit, joining one at the
+	// nearest node if they aren't on one.
+	PathfindIndices.Reset();
+	Waypoints.Reset();
+	for (int32 i = 0; i < NumEnemies; i++)
+	{
+		if (!PathfindingSubsystem || States[i] != EEnemyState::Patrol || !Paths[i].IsEmpty()
+			|| PendingPathRequests[i] != 0) continue;
+
+		FVector Waypoint;
+		if (PathfindingSubsystem->AdvancePatrol(PatrolRoutes[i], Waypoint)
+			|| PathfindingSubsystem->StartPatrol(Locations[i], PatrolRoutes[i], Waypoint))
+		{
+			PathfindIndices.Add(i);
+			Waypoints.Add(Waypoint);
+		}
+		else
+		{
+			FindRandomPath(i);
+		}
+	}
+
+	// Probe the ground under every patrolling enemy and every new waypoint in one batch of traces.
+	PatrolIndices.Reset();
+	for (int32 i = 0; i < NumEnemies; i++)
+	{
+		if (States[i] == EEnemyState::Patrol && !Respawned[i])
+		{
+			PatrolIndices.Add(i);
+		}
+	}
+	ProbeLocations.Reset();
+	for (const int32 i : PatrolIndices)
+	{
+		ProbeLocations.Add(Locations[i]);
+	}
+	ProbeLocations.Append(Waypoints);
+	if (PathfindingSubsystem)
+	{
+		PathfindingSubsystem->ProbeGround(ProbeLocations, AboveGround);
+	}
+	else
+	{
+		AboveGround.Init(true, ProbeLocations.Num());
+	}
+
+	for (int32 Waypoint = 0; Waypoint < Waypoints.Num(); Waypoint++)
+	{
+		const int32 i = PathfindIndices[Waypoint];
+		if (AboveGround[PatrolIndices.Num() + Waypoint])
+		{
+			Paths[i].Add(Waypoints[Waypoint]);
+		}
+		else
+		{
+			FindRandomPath(i);
+		}
+	}
+
+	// Walk the patrolling enemies along their paths, or back to solid ground if they have stepped off it.
+	for (int32 Patrol = 0; Patrol < PatrolIndices.Num(); Patrol++)
+	{
+		const int32 i = PatrolIndices[Patrol];
+		TArray<FVector>& Path = Paths[i];
+		if (Path.IsEmpty()) continue;
+
+		if (AboveGround[Patrol])
+		{
+			LastGoodLocations[i] = Locations[i];
+			const FVector& NextLocation = Path.Last();
+			MoveInputs[i] += (NextLocation - Locations[i]).GetSafeNormal();
+			if (FVector::Distance(Locations[i], NextLocation) < AcceptanceRadii[i])
+			{
+				// Repairs to a tracked path start from the step the enemy has just reached.
+				if (TrackedPathIds[i] != 0 && Path.Num() > 1)
+				{
+					PathfindingSubsystem->UpdateTrackedPathStart(TrackedPathIds[i], NextLocation);
+				}
+				Path.Pop(false);
+				if (Path.IsEmpty())
+				{
+					StopTrackingPath(i);
+				}
+			}
+		}
+		else
+		{
+			Path.Reset();
+			StopTrackingPath(i);
+			MoveInputs[i] += (LastGoodLocations[i] - Locations[i]).GetSafeNormal();
+			if (FVector::Distance(Locations[i], LastGoodLocations[i]) < AcceptanceRadii[i])
+			{
+				PatrolRoutes[i] = FNavigationPatrolRoute();
+			}
+		}
+	}
+
+	// Patrolling enemies walking past a hiding spot they haven't examined yet go and examine it, as do those that see
+	// a player.
+	for (const int32 i : PatrolIndices)
+	{
+		float Distance;
+		const int32 NearestSpot = FindNearestHidingSpot(Locations[i], Distance);
+		if (NearestSpot != INDEX_NONE && Distance < HidingSpotNoticeDistance)
+		{
+			TargetSpots[i] = NearestSpot;
+			if (!ExaminedSpots[i * NumSpots + NearestSpot])
+			{
+				GoToHidingSpot(i);
+				States[i] = EEnemyState::Examine;
+				PatrolRoutes[i] = FNavigationPatrolRoute();
+				StopTrackingPath(i);
+			}
+		}
+
+		if (SensedPlayers[i])
+		{
+			States[i] = EEnemyState::Examine;
+			Paths[i].Reset();
+			PatrolRoutes[i] = FNavigationPatrolRoute();
+			// The enemy has stopped patrolling, so it has no use for a path that is still being found or repaired.
+			CancelPathRequest(i);
+			StopTrackingPath(i);
+		}
+	}
+
+	// Only now are the actors touched again, to teleport the fallen ones and pass on the movement input.
+	for (const int32 i : Respawns)
+	{
+		Enemies[i]->SetActorLocation(RespawnLocations[i]);
+	}
+	for (int32 i = 0; i < NumEnemies; i++)
+	{
+		if (!MoveInputs[i].IsZero())
+		{
+			Enemies[i]->AddMovementInput(MoveInputs[i]);
+		}
+	}
+}
+
+void UEnemyAIManagerSubsystem::FindRandomPath(int32 Index)
+{
+	// There is no circuit to follow from here, so ask for a path somewhere random and rejoin one at its end. Only one
+	// request is in flight per enemy, and it keeps following whatever path it has until the new one arrives.
+	PatrolRoutes[Index] = FNavigationPatrolRoute();
+	if (PendingPathRequests[Index] != 0) return;
+
+	PendingPathRequests[Index] = PathfindingSubsystem->RequestRandomPath(Locations[Index],
+		FOnPathRequestComplete::CreateUObject(this, &UEnemyAIManagerSubsystem::OnPathFound, MakeWeakObjectPtr(Enemies[Index])));
+}
+
+void UEnemyAIManagerSubsystem::OnPathFound(const TArray<FVector>& Path, TWeakObjectPtr<AEnemyCharacter> Enemy)
+{
+	// The enemy's index may have changed since the request was made, as others were removed.
+	if (!Enemy.IsValid() || !Enemies.IsValidIndex(Enemy->BatchedAIIndex)) return;
+	const int32 Index = Enemy->BatchedAIIndex;
+	PendingPathRequests[Index] = 0;
+
+	// The enemy may have stopped patrolling while the path was being found.
+	if (States[Index] != EEnemyState::Patrol) return;
+
+	SetPath(Index, Path);
+
+	// Keep the path up to date if doors or corridors on it are blocked before the enemy gets to the end. Patrol
+	// circuit steps don't need this as AdvancePatrol refuses blocked connections, but these paths cross many nodes.
+	StopTrackingPath(Index);
+	if (PathfindingSubsystem && !Paths[Index].IsEmpty())
+	{
+		TrackedPathIds[Index] = PathfindingSubsystem->TrackPath(Enemy->GetActorLocation(), Paths[Index][0],
+			FOnPathRequestComplete::CreateUObject(this, &UEnemyAIManagerSubsystem::OnPathRepaired, Enemy));
+	}
+}
+
+void UEnemyAIManagerSubsystem::OnPathRepaired(const TArray<FVector>& Path, TWeakObjectPtr<AEnemyCharacter> Enemy)
+{
+	if (!Enemy.IsValid() || !Enemies.IsValidIndex(Enemy->BatchedAIIndex)) return;
+	const int32 Index = Enemy->BatchedAIIndex;
+	if (States[Index] != EEnemyState::Patrol) return;
+
+	SetPath(Index, Path);
+
+	// The end of the path can't be reached anymore so patrol somewhere else instead.
+	if (Paths[Index].IsEmpty())
+	{
+		StopTrackingPath(Index);
+	}
+}
+
+void UEnemyAIManagerSubsystem::SetPath(int32 Index, const TArray<FVector>& Path)
+{
+	// Copy into the existing path rather than assigning so its allocation is reused from one patrol to the next, and
+	// drop the steps that aren't above solid ground.
+	TArray<FVector>& EnemyPath = Paths[Index];
+	EnemyPath.Reset();
+	if (Path.IsEmpty() || !PathfindingSubsystem) return;
+
+	PathfindingSubsystem->ProbeGround(Path, PathAboveGround);
+	for (int32 Step = 0; Step < Path.Num(); Step++)
+	{
+		if (PathAboveGround[Step])
+		{
+			EnemyPath.Add(Path[Step]);
+		}
+	}
+}
+
+void UEnemyAIManagerSubsystem::CancelPathRequest(int32 Index)
+{
+	if (PathfindingSubsystem && PendingPathRequests[Index] != 0)
+	{
+		PathfindingSubsystem->CancelPathRequest(PendingPathRequests[Index]);
+	}
+	PendingPathRequests[Index] = 0;
+}
+
+void UEnemyAIManagerSubsystem::StopTrackingPath(int32 Index)
+{
+	if (PathfindingSubsystem && TrackedPathIds[Index] != 0)
+	{
+		PathfindingSubsystem->StopTrackingPath(TrackedPathIds[Index]);
+	}
+	TrackedPathIds[Index] = 0;
+}
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnemyCharacter.h"
+#include "AGP/Pathfinding/NavigationPatrolCircuits.h"
+#include "EnemyAIManagerSubsystem.generated.h"
+
+class APlayerCharacter;
+class UPathfindingSubsystem;
+
+/**
+ * Runs the AI of every enemy in one place instead of each AEnemyCharacter ticking its own. The state of the enemies
+ * is kept in parallel arrays indexed by enemy, and each tick runs one phase at a time as a single loop over all of
+ * them: read their locations, check for falls, update sight, probe the ground, scan for hiding spots, run the state
+ * machine, and finally apply the resulting movement input back to the actors. Enemies only register with it when
+ * AGP.EnemyAI.Batched is on as they begin play, in which case their own tick is turned off.
+ */
+UCLASS()
+class AGP_API UEnemyAIManagerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	 * @return true if enemies beginning play should register with the manager rather than tick themselves.
+	 */
+	static bool IsBatchingEnabled();
+
+	/**
+	 * Takes over the AI of an enemy, starting it off patrolling from where it is.
+	 */
+	void RegisterEnemy(AEnemyCharacter* Enemy);
+	void UnregisterEnemy(AEnemyCharacter* Enemy);
+	/**
+	 * Called when an enemy's pawn sensing component sees a player.
+	 */
+	void SetSensedPlayer(AEnemyCharacter* Enemy, APlayerCharacter* Player);
+
+	/**
+	 * Runs one AI update for every registered enemy. Called by Tick.
+	 */
+	void TickEnemies(float DeltaTime);
+
+	int32 GetNumEnemies() const { return Enemies.Num(); }
+
+private:
+
+	// Everything below is indexed by enemy. Removing an enemy moves the last one into its place.
+	UPROPERTY()
+	TArray<AEnemyCharacter*> Enemies;
+	// The player each enemy can see, or nullptr if it can't see one.
+	UPROPERTY()
+	TArray<APlayerCharacter*> SensedPlayers;
+	TArray<EEnemyState> States;
+	TArray<FVector> Locations;
+	// Where each enemy last stood above solid ground, to walk back to if it steps off.
+	TArray<FVector> LastGoodLocations;
+	TArray<FVector> MoveInputs;
+	TArray<float> ExamineTimers;
+	// The hiding spot each enemy is heading to, or INDEX_NONE if it hasn't picked one.
+	TArray<int32> TargetSpots;
+	TBitArray<> AtSpots;
+	TArray<FNavigationPatrolRoute> PatrolRoutes;
+	// The id of each enemy's random path request that is waiting for a result, or 0 if there isn't one.
+	TArray<uint32> PendingPathRequests;
+	// The rest of each enemy's path in reverse order, so the next step is always the last one.
+	TArray<TArray<FVector>> Paths;
+	// The id the pathfinding subsystem is tracking each enemy's random path under, or 0 if it isn't following one.
+	TArray<uint32> TrackedPathIds;
+	// Copied from the actors when they register, as they don't change.
+	TArray<float> AcceptanceRadii;
+	TArray<float> FallThresholds;
+	TArray<FVector> RespawnLocations;
+
+	// Which hiding spots each enemy has examined, one row of NumHidingSpots bits per enemy.
+	TBitArray<> ExaminedSpots;
+
+	// The hiding spots in the world, gathered when the first enemy registers.
+	UPROPERTY()
+	TArray<AActor*> HidingSpots;
+	TArray<FVector> HidingSpotLocations;
+	// Where enemies walk to when examining or hiding at each spot: the middle of its box collider, at ground level.
+	TArray<FVector> HidingSpotTargets;
+	// Whether each hiding spot has a box collider to walk to. Enemies that pick one without stand still in front of it.
+	TBitArray<> HidingSpotHasCollider;
+	bool bGatheredHidingSpots = false;
+
+	UPROPERTY()
+	UPathfindingSubsystem* PathfindingSubsystem = nullptr;
+
+	// Scratch for the phases, kept so the ticks don't allocate.
+	TBitArray<> Respawned;
+	TArray<int32> Respawns;
+	TArray<int32> PathfindIndices;
+	TArray<FVector> Waypoints;
+	TArray<int32> PatrolIndices;
+	TArray<FVector> ProbeLocations;
+	TArray<bool> AboveGround;
+	TArray<bool> PathAboveGround;
+
+	void GatherHidingSpots();
+	void RemoveEnemyAt(int32 Index);
+	/**
+	 * @return The index of the hiding spot nearest to the location, or INDEX_NONE if there are none.
+	 */
+	int32 FindNearestHidingSpot(const FVector& Location, float& OutDistance) const;
+	/**
+	 * Sets the input of an enemy to walk to its target hiding spot, picking the nearest one first if it doesn't have
+	 * one. The same as AEnemyCharacter::GoToHidingSpot.
+	 */
+	void GoToHidingSpot(int32 Index);
+	/**
+	 * Asks the Pathfinding Subsystem for a path somewhere random for a patrolling enemy that can't follow a patrol
+	 * circuit. The path is found asynchronously and handed to OnPathFound.
+	 */
+	void FindRandomPath(int32 Index);
+	/**
+	 * Gives the enemy the path without the steps that aren't above solid ground, if it is still patrolling.
+	 */
+	void OnPathFound(const TArray<FVector>& Path, TWeakObjectPtr<AEnemyCharacter> Enemy);
+	/**
+	 * Swaps in the repaired path after a door or corridor on the enemy's path has been blocked or unblocked. The same
+	 * as AEnemyCharacter::OnPathRepaired.
+	 */
+	void OnPathRepaired(const TArray<FVector>& Path, TWeakObjectPtr<AEnemyCharacter> Enemy);
+	/**
+	 * Copies the steps of the path that are above solid ground into the enemy's path.
+	 */
+	void SetPath(int32 Index, const TArray<FVector>& Path);
+	void CancelPathRequest(int32 Index);
+	void StopTrackingPath(int32 Index);
+};
@@ -3,6 +3,7 @@
 
 #include "EnemyCharacter.h"
 #include "EngineUtils.h"
+#include "EnemyAIManagerSubsystem.h"
 #include "HealthComponent.h"
 #include "PlayerCharacter.h"
 #include "DrawDebugHelpers.h"
@@ -31,19 +32,30 @@ void AEnemyCharacter::BeginPlay()
 	// DO NOTHING IF NOT ON THE SERVER
 	if (GetLocalRole() != ROLE_Authority) return;
 
-	GetHidingSpots();
-	
-	PathfindingSubsystem = GetWorld()->GetSubsystem<UPathfindingSubsystem>();
-	if (PathfindingSubsystem)
+	if (PawnSensingComponent)
 	{
-		CurrentPath = PathfindingSubsystem->GetRandomPath(GetActorLocation());
-	} else
+		PawnSensingComponent->OnSeePawn.AddDynamic(this, &AEnemyCharacter::OnSensedPawn);
+	}
+
+	// Let the enemy AI manager update this enemy along with all the others instead of ticking it by itself.
+	UEnemyAIManagerSubsystem* AIManager = GetWorld()->GetSubsystem<UEnemyAIManagerSubsystem>();
+	if (AIManager && UEnemyAIManagerSubsystem::IsBatchingEnabled())
 	{
-		UE_LOG(LogTemp, Error, TEXT("Unable to find the PathfindingSubsystem"))
+		AIManager->RegisterEnemy(this);
+		SetActorTickEnabled(false);
 	}
-	if (PawnSensingComponent)
+	else
 	{
-		PawnSensingComponent->OnSeePawn.AddDynamic(this, &AEnemyCharacter::OnSensedPawn);
+		GetHidingSpots();
+
+		PathfindingSubsystem = GetWorld()->GetSubsystem<UPathfindingSubsystem>();
+		if (PathfindingSubsystem)
+		{
+			FindNewPath();
+		} else
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unable to find the PathfindingSubsystem"))
+		}
 	}
 
 	if (UHealthComponent* HealthComp = FindComponentByClass<UHealthComponent>())
@@ -54,6 +66,25 @@ void AEnemyCharacter::BeginPlay()
 	
 }
 
+void AEnemyCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (BatchedAIIndex != INDEX_NONE)
+	{
+		if (UEnemyAIManagerSubsystem* AIManager = GetWorld()->GetSubsystem<UEnemyAIManagerSubsystem>())
+		{
+			AIManager->UnregisterEnemy(this);
+		}
+	}
+	if (PathfindingSubsystem && PendingPathRequest != 0)
+	{
+		PathfindingSubsystem->CancelPathRequest(PendingPathRequest);
+		PendingPathRequest = 0;
+	}
+	StopTrackingPath();
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AEnemyCharacter::MoveAlongPath()
 {
 	if (CurrentPath.IsEmpty())
@@ -89,18 +120,27 @@ void AEnemyCharacter::MoveAlongPath()
 		if (FVector::Distance(GetActorLocation(), NextLocation) < PathfindingError)
 		{
 			CurrentPath.Pop();
+			if (CurrentPath.IsEmpty())
+			{
+				StopTrackingPath();
+			}
+			else if (PathfindingSubsystem && TrackedPathId != 0)
+			{
+				PathfindingSubsystem->UpdateTrackedPathStart(TrackedPathId, NextLocation);
+			}
 		}
 	}
 	else
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Not on solid ground. Returning to last known good location."));
-		CurrentPath.Empty();
+		CurrentPath.Reset();
 		FVector ReturnDirection = (LastKnownGoodLocation - GetActorLocation()).GetSafeNormal();
 		AddMovementInput(ReturnDirection);
 
 		if (FVector::Distance(GetActorLocation(), LastKnownGoodLocation) < PathfindingError)
 		{
-			CurrentPath.Empty();
+			CurrentPath.Reset();
+			PatrolRoute = FNavigationPatrolRoute();
 			FindNewPath();
 		}
 	}
@@ -108,16 +148,79 @@ void AEnemyCharacter::MoveAlongPath()
 
 void AEnemyCharacter::FindNewPath()
 {
+	// Only have one request in flight at a time, the current path is followed until the new one arrives.
+	if (!PathfindingSubsystem || PendingPathRequest != 0) return;
+
+	StopTrackingPath();
 	if (CurrentState == EEnemyState::Patrol)
 	{
-		CurrentPath = PathfindingSubsystem->GetRandomPath(GetActorLocation());
+		// Step to the next node of the patrol circuit, joining one at the nearest node if the enemy isn't on one.
+		FVector Waypoint;
+		const bool bOnCircuit = PathfindingSubsystem->AdvancePatrol(PatrolRoute, Waypoint)
+			|| PathfindingSubsystem->StartPatrol(GetActorLocation(), PatrolRoute, Waypoint);
+		if (bOnCircuit && IsLocationAboveSolidGround(Waypoint))
+		{
+			CurrentPath.Reset();
+			CurrentPath.Add(Waypoint);
+			return;
+		}
+
+		// There is no circuit to follow from here, so search for a path somewhere random and rejoin one at its end.
+		PatrolRoute = FNavigationPatrolRoute();
+		PendingPathRequest = PathfindingSubsystem->RequestRandomPath(GetActorLocation(),
+			FOnPathRequestComplete::CreateUObject(this, &AEnemyCharacter::OnPathFound));
 	}
-	
+}
+
+void AEnemyCharacter::OnPathFound(const TArray<FVector>& Path)
+{
+	PendingPathRequest = 0;
+
+	// The enemy may have stopped patrolling while the path was being found.
+	if (CurrentState != EEnemyState::Patrol) return;
+
+	// Copy into the existing path rather than assigning so its allocation is reused from one patrol to the next.
+	CurrentPath.Reset();
+	CurrentPath.Append(Path);
 
 	// Validate and remove points that aren't above solid ground
 	CurrentPath.RemoveAll([this](const FVector& Location) {
 		return !IsLocationAboveSolidGround(Location);
 	});
+
+	// Keep the path up to date if doors or corridors on it are blocked before the enemy gets to the end.
+	StopTrackingPath();
+	if (PathfindingSubsystem && !CurrentPath.IsEmpty())
+	{
+		TrackedPathId = PathfindingSubsystem->TrackPath(GetActorLocation(), CurrentPath[0],
+			FOnPathRequestComplete::CreateUObject(this, &AEnemyCharacter::OnPathRepaired));
+	}
+}
+
+void AEnemyCharacter::OnPathRepaired(const TArray<FVector>& Path)
+{
+	if (CurrentState != EEnemyState::Patrol) return;
+
+	CurrentPath.Reset();
+	CurrentPath.Append(Path);
+	CurrentPath.RemoveAll([this](const FVector& Location) {
+		return !IsLocationAboveSolidGround(Location);
+	});
+
+	// The end of the path can't be reached anymore so patrol somewhere else instead.
+	if (CurrentPath.IsEmpty())
+	{
+		StopTrackingPath();
+	}
+}
+
+void AEnemyCharacter::StopTrackingPath()
+{
+	if (PathfindingSubsystem && TrackedPathId != 0)
+	{
+		PathfindingSubsystem->StopTrackingPath(TrackedPathId);
+	}
+	TrackedPathId = 0;
 }
 
 
@@ -330,6 +433,13 @@ void AEnemyCharacter::OnSensedPawn(APawn* SensedActor)
 	{
 		SensedCharacter = Player;
 		//UE_LOG(LogTemp, Display, TEXT("Sensed Player"))
+		if (BatchedAIIndex != INDEX_NONE)
+		{
+			if (UEnemyAIManagerSubsystem* AIManager = GetWorld()->GetSubsystem<UEnemyAIManagerSubsystem>())
+			{
+				AIManager->SetSensedPlayer(this, Player);
+			}
+		}
 	}
 }
 
@@ -361,8 +471,16 @@ void AEnemyCharacter::Tick(float DeltaTime)
 		
 		// Teleport the enemy to the respawn location and reset their state
 		SetActorLocation(RespawnLocation);
-		CurrentPath.Empty();  // Clear the current path to prevent movement conflicts
+		CurrentPath.Reset();  // Clear the current path to prevent movement conflicts
 		CurrentState = EEnemyState::Patrol;  // Reset state to Patrol
+		if (PathfindingSubsystem && PendingPathRequest != 0)
+		{
+			// Any path still being found started from where the enemy fell so it is no use anymore.
+			PathfindingSubsystem->CancelPathRequest(PendingPathRequest);
+			PendingPathRequest = 0;
+		}
+		StopTrackingPath();
+		PatrolRoute = FNavigationPatrolRoute();
 		FindNewPath();  // Find a new path to start patrolling immediately
 		
 		return;  // Exit early if respawning
@@ -386,6 +504,7 @@ void AEnemyCharacter::Tick(float DeltaTime)
 				UE_LOG(LogTemp, Display, TEXT("Enemy approaching hiding spot for examination."));
 				GoToHidingSpot();
 				CurrentState = EEnemyState::Examine;
+				PatrolRoute = FNavigationPatrolRoute();
 			}
 		}
 
@@ -393,7 +512,8 @@ void AEnemyCharacter::Tick(float DeltaTime)
 		{
 			UE_LOG(LogTemp, Display, TEXT("Enemy senses a character."));
 			CurrentState = EEnemyState::Examine;  // Transition to Examine instead of Engage
-			CurrentPath.Empty();
+			CurrentPath.Reset();
+			PatrolRoute = FNavigationPatrolRoute();
 		}
 		break;
         
@@ -404,7 +524,7 @@ void AEnemyCharacter::Tick(float DeltaTime)
 	case EEnemyState::Hiding:
 		UE_LOG(LogTemp, Display, TEXT("Enemy is in Hiding State."));
 		TickHiding();
-		CurrentPath.Empty();
+		CurrentPath.Reset();
 		break;
 	}
 }
@@ -6,6 +6,7 @@
 #include "GameFramework/Character.h"
 #include "BaseCharacter.h"
 #include "PlayerCharacter.h"
+#include "AGP/Pathfinding/NavigationPatrolCircuits.h"
 #include "EnemyCharacter.generated.h"
 
 // Forward declarations to avoid needing to #include files in the header of this class.
@@ -13,6 +14,7 @@
 class UPawnSensingComponent;
 class APlayerCharacter;
 class UPathfindingSubsystem;
+class UEnemyAIManagerSubsystem;
 
 /**
  * An enum to hold the current state of the enemy character.
@@ -33,6 +35,9 @@ class AGP_API AEnemyCharacter : public ABaseCharacter
 {
 	GENERATED_BODY()
 
+	// Runs the AI of enemies that don't tick themselves, reading and writing their state directly.
+	friend class UEnemyAIManagerSubsystem;
+
 public:
 	// Sets default values for this character's properties
 	AEnemyCharacter();
@@ -40,6 +45,7 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	/**
 	 * Will move the character along the CurrentPath or do nothing to the character if the path is empty.
@@ -148,7 +154,28 @@ private:
 	 */
 	APlayerCharacter* FindPlayer() const;
 
+	/**
+	 * Sets the CurrentPath to the next step of the enemy's patrol circuit. If it can't follow a circuit from where it is,
+	 * asks the Pathfinding Subsystem for a path somewhere random instead. That path is found asynchronously so the enemy
+	 * keeps following its CurrentPath until OnPathFound replaces it.
+	 */
 	void FindNewPath();
+	void OnPathFound(const TArray<FVector>& Path);
+	/**
+	 * Called by the Pathfinding Subsystem when nodes on the way to the end of the CurrentPath have been blocked or
+	 * unblocked and the rest of the path has been repaired.
+	 */
+	void OnPathRepaired(const TArray<FVector>& Path);
+	void StopTrackingPath();
+
+	// Where the enemy is on its patrol circuit. Reset whenever it stops patrolling so it rejoins at the nearest node.
+	FNavigationPatrolRoute PatrolRoute;
+	// The id of the path request that is waiting for a result, or 0 if there isn't one.
+	uint32 PendingPathRequest = 0;
+	// The id of the CurrentPath in the Pathfinding Subsystem's tracked paths, or 0 if it isn't being tracked.
+	uint32 TrackedPathId = 0;
+	// Where this enemy's state is in the enemy AI manager's arrays, or INDEX_NONE if it runs its own AI in Tick.
+	int32 BatchedAIIndex = INDEX_NONE;
 
 	// Respawn location and threshold variables
 	UPROPERTY(EditAnywhere, Category="Respawn")
@@ -18,6 +18,12 @@ ADungeonGenerator::ADungeonGenerator()
 void ADungeonGenerator::BeginPlay()
 {
     Super::BeginPlay();
+
+    // The dungeon was generated in the editor, so give the pathfinding subsystem the nodes it was generated with
+    if (!NavigationNodeLocations.IsEmpty())
+    {
+        RegisterNavigationNodes();
+    }
 }
 
 void ADungeonGenerator::Tick(float DeltaTime)
@@ -27,28 +33,52 @@ void ADungeonGenerator::Tick(float DeltaTime)
 
 void ADungeonGenerator::GenerateDungeon()
 {
-    FMath::RandInit(RandomSeed);
     ClearDungeon();
 
-    TArray<FVector> RoomLocations;
+    FDungeonLayout Layout;
+    MakeLayout(GridSizeX, GridSizeY, RoomSize, RoomTypes, RandomSeed, Layout);
+
+    // Spawn the rooms and the corridors between them
+    for (const TPair<FVector, int32>& Room : Layout.Rooms)
+    {
+        GetWorld()->SpawnActor<AActor>(RoomTypes[Room.Value], Room.Key, FRotator::ZeroRotator);
+    }
+    for (const TPair<FVector, FVector>& Corridor : Layout.Corridors)
+    {
+        CreateCorridorBetweenRooms(Corridor.Key, Corridor.Value);
+    }
+
+    NavigationGrid = MoveTemp(Layout.NavigationGrid);
+    NavigationNodeLocations = MoveTemp(Layout.NodeLocations);
+    NavigationNodeKinds = MoveTemp(Layout.NodeKinds);
+
+    // The level's baked graph is written when the level is saved, not every time the dungeon is generated again
+    RegisterNavigationNodes();
+}
+
+void ADungeonGenerator::MakeLayout(int32 InGridSizeX, int32 InGridSizeY, float InRoomSize,
+    const TArray<TSubclassOf<AActor>>& InRoomTypes, int32 InRandomSeed, FDungeonLayout& OutLayout)
+{
+    FMath::RandInit(InRandomSeed);
+    OutLayout = FDungeonLayout();
+
     TArray<FVector> CorridorLocations;
 
     // Initialize the room grid
     TArray<TArray<int32>> RoomGrid;
-    RoomGrid.SetNum(GridSizeX);
-    for (int32 i = 0; i < GridSizeX; ++i)
+    RoomGrid.SetNum(InGridSizeX);
+    for (int32 i = 0; i < InGridSizeX; ++i)
     {
-        RoomGrid[i].SetNumZeroed(GridSizeY);
+        RoomGrid[i].SetNumZeroed(InGridSizeY);
     }
+    OutLayout.NavigationGrid.Init(InGridSizeX, InGridSizeY, InRoomSize, FVector::ZeroVector);
 
     // Place rooms
-    for (int32 X = 0; X < GridSizeX; X++)
+    for (int32 X = 0; X < InGridSizeX; X++)
     {
-        for (int32 Y = 0; Y < GridSizeY; Y++)
+        for (int32 Y = 0; Y < InGridSizeY; Y++)
         {
-            FVector SpawnLocation = FVector(X * RoomSize, Y * RoomSize, 0);
-            FRotator SpawnRotation = FRotator::ZeroRotator;
-            FActorSpawnParameters SpawnParams;
+            FVector SpawnLocation = FVector(X * InRoomSize, Y * InRoomSize, 0);
 
             bool bCanPlaceRoom = true;
             if (RoomGrid[X][Y] == 0)
@@ -57,10 +87,10 @@ void ADungeonGenerator::GenerateDungeon()
                 TArray<int32> NeighborRoomTypes;
                 if (X > 0) NeighborRoomTypes.Add(RoomGrid[X - 1][Y]);
                 if (Y > 0) NeighborRoomTypes.Add(RoomGrid[X][Y - 1]);
-                if (X < GridSizeX - 1) NeighborRoomTypes.Add(RoomGrid[X + 1][Y]);
-                if (Y < GridSizeY - 1) NeighborRoomTypes.Add(RoomGrid[X][Y + 1]);
+                if (X < InGridSizeX - 1) NeighborRoomTypes.Add(RoomGrid[X + 1][Y]);
+                if (Y < InGridSizeY - 1) NeighborRoomTypes.Add(RoomGrid[X][Y + 1]);
 
-                int32 RandomRoomIndex = FMath::RandRange(0, RoomTypes.Num() - 1);
+                int32 RandomRoomIndex = FMath::RandRange(0, InRoomTypes.Num() - 1);
                 for (int32 NeighborType : NeighborRoomTypes)
                 {
                     if (NeighborType == RandomRoomIndex + 1)
@@ -70,14 +100,14 @@ void ADungeonGenerator::GenerateDungeon()
                     }
                 }
 
-                if (bCanPlaceRoom && RoomTypes.Num() > 0 && FMath::RandRange(0, 100) < 50)
+                if (bCanPlaceRoom && InRoomTypes.Num() > 0 && FMath::RandRange(0, 100) < 50)
                 {
-                    TSubclassOf<AActor> SelectedRoomClass = RoomTypes[RandomRoomIndex];
-                    if (SelectedRoomClass)
+                    if (InRoomTypes[RandomRoomIndex])
                     {
-                        GetWorld()->SpawnActor<AActor>(SelectedRoomClass, SpawnLocation, SpawnRotation, SpawnParams);
-                        RoomLocations.Add(SpawnLocation);
+                        OutLayout.Rooms.Emplace(SpawnLocation, RandomRoomIndex);
+                        OutLayout.NodeLocations.Add(SpawnLocation);
                         RoomGrid[X][Y] = RandomRoomIndex + 1;
+                        OutLayout.NavigationGrid.AddRoom(FIntPoint(X, Y));
                     }
                 }
             }
@@ -85,51 +115,71 @@ void ADungeonGenerator::GenerateDungeon()
     }
 
     // Place corridors and add nodes for each endpoint
-    for (int32 X = 0; X < GridSizeX; X++)
+    for (int32 X = 0; X < InGridSizeX; X++)
     {
-        for (int32 Y = 0; Y < GridSizeY; Y++)
+        for (int32 Y = 0; Y < InGridSizeY; Y++)
         {
             if (RoomGrid[X][Y])
             {
+                // Rooms that touch are walkable between, the same as their navigation nodes
+                if (X < InGridSizeX - 1 && RoomGrid[X + 1][Y]) OutLayout.NavigationGrid.Connect(FIntPoint(X, Y), FIntPoint(X + 1, Y));
+                if (Y < InGridSizeY - 1 && RoomGrid[X][Y + 1]) OutLayout.NavigationGrid.Connect(FIntPoint(X, Y), FIntPoint(X, Y + 1));
+
                 // Check horizontally
-                if (X < GridSizeX - 2 && !RoomGrid[X + 1][Y] && RoomGrid[X + 2][Y])
+                if (X < InGridSizeX - 2 && !RoomGrid[X + 1][Y] && RoomGrid[X + 2][Y])
                 {
-                    FVector RoomA = FVector(X * RoomSize, Y * RoomSize, 0);
-                    FVector RoomB = FVector((X + 2) * RoomSize, Y * RoomSize, 0);
-                    CreateCorridorBetweenRooms(RoomA, RoomB);
+                    FVector RoomA = FVector(X * InRoomSize, Y * InRoomSize, 0);
+                    FVector RoomB = FVector((X + 2) * InRoomSize, Y * InRoomSize, 0);
+                    OutLayout.Corridors.Emplace(RoomA, RoomB);
+                    OutLayout.NavigationGrid.AddCorridor(FIntPoint(X, Y), FIntPoint(X + 2, Y));
                     
                     // Add nodes for corridor ends
-                    CorridorLocations.Add((RoomA + FVector(RoomSize / 2, 0, 0)));
-                    CorridorLocations.Add((RoomB - FVector(RoomSize / 2, 0, 0)));
+                    CorridorLocations.Add((RoomA + FVector(InRoomSize / 2, 0, 0)));
+                    CorridorLocations.Add((RoomB - FVector(InRoomSize / 2, 0, 0)));
                 }
                 // Check vertically
-                if (Y < GridSizeY - 2 && !RoomGrid[X][Y + 1] && RoomGrid[X][Y + 2])
+                if (Y < InGridSizeY - 2 && !RoomGrid[X][Y + 1] && RoomGrid[X][Y + 2])
                 {
-                    FVector RoomA = FVector(X * RoomSize, Y * RoomSize, 0);
-                    FVector RoomB = FVector(X * RoomSize, (Y + 2) * RoomSize, 0);
-                    CreateCorridorBetweenRooms(RoomA, RoomB);
+                    FVector RoomA = FVector(X * InRoomSize, Y * InRoomSize, 0);
+                    FVector RoomB = FVector(X * InRoomSize, (Y + 2) * InRoomSize, 0);
+                    OutLayout.Corridors.Emplace(RoomA, RoomB);
+                    OutLayout.NavigationGrid.AddCorridor(FIntPoint(X, Y), FIntPoint(X, Y + 2));
                     
                     // Add nodes for corridor ends
-                    CorridorLocations.Add((RoomA + FVector(0, RoomSize / 2, 0)));
-                    CorridorLocations.Add((RoomB - FVector(0, RoomSize / 2, 0)));
+                    CorridorLocations.Add((RoomA + FVector(0, InRoomSize / 2, 0)));
+                    CorridorLocations.Add((RoomB - FVector(0, InRoomSize / 2, 0)));
                 }
             }
         }
     }
 
-    // Combine room and corridor locations into a single array for pathfinding
-    TArray<FVector> AllNodeLocations = RoomLocations;
-    AllNodeLocations.Append(CorridorLocations);
+    // Combine room and corridor locations into a single array for pathfinding, along with what each one is
+    const int32 NumRooms = OutLayout.NodeLocations.Num();
+    OutLayout.NodeLocations.Append(CorridorLocations);
+    OutLayout.NodeKinds.Init(ENavigationNodeKind::Room, NumRooms);
+    OutLayout.NodeKinds.AddUninitialized(CorridorLocations.Num());
+    for (int32 i = NumRooms; i < OutLayout.NodeKinds.Num(); i++)
+    {
+        OutLayout.NodeKinds[i] = ENavigationNodeKind::Corridor;
+    }
+}
 
+void ADungeonGenerator::RegisterNavigationNodes() const
+{
     // Update pathfinding nodes with both room and corridor locations
     if (UPathfindingSubsystem* PathfindingSubsystem = GetWorld()->GetSubsystem<UPathfindingSubsystem>())
     {
-        PathfindingSubsystem->UpdatePathfindingNodes(AllNodeLocations, GridSizeX, GridSizeY, RoomSize);
+        PathfindingSubsystem->UpdatePathfindingNodes(NavigationNodeLocations, NavigationNodeKinds, GridSizeX, GridSizeY, RoomSize);
+        PathfindingSubsystem->SetDungeonGrid(NavigationGrid);
     }
 }
 
 void ADungeonGenerator::ClearDungeon()
 {
+    NavigationGrid.Reset();
+    NavigationNodeLocations.Reset();
+    NavigationNodeKinds.Reset();
+
     // Find and destroy all the previously spawned actors of the classes in RoomTypes and corridors
     for (TSubclassOf<AActor> RoomType : RoomTypes)
     {
@@ -2,8 +2,26 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "AGP/Pathfinding/DungeonNavigationGrid.h"
+#include "AGP/Pathfinding/NavigationNode.h"
 #include "DungeonGenerator.generated.h"
 
+// Where everything in a dungeon goes, worked out before anything is spawned
+struct FDungeonLayout
+{
+    // Location of each room and the index of its class in the room types
+    TArray<TPair<FVector, int32>> Rooms;
+
+    // The two rooms each corridor joins
+    TArray<TPair<FVector, FVector>> Corridors;
+
+    // Navigation nodes for the rooms followed by the corridor ends, along with what each one is
+    TArray<FVector> NodeLocations;
+    TArray<ENavigationNodeKind> NodeKinds;
+
+    FDungeonNavigationGrid NavigationGrid;
+};
+
 UCLASS()
 class AGP_API ADungeonGenerator : public AActor
 {
@@ -45,8 +63,28 @@ public:
     UFUNCTION(CallInEditor, Category = "Dungeon Generation")
     void GenerateDungeon();
 
+    // Lays out a dungeon the way GenerateDungeon does without spawning anything, so tests and benchmarks can use the
+    // same dungeons. The room types are only checked for being set
+    static void MakeLayout(int32 InGridSizeX, int32 InGridSizeY, float InRoomSize,
+        const TArray<TSubclassOf<AActor>>& InRoomTypes, int32 InRandomSeed, FDungeonLayout& OutLayout);
+
+    // Occupancy and connectivity of the rooms and corridors of the last generated dungeon
+    const FDungeonNavigationGrid& GetNavigationGrid() const { return NavigationGrid; }
+
 
 private:
+    // The navigation nodes and grid of the last generated dungeon. They only exist as data in the pathfinding subsystem,
+    // so they are saved with the generator and handed to the subsystem again when the level is played
+    UPROPERTY()
+    FDungeonNavigationGrid NavigationGrid;
+
+    UPROPERTY()
+    TArray<FVector> NavigationNodeLocations;
+
+    UPROPERTY()
+    TArray<ENavigationNodeKind> NavigationNodeKinds;
+
+    void RegisterNavigationNodes() const;
     void ClearDungeon();
     void CreateCorridorBetweenRooms(FVector RoomA, FVector RoomB);
 };
\ No newline at end of file
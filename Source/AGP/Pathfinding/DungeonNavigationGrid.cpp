@@ -0,0 +1,172 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DungeonNavigationGrid.h"
+
+void FDungeonNavigationGrid::Init(int32 InWidth, int32 InHeight, float InCellSize, const FVector& InOrigin)
+{
+	Width = FMath::Max(0, InWidth);
+	Height = FMath::Max(0, InHeight);
+	CellSize = InCellSize;
+	Origin = InOrigin;
+	Cells.Reset();
+	Cells.SetNumZeroed(Width * Height);
+}
+
+void FDungeonNavigationGrid::AddRoom(const FIntPoint& Cell)
+{
+	if (IsValidCell(Cell))
+	{
+		Cells[GetCellIndex(Cell)] |= Walkable | Room;
+	}
+}
+
+void FDungeonNavigationGrid::AddCorridor(const FIntPoint& From, const FIntPoint& To)
+{
+	if (!IsValidCell(From) || !IsValidCell(To) || (From.X != To.X && From.Y != To.Y))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Corridors must be straight and inside the grid, ignoring %s to %s"), *From.ToString(), *To.ToString())
+		return;
+	}
+
+	const FIntPoint Step(FMath::Sign(To.X - From.X), FMath::Sign(To.Y - From.Y));
+	Cells[GetCellIndex(From)] |= Walkable;
+	for (FIntPoint Cell = From; Cell != To; Cell += Step)
+	{
+		Cells[GetCellIndex(Cell + Step)] |= Walkable;
+		Connect(Cell, Cell + Step);
+	}
+}
+
+void FDungeonNavigationGrid::Connect(const FIntPoint& A, const FIntPoint& B)
+{
+	if (!IsWalkable(A) || !IsWalkable(B))
+	{
+		return;
+	}
+
+	const FIntPoint Offset = B - A;
+	uint8 SideOfA;
+	uint8 SideOfB;
+	if (Offset == FIntPoint(1, 0)) { SideOfA = OpenEast; SideOfB = OpenWest; }
+	else if (Offset == FIntPoint(-1, 0)) { SideOfA = OpenWest; SideOfB = OpenEast; }
+	else if (Offset == FIntPoint(0, 1)) { SideOfA = OpenNorth; SideOfB = OpenSouth; }
+	else if (Offset == FIntPoint(0, -1)) { SideOfA = OpenSouth; SideOfB = OpenNorth; }
+	else return;
+
+	Cells[GetCellIndex(A)] |= SideOfA;
+	Cells[GetCellIndex(B)] |= SideOfB;
+}
+
+FIntPoint FDungeonNavigationGrid::WorldToCell(const FVector& Location) const
+{
+	if (CellSize <= 0.0f)
+	{
+		return FIntPoint(INDEX_NONE, INDEX_NONE);
+	}
+	return FIntPoint(FMath::RoundToInt32((Location.X - Origin.X) / CellSize), FMath::RoundToInt32((Location.Y - Origin.Y) / CellSize));
+}
+
+FVector FDungeonNavigationGrid::CellToWorld(const FIntPoint& Cell) const
+{
+	return Origin + FVector(Cell.X * CellSize, Cell.Y * CellSize, 0.0f);
+}
+
+FIntPoint FDungeonNavigationGrid::FindNearestWalkableCell(const FVector& Location) const
+{
+	if (IsEmpty())
+	{
+		return FIntPoint(INDEX_NONE, INDEX_NONE);
+	}
+
+	FIntPoint Centre = WorldToCell(Location);
+	Centre.X = FMath::Clamp(Centre.X, 0, Width - 1);
+	Centre.Y = FMath::Clamp(Centre.Y, 0, Height - 1);
+	if (IsWalkable(Centre))
+	{
+		return Centre;
+	}
+
+	// Search square rings of cells around the location. A cell in the ring after the first hit can still be closer than
+	// the corners of that ring, so search one more ring before stopping.
+	FIntPoint BestCell(INDEX_NONE, INDEX_NONE);
+	double BestDistSquared = TNumericLimits<double>::Max();
+	const int32 MaxRadius = FMath::Max(Width, Height);
+	int32 LastRadius = MaxRadius;
+	for (int32 Radius = 1; Radius <= FMath::Min(LastRadius, MaxRadius); Radius++)
+	{
+		for (int32 Y = Centre.Y - Radius; Y <= Centre.Y + Radius; Y++)
+		{
+			for (int32 X = Centre.X - Radius; X <= Centre.X + Radius; X++)
+			{
+				// Only the edge of the ring, the inside was covered by the smaller radii.
+				if (FMath::Abs(X - Centre.X) != Radius && FMath::Abs(Y - Centre.Y) != Radius) continue;
+
+				const FIntPoint Cell(X, Y);
+				if (!IsWalkable(Cell)) continue;
+				const double DistSquared = FVector::DistSquared2D(CellToWorld(Cell), Location);
+				if (DistSquared < BestDistSquared)
+				{
+					BestDistSquared = DistSquared;
+					BestCell = Cell;
+				}
+			}
+		}
+		if (BestCell.X != INDEX_NONE && LastRadius == MaxRadius)
+		{
+			LastRadius = Radius + 1;
+		}
+	}
+	return BestCell;
+}
+
+bool FDungeonNavigationGrid::FindPath(const FIntPoint& Start, const FIntPoint& End, TArray<FVector>& OutPath) const
+{
+	OutPath.Reset();
+	if (!IsWalkable(Start) || !IsWalkable(End))
+	{
+		return false;
+	}
+
+	// Each thread keeps its own search memory so routes can be found from worker threads too.
+	static thread_local TArray<int32> CameFrom;
+	static thread_local TArray<int32> Frontier;
+	CameFrom.Init(INDEX_NONE, Cells.Num());
+	Frontier.Reset(Cells.Num());
+
+	const int32 StartIndex = GetCellIndex(Start);
+	const int32 EndIndex = GetCellIndex(End);
+	// Index offsets of the east, north, west and south neighbours, in the same order as the open side flags.
+	const int32 NeighbourOffsets[4] = { 1, Width, -1, -Width };
+
+	CameFrom[StartIndex] = StartIndex;
+	Frontier.Add(StartIndex);
+	for (int32 Head = 0; Head < Frontier.Num() && CameFrom[EndIndex] == INDEX_NONE; Head++)
+	{
+		const int32 CellIndex = Frontier[Head];
+		const uint8 Flags = Cells[CellIndex];
+		for (int32 Side = 0; Side < 4; Side++)
+		{
+			if (!(Flags & (1 << Side))) continue;
+
+			// Open sides always lead to a cell inside the grid so there is no need to bounds check.
+			const int32 NeighbourIndex = CellIndex + NeighbourOffsets[Side];
+			if (CameFrom[NeighbourIndex] == INDEX_NONE)
+			{
+				CameFrom[NeighbourIndex] = CellIndex;
+				Frontier.Add(NeighbourIndex);
+			}
+		}
+	}
+	if (CameFrom[EndIndex] == INDEX_NONE)
+	{
+		return false;
+	}
+
+	for (int32 CellIndex = EndIndex; ; CellIndex = CameFrom[CellIndex])
+	{
+		OutPath.Add(CellToWorld(GetCell(CellIndex)));
+		if (CellIndex == StartIndex) break;
+	}
+	return true;
+}
@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonNavigationGrid.generated.h"
+
+/**
+ * A compact occupancy and connectivity grid for generated dungeons, one byte per cell. Each cell records whether it
+ * can be walked on, whether it is a room, and which of its four neighbours it opens onto, so corridors and walls
+ * between touching cells are represented exactly. Routes are found with a breadth first search over the cells, which
+ * is optimal here as every step is one cell long, and no node actors are needed. The dungeon generator saves it with the
+ * level, so it is only a struct for its properties to be serialized.
+ */
+USTRUCT()
+struct AGP_API FDungeonNavigationGrid
+{
+	GENERATED_BODY()
+
+public:
+
+	/**
+	 * Clears the grid and resizes it. Every cell starts off blocked.
+	 * @param InWidth The number of cells along X.
+	 * @param InHeight The number of cells along Y.
+	 * @param InCellSize The world size of a cell.
+	 * @param InOrigin The world location of the centre of cell (0, 0).
+	 */
+	void Init(int32 InWidth, int32 InHeight, float InCellSize, const FVector& InOrigin);
+
+	void Reset() { Init(0, 0, 0.0f, FVector::ZeroVector); }
+
+	/**
+	 * Marks a cell as a walkable room.
+	 */
+	void AddRoom(const FIntPoint& Cell);
+
+	/**
+	 * Marks the cells on a straight line between two cells as walkable and links each one to the next. The end cells
+	 * are usually rooms.
+	 */
+	void AddCorridor(const FIntPoint& From, const FIntPoint& To);
+
+	/**
+	 * Opens the side between two walkable cells that share an edge.
+	 */
+	void Connect(const FIntPoint& A, const FIntPoint& B);
+
+	bool IsValidCell(const FIntPoint& Cell) const { return Cell.X >= 0 && Cell.X < Width && Cell.Y >= 0 && Cell.Y < Height; }
+	bool IsWalkable(const FIntPoint& Cell) const { return IsValidCell(Cell) && (Cells[GetCellIndex(Cell)] & Walkable); }
+	bool IsRoom(const FIntPoint& Cell) const { return IsValidCell(Cell) && (Cells[GetCellIndex(Cell)] & Room); }
+	bool IsEmpty() const { return Cells.IsEmpty(); }
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+	int32 GetNumCells() const { return Cells.Num(); }
+	float GetCellSize() const { return CellSize; }
+
+	int32 GetCellIndex(const FIntPoint& Cell) const { return Cell.Y * Width + Cell.X; }
+	FIntPoint GetCell(int32 CellIndex) const { return FIntPoint(CellIndex % Width, CellIndex / Width); }
+	/**
+	 * @return Which sides of a cell are open, one bit per side in the order east, north, west, south.
+	 */
+	uint8 GetOpenSides(int32 CellIndex) const { return Cells[CellIndex] & (OpenEast | OpenNorth | OpenWest | OpenSouth); }
+	/**
+	 * @return What to add to a cell index to get the index of the neighbour on a side, in the same order as GetOpenSides.
+	 */
+	int32 GetNeighbourOffset(int32 Side) const
+	{
+		const int32 Offsets[4] = { 1, Width, -1, -Width };
+		return Offsets[Side];
+	}
+
+	FIntPoint WorldToCell(const FVector& Location) const;
+	FVector CellToWorld(const FIntPoint& Cell) const;
+
+	/**
+	 * @return The walkable cell closest to the location, or (INDEX_NONE, INDEX_NONE) if no cell is walkable.
+	 */
+	FIntPoint FindNearestWalkableCell(const FVector& Location) const;
+
+	/**
+	 * Finds the route with the fewest cells between two cells.
+	 * @param OutPath Filled with the centres of the cells along the route, in reverse order to match the node graph
+	 * paths. Emptied if there is no route.
+	 * @return true if a route was found.
+	 */
+	bool FindPath(const FIntPoint& Start, const FIntPoint& End, TArray<FVector>& OutPath) const;
+
+	SIZE_T GetAllocatedSize() const { return Cells.GetAllocatedSize(); }
+
+private:
+
+	enum ECellFlags : uint8
+	{
+		OpenEast = 1 << 0,
+		OpenNorth = 1 << 1,
+		OpenWest = 1 << 2,
+		OpenSouth = 1 << 3,
+		Walkable = 1 << 4,
+		Room = 1 << 5
+	};
+
+	UPROPERTY()
+	int32 Width = 0;
+	UPROPERTY()
+	int32 Height = 0;
+	UPROPERTY()
+	float CellSize = 0.0f;
+	UPROPERTY()
+	FVector Origin = FVector::ZeroVector;
+	// Row major, X varies fastest.
+	UPROPERTY()
+	TArray<uint8> Cells;
+};
+
+/**
+ * Reads an FDungeonNavigationGrid for TNavigationSearch. Nodes are cell indices, every step costs one cell and edges
+ * are CellIndex * 4 + Side.
+ */
+struct FDungeonGridAdapter
+{
+	const FDungeonNavigationGrid& Grid;
+
+	explicit FDungeonGridAdapter(const FDungeonNavigationGrid& InGrid) : Grid(InGrid) {}
+
+	int32 Num() const { return Grid.GetNumCells(); }
+	FVector GetPosition(int32 Index) const { return Grid.CellToWorld(Grid.GetCell(Index)); }
+	float GetEdgeCost(int32 Edge) const { return Grid.GetCellSize(); }
+
+	template <typename FuncType>
+	void ForEachEdge(int32 Index, FuncType&& Func) const
+	{
+		const uint8 OpenSides = Grid.GetOpenSides(Index);
+		for (int32 Side = 0; Side < 4; Side++)
+		{
+			// Open sides always lead to a cell inside the grid so there is no need to bounds check.
+			if (OpenSides & (1 << Side))
+			{
+				Func(Index * 4 + Side, Index + Grid.GetNeighbourOffset(Side));
+			}
+		}
+	}
+};
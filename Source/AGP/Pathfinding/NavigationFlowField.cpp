@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationFlowField.h"
+#include "PathfindingHeap.h"
+#include "Algo/Reverse.h"
+
+void FNavigationFlowField::Build(const FNavigationGraphPtr& InGraph, int32 InTargetIndex)
+{
+	Graph = InGraph;
+	TargetIndex = InTargetIndex;
+	if (!Graph.IsValid() || !Graph->IsValidNode(TargetIndex))
+	{
+		Graph.Reset();
+		TargetIndex = INDEX_NONE;
+		Distances.Empty();
+		NextNodes.Empty();
+		return;
+	}
+
+	const FNavigationGraph& NavGraph = *Graph;
+	Distances.Init(UE_MAX_FLT, NavGraph.Num());
+	NextNodes.Init(INDEX_NONE, NavGraph.Num());
+
+	// Fields can be built on worker threads so each thread keeps its own open set.
+	static thread_local FIndexedMinHeap OpenSet;
+	OpenSet.Reset(NavGraph.Num());
+
+	// Dijkstra over the incoming edges, so the distances are to the target rather than from it. The node an edge was
+	// relaxed from is the next step on the way to the target.
+	Distances[TargetIndex] = 0.0f;
+	OpenSet.PushOrDecrease(TargetIndex, 0.0f);
+	while (!OpenSet.IsEmpty())
+	{
+		const int32 CurrentIndex = OpenSet.Pop();
+		const float CurrentDistance = Distances[CurrentIndex];
+		for (int32 i = NavGraph.ReverseOffsets[CurrentIndex]; i < NavGraph.ReverseOffsets[CurrentIndex + 1]; i++)
+		{
+			const int32 FromIndex = NavGraph.ReverseNeighbours[i];
+			const float TentativeDistance = CurrentDistance + NavGraph.EdgeCosts[NavGraph.ReverseEdges[i]];
+			if (TentativeDistance < Distances[FromIndex])
+			{
+				Distances[FromIndex] = TentativeDistance;
+				NextNodes[FromIndex] = CurrentIndex;
+				OpenSet.PushOrDecrease(FromIndex, TentativeDistance);
+			}
+		}
+	}
+}
+
+int32 FNavigationFlowField::FindFurthestNode() const
+{
+	int32 FurthestIndex = TargetIndex;
+	for (int32 i = 0; i < Distances.Num(); i++)
+	{
+		if (Distances[i] < UE_MAX_FLT && Distances[i] > Distances[FurthestIndex])
+		{
+			FurthestIndex = i;
+		}
+	}
+	return FurthestIndex;
+}
+
+bool FNavigationFlowField::GetPath(int32 StartIndex, TArray<FVector>& OutPath) const
+{
+	OutPath.Reset();
+	if (!IsBuilt() || !Graph->IsValidNode(StartIndex) || Distances[StartIndex] >= UE_MAX_FLT)
+	{
+		return false;
+	}
+
+	// Walk from the start to the target, then flip it so the path is in the same reverse order as the A* results.
+	for (int32 CurrentIndex = StartIndex; CurrentIndex != INDEX_NONE; CurrentIndex = NextNodes[CurrentIndex])
+	{
+		OutPath.Push(Graph->Positions[CurrentIndex]);
+	}
+	Algo::Reverse(OutPath);
+	return true;
+}
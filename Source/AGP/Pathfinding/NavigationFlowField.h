@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavigationGraph.h"
+
+/**
+ * The shortest distance from every node of a graph snapshot to one target node, along with which neighbour to step to
+ * next to get there. It is built with a single Dijkstra search backwards from the target, after which any number of
+ * agents heading for the same target can look up their next node in constant time without searching themselves.
+ */
+class AGP_API FNavigationFlowField
+{
+public:
+
+	/**
+	 * Searches backwards from the target over the whole graph.
+	 * @param InGraph The snapshot to build the field for. It is kept alive by the field.
+	 * @param InTargetIndex The node that the field leads to.
+	 */
+	void Build(const FNavigationGraphPtr& InGraph, int32 InTargetIndex);
+
+	bool IsBuilt() const { return Graph.IsValid(); }
+	const FNavigationGraphPtr& GetGraph() const { return Graph; }
+	int32 GetTargetIndex() const { return TargetIndex; }
+
+	/**
+	 * @return The node to step to from Index to get closer to the target, or INDEX_NONE if Index is the target or the
+	 * target can't be reached from it.
+	 */
+	int32 GetNextNode(int32 Index) const { return NextNodes[Index]; }
+	/**
+	 * @return The length of the shortest path from Index to the target, or UE_MAX_FLT if there isn't one.
+	 */
+	float GetDistance(int32 Index) const { return Distances[Index]; }
+	/**
+	 * @return The node with the longest shortest path to the target, out of the nodes that can reach it. This is the
+	 * target itself if nothing else can reach it, or INDEX_NONE if the field isn't built.
+	 */
+	int32 FindFurthestNode() const;
+
+	/**
+	 * Follows the field from a node to the target.
+	 * @param OutPath Filled with the node positions from the target back to StartIndex. Emptied if there is no path.
+	 * @return true if the target can be reached.
+	 */
+	bool GetPath(int32 StartIndex, TArray<FVector>& OutPath) const;
+
+	SIZE_T GetAllocatedSize() const { return Distances.GetAllocatedSize() + NextNodes.GetAllocatedSize(); }
+
+private:
+
+	FNavigationGraphPtr Graph;
+	int32 TargetIndex = INDEX_NONE;
+	TArray<float> Distances;
+	TArray<int32> NextNodes;
+};
+
+using FNavigationFlowFieldPtr = TSharedPtr<const FNavigationFlowField, ESPMode::ThreadSafe>;
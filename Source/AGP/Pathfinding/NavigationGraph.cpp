@@ -0,0 +1,228 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationGraph.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/Count.h"
+
+TSharedRef<const FNavigationGraph, ESPMode::ThreadSafe> FNavigationGraph::Build(const TArray<FVector>& InPositions,
+	const TArray<TArray<int32>>& Adjacency, uint32 InVersion, const FNavigationGraphBuildSettings& Settings,
+	TFunctionRef<bool(int32, int32)> IsEdgeBlocked)
+{
+	check(InPositions.Num() == Adjacency.Num());
+
+	TSharedRef<FNavigationGraph, ESPMode::ThreadSafe> Graph = MakeShared<FNavigationGraph, ESPMode::ThreadSafe>();
+	Graph->Version = InVersion;
+	Graph->TopologyVersion = InVersion;
+	Graph->Positions = InPositions;
+
+	int32 NumEdges = 0;
+	for (const TArray<int32>& NodeNeighbours : Adjacency)
+	{
+		NumEdges += NodeNeighbours.Num();
+	}
+
+	Graph->NeighbourOffsets.Reserve(InPositions.Num() + 1);
+	Graph->Neighbours.Reserve(NumEdges);
+	Graph->EdgeCosts.Reserve(NumEdges);
+
+	for (int32 i = 0; i < Adjacency.Num(); i++)
+	{
+		const int32 Begin = Graph->Neighbours.Num();
+		Graph->NeighbourOffsets.Add(Begin);
+		for (const int32 Neighbour : Adjacency[i])
+		{
+			if (!InPositions.IsValidIndex(Neighbour)) continue;
+
+			// Adjacency lists are short so a linear check for duplicates within this node's range is cheap.
+			bool bDuplicate = false;
+			for (int32 j = Begin; j < Graph->Neighbours.Num(); j++)
+			{
+				if (Graph->Neighbours[j] == Neighbour)
+				{
+					bDuplicate = true;
+					break;
+				}
+			}
+			if (bDuplicate) continue;
+
+			Graph->Neighbours.Add(Neighbour);
+			Graph->EdgeCosts.Add(IsEdgeBlocked(i, Neighbour) ? BlockedCost : FVector::Distance(InPositions[i], InPositions[Neighbour]));
+		}
+	}
+	Graph->NeighbourOffsets.Add(Graph->Neighbours.Num());
+
+	Graph->BuildReverseEdges();
+	Graph->SpatialIndex.Build(Graph->Positions);
+	Graph->BuildAccelerationStructures(Settings);
+
+	return Graph;
+}
+
+TSharedRef<const FNavigationGraph, ESPMode::ThreadSafe> FNavigationGraph::WithEdgeCosts(const FNavigationGraph& Base,
+	const TArray<TPair<int32, float>>& CostChanges, uint32 InVersion)
+{
+	// Copy everything except the acceleration structures that depend on the costs, they are rebuilt below.
+	TSharedRef<FNavigationGraph, ESPMode::ThreadSafe> Graph = MakeShared<FNavigationGraph, ESPMode::ThreadSafe>();
+	Graph->Version = InVersion;
+	Graph->TopologyVersion = Base.TopologyVersion;
+	Graph->Positions = Base.Positions;
+	Graph->NeighbourOffsets = Base.NeighbourOffsets;
+	Graph->Neighbours = Base.Neighbours;
+	Graph->EdgeCosts = Base.EdgeCosts;
+	Graph->ReverseOffsets = Base.ReverseOffsets;
+	Graph->ReverseNeighbours = Base.ReverseNeighbours;
+	Graph->ReverseEdges = Base.ReverseEdges;
+	Graph->SpatialIndex = Base.SpatialIndex;
+	// The landmark distances ignore blocking so they hold for any costs.
+	Graph->Landmarks = Base.Landmarks;
+
+	for (const TPair<int32, float>& Change : CostChanges)
+	{
+		Graph->EdgeCosts[Change.Key] = Change.Value;
+	}
+
+	FNavigationGraphBuildSettings Settings;
+	Settings.RoutingTableMaxNodes = Base.RoutingTable.IsBuilt() ? FNavigationRoutingTable::MaxNodes : 0;
+	Settings.HierarchyClusterSize = Base.Hierarchy.GetClusterSize();
+	Settings.NumLandmarks = Base.Landmarks.GetNumLandmarks();
+	Graph->BuildAccelerationStructures(Settings);
+
+	return Graph;
+}
+
+int32 FNavigationGraph::FindEdge(int32 FromIndex, int32 ToIndex) const
+{
+	for (int32 Edge = GetNeighbourBegin(FromIndex); Edge < GetNeighbourEnd(FromIndex); Edge++)
+	{
+		if (Neighbours[Edge] == ToIndex)
+		{
+			return Edge;
+		}
+	}
+	return INDEX_NONE;
+}
+
+int32 FNavigationGraph::GetEdgeSource(int32 Edge) const
+{
+	// The offsets are sorted so the source is the last node whose edges start at or before this one.
+	return Algo::UpperBound(NeighbourOffsets, Edge) - 1;
+}
+
+void FNavigationGraph::BuildReverseEdges()
+{
+	// Count the incoming edges of each node, turn the counts into offsets, then drop each edge into its slot.
+	ReverseOffsets.SetNumZeroed(Num() + 1);
+	for (const int32 Neighbour : Neighbours)
+	{
+		ReverseOffsets[Neighbour + 1]++;
+	}
+	for (int32 i = 0; i < Num(); i++)
+	{
+		ReverseOffsets[i + 1] += ReverseOffsets[i];
+	}
+
+	ReverseNeighbours.SetNumUninitialized(NumEdges());
+	ReverseEdges.SetNumUninitialized(NumEdges());
+	TArray<int32> Cursors(ReverseOffsets.GetData(), Num());
+	for (int32 i = 0; i < Num(); i++)
+	{
+		for (int32 Edge = GetNeighbourBegin(i); Edge < GetNeighbourEnd(i); Edge++)
+		{
+			const int32 Slot = Cursors[Neighbours[Edge]]++;
+			ReverseNeighbours[Slot] = i;
+			ReverseEdges[Slot] = Edge;
+		}
+	}
+}
+
+void FNavigationGraph::Save(FArchive& Ar) const
+{
+	check(Ar.IsSaving());
+	// Saving only reads from the arrays, the same function is used for both directions so they can't get out of step.
+	const_cast<FNavigationGraph*>(this)->SerializeBakedData(Ar);
+}
+
+FNavigationGraphPtr FNavigationGraph::Load(FArchive& Ar, uint32 InVersion, const FNavigationGraphBuildSettings& Settings)
+{
+	check(Ar.IsLoading());
+	TSharedRef<FNavigationGraph, ESPMode::ThreadSafe> Graph = MakeShared<FNavigationGraph, ESPMode::ThreadSafe>();
+	Graph->SerializeBakedData(Ar);
+	if (Ar.IsError() || !Graph->IsValidLayout())
+	{
+		return nullptr;
+	}
+
+	Graph->Version = InVersion;
+	Graph->TopologyVersion = InVersion;
+	if (Graph->Num() > FMath::Min(Settings.RoutingTableMaxNodes, FNavigationRoutingTable::MaxNodes))
+	{
+		Graph->RoutingTable = FNavigationRoutingTable();
+	}
+	if (Graph->RoutingTable.IsBuilt() || Graph->Landmarks.GetNumLandmarks() != Settings.NumLandmarks)
+	{
+		Graph->Landmarks = FNavigationLandmarks();
+	}
+
+	Graph->BuildReverseEdges();
+	Graph->SpatialIndex.Build(Graph->Positions);
+	Graph->BuildAccelerationStructures(Settings);
+	return Graph;
+}
+
+void FNavigationGraph::SerializeBakedData(FArchive& Ar)
+{
+	// Every array is written as one block so loading is a handful of copies out of the file's bytes.
+	Positions.BulkSerialize(Ar);
+	NeighbourOffsets.BulkSerialize(Ar);
+	Neighbours.BulkSerialize(Ar);
+	EdgeCosts.BulkSerialize(Ar);
+	RoutingTable.Serialize(Ar);
+	Landmarks.Serialize(Ar, Num());
+}
+
+bool FNavigationGraph::IsValidLayout() const
+{
+	if (NeighbourOffsets.Num() != Num() + 1 || NeighbourOffsets[0] != 0 || NeighbourOffsets.Last() != NumEdges()
+		|| EdgeCosts.Num() != NumEdges() || (RoutingTable.IsBuilt() && RoutingTable.GetNumNodes() != Num()))
+	{
+		return false;
+	}
+	for (int32 i = 0; i < Num(); i++)
+	{
+		if (NeighbourOffsets[i] > NeighbourOffsets[i + 1]) return false;
+	}
+	for (const int32 Neighbour : Neighbours)
+	{
+		if (!IsValidNode(Neighbour)) return false;
+	}
+	return true;
+}
+
+void FNavigationGraph::BuildAccelerationStructures(const FNavigationGraphBuildSettings& Settings)
+{
+	NumBlockedEdges = Algo::CountIf(EdgeCosts, [](float Cost) { return Cost >= BlockedCost; });
+
+	// A loaded snapshot may already have its routing table and landmarks, and a copy with new costs its landmarks.
+	const int32 RoutingTableMaxNodes = FMath::Min(Settings.RoutingTableMaxNodes, FNavigationRoutingTable::MaxNodes);
+	if (!RoutingTable.IsBuilt() && Num() > 0 && Num() <= RoutingTableMaxNodes)
+	{
+		RoutingTable.Build(*this);
+	}
+	if (!RoutingTable.IsBuilt() && Settings.HierarchyClusterSize > 0.0f)
+	{
+		Hierarchy.Build(*this, Settings.HierarchyClusterSize);
+	}
+	if (!RoutingTable.IsBuilt() && !Landmarks.IsBuilt() && Settings.NumLandmarks > 0)
+	{
+		Landmarks.Build(*this, Settings.NumLandmarks);
+	}
+}
+
+SIZE_T FNavigationGraph::GetAllocatedSize() const
+{
+	return Positions.GetAllocatedSize() + NeighbourOffsets.GetAllocatedSize()
+		+ Neighbours.GetAllocatedSize() + EdgeCosts.GetAllocatedSize() + ReverseOffsets.GetAllocatedSize()
+		+ ReverseNeighbours.GetAllocatedSize() + ReverseEdges.GetAllocatedSize() + SpatialIndex.GetAllocatedSize()
+		+ RoutingTable.GetAllocatedSize() + Hierarchy.GetAllocatedSize() + Landmarks.GetAllocatedSize();
+}
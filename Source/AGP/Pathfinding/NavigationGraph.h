@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavigationHierarchy.h"
+#include "NavigationLandmarks.h"
+#include "NavigationRoutingTable.h"
+#include "NavigationSpatialIndex.h"
+
+/**
+ * Optional extras to precompute when building an FNavigationGraph snapshot.
+ */
+struct FNavigationGraphBuildSettings
+{
+	// Build an all pairs routing table if the graph has at most this many nodes. 0 never builds one.
+	int32 RoutingTableMaxNodes = 0;
+	// Build a cluster hierarchy with clusters this wide if no routing table was built. 0 never builds one.
+	float HierarchyClusterSize = 0.0f;
+	// Pick this many landmarks for the A* heuristic if no routing table was built. 0 never picks any.
+	int32 NumLandmarks = 0;
+};
+
+struct FNavigationGraph;
+using FNavigationGraphPtr = TSharedPtr<const FNavigationGraph, ESPMode::ThreadSafe>;
+
+/**
+ * An immutable snapshot of the navigation graph stored in compressed sparse row form. Node positions are kept in one
+ * contiguous array and the neighbours of node i are Neighbours[NeighbourOffsets[i]] to Neighbours[NeighbourOffsets[i+1]-1]
+ * with the matching precomputed edge lengths in EdgeCosts. Searches run against this instead of following the
+ * ANavigationNode actors so that no UObjects are touched and no distances are recomputed per query.
+ */
+struct AGP_API FNavigationGraph
+{
+	// The cost of an edge that has been blocked. Searches never take it because adding it to any score overflows past
+	// their initial scores.
+	static constexpr float BlockedCost = UE_MAX_FLT;
+
+	TArray<FVector> Positions;
+	TArray<int32> NeighbourOffsets;
+	TArray<int32> Neighbours;
+	TArray<float> EdgeCosts;
+
+	// The same edges grouped by the node they lead to. The incoming edges of node i are ReverseNeighbours[ReverseOffsets[i]]
+	// to ReverseNeighbours[ReverseOffsets[i+1]-1], and ReverseEdges holds the index of each one in Neighbours and EdgeCosts.
+	TArray<int32> ReverseOffsets;
+	TArray<int32> ReverseNeighbours;
+	TArray<int32> ReverseEdges;
+
+	// Accelerates nearest and furthest node lookups over Positions.
+	FNavigationSpatialIndex SpatialIndex;
+
+	// Next hops for every pair of nodes. Only built for small graphs, searches walk it instead of running A* when it is.
+	FNavigationRoutingTable RoutingTable;
+
+	// Coarse graph over clusters of nodes. Only built for large graphs, long searches go through it when it is.
+	FNavigationHierarchy Hierarchy;
+
+	// Distances to and from a few landmark nodes that tighten the A* heuristic. Not built alongside a routing table.
+	FNavigationLandmarks Landmarks;
+
+	// How many of the edges are blocked.
+	int32 NumBlockedEdges = 0;
+
+	// Incremented by the UPathfindingSubsystem every time it builds a new snapshot.
+	uint32 Version = 0;
+	// The version of the snapshot the nodes and edges came from. Snapshots that only change edge costs keep it, so node
+	// and edge indices can be carried from one to the other.
+	uint32 TopologyVersion = 0;
+
+	int32 Num() const { return Positions.Num(); }
+	int32 NumEdges() const { return Neighbours.Num(); }
+	bool IsValidNode(int32 Index) const { return Positions.IsValidIndex(Index); }
+
+	int32 GetNeighbourBegin(int32 Index) const { return NeighbourOffsets[Index]; }
+	int32 GetNeighbourEnd(int32 Index) const { return NeighbourOffsets[Index + 1]; }
+	bool IsEdgeBlocked(int32 Edge) const { return EdgeCosts[Edge] >= BlockedCost; }
+
+	/**
+	 * @return The index of the edge from FromIndex to ToIndex, or INDEX_NONE if they are not connected.
+	 */
+	int32 FindEdge(int32 FromIndex, int32 ToIndex) const;
+	/**
+	 * @return The node that the edge starts from.
+	 */
+	int32 GetEdgeSource(int32 Edge) const;
+
+	int32 FindNearestNode(const FVector& Location) const { return SpatialIndex.FindNearest(Positions, Location); }
+	int32 FindFurthestNode(const FVector& Location) const { return SpatialIndex.FindFurthest(Positions, Location); }
+
+	/**
+	 * Builds a snapshot from per-node adjacency lists. Invalid and duplicate neighbour indices are dropped.
+	 * @param InPositions The world position of each node.
+	 * @param Adjacency The indices of the nodes that each node connects to. Must be the same length as InPositions.
+	 * @param InVersion The version number to stamp the snapshot with.
+	 * @param Settings Which optional acceleration structures to build alongside the snapshot.
+	 * @param IsEdgeBlocked Whether the edge between two node indices starts off blocked.
+	 * @return The new snapshot.
+	 */
+	static TSharedRef<const FNavigationGraph, ESPMode::ThreadSafe> Build(const TArray<FVector>& InPositions,
+		const TArray<TArray<int32>>& Adjacency, uint32 InVersion,
+		const FNavigationGraphBuildSettings& Settings = FNavigationGraphBuildSettings(),
+		TFunctionRef<bool(int32, int32)> IsEdgeBlocked = [](int32, int32) { return false; });
+
+	/**
+	 * Makes a copy of a snapshot with some of its edge costs changed, for blocking and unblocking edges without
+	 * rebuilding from the node actors. The nodes and edges keep their indices and any routing table or hierarchy the
+	 * base had is rebuilt for the new costs.
+	 * @param Base The snapshot to copy.
+	 * @param CostChanges Pairs of edge index and new cost.
+	 * @param InVersion The version number to stamp the snapshot with.
+	 * @return The new snapshot.
+	 */
+	static TSharedRef<const FNavigationGraph, ESPMode::ThreadSafe> WithEdgeCosts(const FNavigationGraph& Base,
+		const TArray<TPair<int32, float>>& CostChanges, uint32 InVersion);
+
+	/**
+	 * Writes the nodes, edges, routing table and landmarks of the snapshot for baking. Everything else is quick to rebuild so it is
+	 * left out.
+	 */
+	void Save(FArchive& Ar) const;
+
+	/**
+	 * Reads a snapshot written by Save and rebuilds the parts that were left out. A baked routing table or landmarks
+	 * are kept if the settings would still build the same ones, so they don't have to be built again.
+	 * @param Ar The archive to read from.
+	 * @param InVersion The version number to stamp the snapshot with.
+	 * @param Settings Which optional acceleration structures to build alongside the snapshot.
+	 * @return The new snapshot, or null if the archive didn't hold a valid one.
+	 */
+	static FNavigationGraphPtr Load(FArchive& Ar, uint32 InVersion,
+		const FNavigationGraphBuildSettings& Settings = FNavigationGraphBuildSettings());
+
+	/**
+	 * @return The number of bytes allocated by this snapshot's arrays.
+	 */
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	// The part of the snapshot that Save and Load read and write.
+	void SerializeBakedData(FArchive& Ar);
+	// Checks that the offsets and neighbour indices of a loaded snapshot are in range, so a corrupt file can't be read past.
+	bool IsValidLayout() const;
+	void BuildReverseEdges();
+	void BuildAccelerationStructures(const FNavigationGraphBuildSettings& Settings);
+};
+
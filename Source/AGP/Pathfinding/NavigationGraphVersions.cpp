@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationGraphVersions.h"
+#include "HAL/PlatformTLS.h"
+
+void FNavigationGraphVersions::Publish(FNavigationGraphPtr Graph)
+{
+	check(IsInGameThread());
+	FVersion* NewVersion = new FVersion();
+	NewVersion->Graph = MoveTemp(Graph);
+	FVersion* OldVersion = Current.exchange(NewVersion);
+
+	// Readers that start from here on will see the new version, so the old one only has to wait for readers that
+	// started before the epoch moved on.
+	const uint64 NewEpoch = Epoch.fetch_add(1) + 1;
+	if (OldVersion)
+	{
+		OldVersion->RetiredEpoch = NewEpoch;
+		Retired.Add(OldVersion);
+	}
+	Reclaim();
+}
+
+FNavigationGraphPtr FNavigationGraphVersions::Pin() const
+{
+	// Mark the slot before reading the current version. If Reclaim doesn't see the mark then it scanned before the
+	// mark was made, so the version it was retiring had already been replaced and this reader will read the new one.
+	static thread_local int32 SlotHint = FPlatformTLS::GetCurrentThreadId() % NumReaderSlots;
+	const uint64 ReaderEpoch = Epoch.load();
+	int32 SlotIndex = SlotHint;
+	for (;; SlotIndex = (SlotIndex + 1) % NumReaderSlots)
+	{
+		uint64 Expected = 0;
+		if (ReaderSlots[SlotIndex].Epoch.compare_exchange_strong(Expected, ReaderEpoch))
+		{
+			break;
+		}
+	}
+	SlotHint = SlotIndex;
+
+	const FVersion* Version = Current.load();
+	FNavigationGraphPtr Graph = Version ? Version->Graph : nullptr;
+	ReaderSlots[SlotIndex].Epoch.store(0);
+	return Graph;
+}
+
+void FNavigationGraphVersions::Reclaim()
+{
+	if (Retired.IsEmpty()) return;
+
+	uint64 OldestReader = MAX_uint64;
+	for (const FReaderSlot& Slot : ReaderSlots)
+	{
+		const uint64 ReaderEpoch = Slot.Epoch.load();
+		if (ReaderEpoch != 0)
+		{
+			OldestReader = FMath::Min(OldestReader, ReaderEpoch);
+		}
+	}
+
+	// Dropping a version only drops its reference, so readers that have already pinned its snapshot keep it alive.
+	Retired.RemoveAll([OldestReader](FVersion* Version)
+	{
+		if (Version->RetiredEpoch <= OldestReader)
+		{
+			delete Version;
+			return true;
+		}
+		return false;
+	});
+}
+
+void FNavigationGraphVersions::Reset()
+{
+	for (FVersion* Version : Retired)
+	{
+		delete Version;
+	}
+	Retired.Empty();
+	delete Current.exchange(nullptr);
+}
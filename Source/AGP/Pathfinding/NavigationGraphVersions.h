@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavigationGraph.h"
+#include <atomic>
+
+/**
+ * Publishes graph snapshots to readers on any thread without locks, read-copy-update style. The game thread builds a
+ * new snapshot for every edit and publishes it, and a reader pins whichever snapshot is current by taking a shared
+ * reference to it, which it can search for as long as it likes. A snapshot is freed once it has been replaced and the
+ * last reader holding it lets go.
+ *
+ * The only unsafe moment is a reader copying the reference out while the game thread replaces it, so each reader marks
+ * the epoch it started in for the few instructions the copy takes, and replaced versions are only dropped once every
+ * reader that could have seen them has finished.
+ */
+class AGP_API FNavigationGraphVersions
+{
+public:
+
+	FNavigationGraphVersions() = default;
+	FNavigationGraphVersions(const FNavigationGraphVersions&) = delete;
+	FNavigationGraphVersions& operator=(const FNavigationGraphVersions&) = delete;
+	~FNavigationGraphVersions() { Reset(); }
+
+	/**
+	 * Makes a snapshot the one that Pin hands out and retires the one before it. Game thread only.
+	 */
+	void Publish(FNavigationGraphPtr Graph);
+
+	/**
+	 * Safe to call from any thread.
+	 * @return The most recently published snapshot, or null if none has been. Holding on to it keeps it alive.
+	 */
+	FNavigationGraphPtr Pin() const;
+
+	/**
+	 * Lets go of the retired versions that no reader can still be copying. Called by Publish, and worth calling once a
+	 * frame so the last retired version doesn't wait for the next edit. Game thread only.
+	 */
+	void Reclaim();
+
+	/**
+	 * Lets go of every version. Nothing may be calling Pin at the same time. Game thread only.
+	 */
+	void Reset();
+
+	int32 GetNumRetired() const { return Retired.Num(); }
+	uint64 GetNumPublished() const { return Epoch.load() - 1; }
+
+private:
+
+	struct FVersion
+	{
+		FNavigationGraphPtr Graph;
+		// The epoch that started when the version was replaced. Readers that started in it or later can't have seen it.
+		uint64 RetiredEpoch = 0;
+	};
+
+	// Kept on their own cache lines so readers on different threads don't slow each other down.
+	struct alignas(PLATFORM_CACHE_LINE_SIZE) FReaderSlot
+	{
+		// The epoch the reader using the slot started in, or 0 if no reader is using it.
+		std::atomic<uint64> Epoch{ 0 };
+	};
+
+	// More than the threads that could be pinning at once. A reader only holds a slot while it copies the reference.
+	static constexpr int32 NumReaderSlots = 64;
+
+	std::atomic<FVersion*> Current{ nullptr };
+	std::atomic<uint64> Epoch{ 1 };
+	mutable FReaderSlot ReaderSlots[NumReaderSlots];
+	// Replaced versions that a reader may still be copying the reference out of.
+	TArray<FVersion*> Retired;
+};
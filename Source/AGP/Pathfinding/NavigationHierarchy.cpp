@@ -0,0 +1,391 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationHierarchy.h"
+#include "NavigationGraph.h"
+#include "NavigationSearch.h"
+#include "PathfindingHeap.h"
+#include "Algo/Reverse.h"
+#include "Async/ParallelFor.h"
+
+void FNavigationHierarchy::Build(const FNavigationGraph& Graph, float InClusterSize)
+{
+	*this = FNavigationHierarchy();
+	const int32 NumNodes = Graph.Num();
+	if (InClusterSize <= 0.0f || NumNodes == 0)
+	{
+		return;
+	}
+	ClusterSize = InClusterSize;
+
+	// Group the nodes into clusters by position, counting each cluster's nodes in NodeEnd for now.
+	TMap<FIntPoint, int32> ClusterLookup;
+	ClusterOf.SetNumUninitialized(NumNodes);
+	for (int32 i = 0; i < NumNodes; i++)
+	{
+		const FIntPoint Coordinate = GetClusterCoordinate(Graph.Positions[i]);
+		int32 ClusterId;
+		if (const int32* ExistingId = ClusterLookup.Find(Coordinate))
+		{
+			ClusterId = *ExistingId;
+		}
+		else
+		{
+			ClusterId = Clusters.AddDefaulted();
+			Clusters[ClusterId].Coordinate = Coordinate;
+			ClusterLookup.Add(Coordinate, ClusterId);
+		}
+		ClusterOf[i] = ClusterId;
+		Clusters[ClusterId].NodeEnd++;
+	}
+
+	// Lay the clusters' nodes out contiguously.
+	int32 NodeCursor = 0;
+	for (FCluster& Cluster : Clusters)
+	{
+		const int32 Count = Cluster.NodeEnd;
+		Cluster.NodeBegin = NodeCursor;
+		Cluster.NodeEnd = NodeCursor;
+		NodeCursor += Count;
+	}
+	ClusterNodes.SetNumUninitialized(NumNodes);
+	LocalIndexOf.SetNumUninitialized(NumNodes);
+	for (int32 i = 0; i < NumNodes; i++)
+	{
+		FCluster& Cluster = Clusters[ClusterOf[i]];
+		LocalIndexOf[i] = Cluster.NodeEnd - Cluster.NodeBegin;
+		ClusterNodes[Cluster.NodeEnd++] = i;
+	}
+
+	// Both ends of every edge that crosses between clusters are entrances.
+	TArray<bool> IsEntrance;
+	IsEntrance.SetNumZeroed(NumNodes);
+	for (int32 i = 0; i < NumNodes; i++)
+	{
+		for (int32 Edge = Graph.GetNeighbourBegin(i); Edge < Graph.GetNeighbourEnd(i); Edge++)
+		{
+			if (ClusterOf[Graph.Neighbours[Edge]] != ClusterOf[i])
+			{
+				IsEntrance[i] = true;
+				IsEntrance[Graph.Neighbours[Edge]] = true;
+			}
+		}
+	}
+	EntranceIdOf.Init(INDEX_NONE, NumNodes);
+	int32 NumDistances = 0;
+	for (FCluster& Cluster : Clusters)
+	{
+		Cluster.EntranceBegin = Entrances.Num();
+		for (int32 i = Cluster.NodeBegin; i < Cluster.NodeEnd; i++)
+		{
+			if (IsEntrance[ClusterNodes[i]])
+			{
+				EntranceIdOf[ClusterNodes[i]] = Entrances.Add(ClusterNodes[i]);
+			}
+		}
+		Cluster.EntranceEnd = Entrances.Num();
+		Cluster.DistanceOffset = NumDistances;
+		NumDistances += (Cluster.EntranceEnd - Cluster.EntranceBegin) * Cluster.NumNodes();
+	}
+
+	// Fill in the distance tables, every cluster is independent of the others.
+	DistancesFromEntrance.SetNumUninitialized(NumDistances);
+	DistancesToEntrance.SetNumUninitialized(NumDistances);
+	ParallelFor(Clusters.Num(), [this, &Graph](int32 ClusterId)
+	{
+		static thread_local FIndexedMinHeap OpenSet;
+		const FCluster& Cluster = Clusters[ClusterId];
+		for (int32 EntranceId = Cluster.EntranceBegin; EntranceId < Cluster.EntranceEnd; EntranceId++)
+		{
+			const int32 RowOffset = Cluster.DistanceOffset + (EntranceId - Cluster.EntranceBegin) * Cluster.NumNodes();
+			SearchCluster(Graph, Cluster, Entrances[EntranceId], false, DistancesFromEntrance.GetData() + RowOffset, OpenSet);
+			SearchCluster(Graph, Cluster, Entrances[EntranceId], true, DistancesToEntrance.GetData() + RowOffset, OpenSet);
+		}
+	});
+
+	// The coarse graph links the entrances of a cluster to each other and follows the crossing edges to other clusters.
+	CoarseOffsets.Reserve(Entrances.Num() + 1);
+	for (int32 EntranceId = 0; EntranceId < Entrances.Num(); EntranceId++)
+	{
+		CoarseOffsets.Add(CoarseNeighbours.Num());
+		const int32 NodeIndex = Entrances[EntranceId];
+		const FCluster& Cluster = GetCluster(NodeIndex);
+		for (int32 OtherId = Cluster.EntranceBegin; OtherId < Cluster.EntranceEnd; OtherId++)
+		{
+			const float Distance = GetDistanceFromEntrance(EntranceId, Entrances[OtherId]);
+			if (OtherId != EntranceId && Distance < UE_MAX_FLT)
+			{
+				CoarseNeighbours.Add(OtherId);
+				CoarseCosts.Add(Distance);
+			}
+		}
+		for (int32 Edge = Graph.GetNeighbourBegin(NodeIndex); Edge < Graph.GetNeighbourEnd(NodeIndex); Edge++)
+		{
+			const int32 ConnectedIndex = Graph.Neighbours[Edge];
+			if (ClusterOf[ConnectedIndex] != ClusterOf[NodeIndex])
+			{
+				CoarseNeighbours.Add(EntranceIdOf[ConnectedIndex]);
+				CoarseCosts.Add(Graph.EdgeCosts[Edge]);
+			}
+		}
+	}
+	CoarseOffsets.Add(CoarseNeighbours.Num());
+}
+
+bool FNavigationHierarchy::ShouldSearch(int32 StartIndex, int32 EndIndex) const
+{
+	if (!IsBuilt())
+	{
+		return false;
+	}
+	const FIntPoint Offset = GetCluster(StartIndex).Coordinate - GetCluster(EndIndex).Coordinate;
+	return FMath::Abs(Offset.X) > 1 || FMath::Abs(Offset.Y) > 1;
+}
+
+bool FNavigationHierarchy::FindPath(const FNavigationGraph& Graph, int32 StartIndex, int32 EndIndex, FNavigationSearchScratch& Scratch,
+	TArray<FVector>& OutPath, int32& OutNumExpanded) const
+{
+	OutPath.Reset();
+	// Paths inside a single cluster don't have to pass through an entrance so the coarse graph can't find them.
+	check(ClusterOf[StartIndex] != ClusterOf[EndIndex]);
+
+	// The coarse search runs over entrance ids with one extra id standing in for the end node.
+	const int32 GoalId = Entrances.Num();
+	const FVector& EndLocation = Graph.Positions[EndIndex];
+	Scratch.Prepare(GoalId + 1);
+	auto Relax = [this, &Graph, &Scratch, &EndLocation, GoalId](int32 Id, int32 FromId, float GScore)
+	{
+		if (Scratch.Stamps[Id] != Scratch.CurrentStamp)
+		{
+			Scratch.Stamps[Id] = Scratch.CurrentStamp;
+			Scratch.GScores[Id] = UE_MAX_FLT;
+			Scratch.HScores[Id] = Id == GoalId ? 0.0f : FVector::Distance(Graph.Positions[Entrances[Id]], EndLocation);
+			Scratch.CameFrom[Id] = INDEX_NONE;
+		}
+		if (GScore < Scratch.GScores[Id])
+		{
+			Scratch.CameFrom[Id] = FromId;
+			Scratch.GScores[Id] = GScore;
+			Scratch.OpenSet.PushOrDecrease(Id, GScore + Scratch.HScores[Id]);
+		}
+	};
+
+	// Link the start node to the entrances of its cluster that it can reach.
+	const FCluster& StartCluster = GetCluster(StartIndex);
+	for (int32 EntranceId = StartCluster.EntranceBegin; EntranceId < StartCluster.EntranceEnd; EntranceId++)
+	{
+		const float Distance = GetDistanceToEntrance(EntranceId, StartIndex);
+		if (Distance < UE_MAX_FLT)
+		{
+			Relax(EntranceId, INDEX_NONE, Distance);
+		}
+	}
+
+	bool bFoundGoal = false;
+	while (!Scratch.OpenSet.IsEmpty())
+	{
+		const int32 CurrentId = Scratch.OpenSet.Pop();
+		if (CurrentId == GoalId)
+		{
+			bFoundGoal = true;
+			break;
+		}
+		OutNumExpanded++;
+
+		const float CurrentGScore = Scratch.GScores[CurrentId];
+		if (ClusterOf[Entrances[CurrentId]] == ClusterOf[EndIndex])
+		{
+			// Entrances of the end node's cluster link to the end node.
+			const float Distance = GetDistanceFromEntrance(CurrentId, EndIndex);
+			if (Distance < UE_MAX_FLT)
+			{
+				Relax(GoalId, CurrentId, CurrentGScore + Distance);
+			}
+		}
+		for (int32 Edge = CoarseOffsets[CurrentId]; Edge < CoarseOffsets[CurrentId + 1]; Edge++)
+		{
+			Relax(CoarseNeighbours[Edge], CurrentId, CurrentGScore + CoarseCosts[Edge]);
+		}
+		Scratch.PeakOpenSetSize = FMath::Max(Scratch.PeakOpenSetSize, Scratch.OpenSet.Num());
+	}
+	if (!bFoundGoal)
+	{
+		return false;
+	}
+
+	// Collect the entrances the path goes through, from the start to the end.
+	TArray<int32>& PathEntrances = Scratch.PathEntrances;
+	PathEntrances.Reset();
+	for (int32 Id = Scratch.CameFrom[GoalId]; Id != INDEX_NONE; Id = Scratch.CameFrom[Id])
+	{
+		PathEntrances.Add(Id);
+	}
+	Algo::Reverse(PathEntrances);
+
+	// Refine each leg through the fine graph. Legs inside a cluster follow its distance tables, legs between clusters
+	// are a single crossing edge.
+	TArray<int32>& PathNodes = Scratch.PathNodes;
+	PathNodes.Reset();
+	PathNodes.Add(StartIndex);
+	bool bRefined = AppendLegToEntrance(Graph, StartIndex, PathEntrances[0], PathNodes);
+	for (int32 i = 1; bRefined && i < PathEntrances.Num(); i++)
+	{
+		const int32 FromNode = Entrances[PathEntrances[i - 1]];
+		const int32 ToNode = Entrances[PathEntrances[i]];
+		if (ClusterOf[FromNode] == ClusterOf[ToNode])
+		{
+			bRefined = AppendLegToEntrance(Graph, FromNode, PathEntrances[i], PathNodes);
+		}
+		else
+		{
+			PathNodes.Add(ToNode);
+		}
+	}
+	bRefined = bRefined && AppendLegFromEntrance(Graph, PathEntrances.Last(), EndIndex, PathNodes);
+	if (!bRefined)
+	{
+		return false;
+	}
+
+	OutPath.Reserve(PathNodes.Num());
+	for (int32 i = PathNodes.Num() - 1; i >= 0; i--)
+	{
+		OutPath.Add(Graph.Positions[PathNodes[i]]);
+	}
+	return true;
+}
+
+SIZE_T FNavigationHierarchy::GetAllocatedSize() const
+{
+	return Clusters.GetAllocatedSize() + ClusterOf.GetAllocatedSize() + LocalIndexOf.GetAllocatedSize()
+		+ EntranceIdOf.GetAllocatedSize() + ClusterNodes.GetAllocatedSize() + Entrances.GetAllocatedSize()
+		+ DistancesFromEntrance.GetAllocatedSize() + DistancesToEntrance.GetAllocatedSize()
+		+ CoarseOffsets.GetAllocatedSize() + CoarseNeighbours.GetAllocatedSize() + CoarseCosts.GetAllocatedSize();
+}
+
+FIntPoint FNavigationHierarchy::GetClusterCoordinate(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt32(Location.X / ClusterSize), FMath::FloorToInt32(Location.Y / ClusterSize));
+}
+
+float FNavigationHierarchy::GetDistanceFromEntrance(int32 EntranceId, int32 NodeIndex) const
+{
+	const FCluster& Cluster = GetCluster(Entrances[EntranceId]);
+	return DistancesFromEntrance[Cluster.DistanceOffset + (EntranceId - Cluster.EntranceBegin) * Cluster.NumNodes() + LocalIndexOf[NodeIndex]];
+}
+
+float FNavigationHierarchy::GetDistanceToEntrance(int32 EntranceId, int32 NodeIndex) const
+{
+	const FCluster& Cluster = GetCluster(Entrances[EntranceId]);
+	return DistancesToEntrance[Cluster.DistanceOffset + (EntranceId - Cluster.EntranceBegin) * Cluster.NumNodes() + LocalIndexOf[NodeIndex]];
+}
+
+void FNavigationHierarchy::SearchCluster(const FNavigationGraph& Graph, const FCluster& Cluster, int32 SourceIndex, bool bReverse,
+	float* OutDistances, FIndexedMinHeap& OpenSet) const
+{
+	const int32 ClusterId = ClusterOf[SourceIndex];
+	for (int32 i = 0; i < Cluster.NumNodes(); i++)
+	{
+		OutDistances[i] = UE_MAX_FLT;
+	}
+	OpenSet.Reset(Cluster.NumNodes());
+
+	const TArray<int32>& Offsets = bReverse ? Graph.ReverseOffsets : Graph.NeighbourOffsets;
+	const TArray<int32>& Neighbours = bReverse ? Graph.ReverseNeighbours : Graph.Neighbours;
+	OutDistances[LocalIndexOf[SourceIndex]] = 0.0f;
+	OpenSet.PushOrDecrease(LocalIndexOf[SourceIndex], 0.0f);
+	while (!OpenSet.IsEmpty())
+	{
+		const int32 CurrentLocal = OpenSet.Pop();
+		const int32 CurrentIndex = ClusterNodes[Cluster.NodeBegin + CurrentLocal];
+		for (int32 Edge = Offsets[CurrentIndex]; Edge < Offsets[CurrentIndex + 1]; Edge++)
+		{
+			const int32 ConnectedIndex = Neighbours[Edge];
+			if (ClusterOf[ConnectedIndex] != ClusterId) continue;
+
+			const int32 ConnectedLocal = LocalIndexOf[ConnectedIndex];
+			const float Cost = bReverse ? Graph.EdgeCosts[Graph.ReverseEdges[Edge]] : Graph.EdgeCosts[Edge];
+			const float TentativeDistance = OutDistances[CurrentLocal] + Cost;
+			if (TentativeDistance < OutDistances[ConnectedLocal])
+			{
+				OutDistances[ConnectedLocal] = TentativeDistance;
+				OpenSet.PushOrDecrease(ConnectedLocal, TentativeDistance);
+			}
+		}
+	}
+}
+
+bool FNavigationHierarchy::AppendLegToEntrance(const FNavigationGraph& Graph, int32 FromIndex, int32 EntranceId, TArray<int32>& OutNodes) const
+{
+	// Step to whichever neighbour is closest to the entrance. The distances strictly shrink along the way so the leg
+	// can't take more steps than there are nodes in the cluster.
+	const int32 ClusterId = ClusterOf[FromIndex];
+	const int32 TargetIndex = Entrances[EntranceId];
+	int32 CurrentIndex = FromIndex;
+	for (int32 Step = 0; CurrentIndex != TargetIndex; Step++)
+	{
+		if (Step >= GetCluster(FromIndex).NumNodes())
+		{
+			return false;
+		}
+		int32 NextIndex = INDEX_NONE;
+		float BestDistance = UE_MAX_FLT;
+		for (int32 Edge = Graph.GetNeighbourBegin(CurrentIndex); Edge < Graph.GetNeighbourEnd(CurrentIndex); Edge++)
+		{
+			const int32 ConnectedIndex = Graph.Neighbours[Edge];
+			if (ClusterOf[ConnectedIndex] != ClusterId) continue;
+
+			const float Distance = Graph.EdgeCosts[Edge] + GetDistanceToEntrance(EntranceId, ConnectedIndex);
+			if (Distance < BestDistance)
+			{
+				BestDistance = Distance;
+				NextIndex = ConnectedIndex;
+			}
+		}
+		if (NextIndex == INDEX_NONE)
+		{
+			return false;
+		}
+		OutNodes.Add(NextIndex);
+		CurrentIndex = NextIndex;
+	}
+	return true;
+}
+
+bool FNavigationHierarchy::AppendLegFromEntrance(const FNavigationGraph& Graph, int32 EntranceId, int32 ToIndex, TArray<int32>& OutNodes) const
+{
+	// Walk backwards from the end of the leg over the incoming edges, then flip the nodes that were added the right way round.
+	const int32 ClusterId = ClusterOf[ToIndex];
+	const int32 SourceIndex = Entrances[EntranceId];
+	const int32 LegStart = OutNodes.Num();
+	int32 CurrentIndex = ToIndex;
+	while (CurrentIndex != SourceIndex)
+	{
+		if (OutNodes.Num() - LegStart >= GetCluster(ToIndex).NumNodes())
+		{
+			return false;
+		}
+		OutNodes.Add(CurrentIndex);
+		int32 PreviousIndex = INDEX_NONE;
+		float BestDistance = UE_MAX_FLT;
+		for (int32 Edge = Graph.ReverseOffsets[CurrentIndex]; Edge < Graph.ReverseOffsets[CurrentIndex + 1]; Edge++)
+		{
+			const int32 ConnectedIndex = Graph.ReverseNeighbours[Edge];
+			if (ClusterOf[ConnectedIndex] != ClusterId) continue;
+
+			const float Distance = Graph.EdgeCosts[Graph.ReverseEdges[Edge]] + GetDistanceFromEntrance(EntranceId, ConnectedIndex);
+			if (Distance < BestDistance)
+			{
+				BestDistance = Distance;
+				PreviousIndex = ConnectedIndex;
+			}
+		}
+		if (PreviousIndex == INDEX_NONE)
+		{
+			return false;
+		}
+		CurrentIndex = PreviousIndex;
+	}
+	Algo::Reverse(OutNodes.GetData() + LegStart, OutNodes.Num() - LegStart);
+	return true;
+}
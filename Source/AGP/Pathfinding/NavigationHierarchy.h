@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PathfindingHeap.h"
+
+struct FNavigationGraph;
+struct FNavigationSearchScratch;
+
+/**
+ * A two level abstraction of the navigation graph in the style of HPA*. Nodes are grouped into square clusters on the
+ * XY plane, which for the ADungeonGenerator are blocks of rooms. Nodes with an edge leaving their cluster are
+ * entrances, and the coarse graph connects the entrances by those crossing edges plus the shortest distances between
+ * the entrances of each cluster. Long queries search the coarse graph and then refine each leg through the fine graph
+ * using the per cluster distance tables, so only the cluster distances are stored and no fine path is kept around.
+ */
+class AGP_API FNavigationHierarchy
+{
+public:
+
+	/**
+	 * Groups the nodes into clusters and precomputes the distance tables and coarse graph.
+	 * @param Graph The graph to build the hierarchy for. The graph's adjacency arrays must already be built.
+	 * @param InClusterSize The width of a cluster in world units.
+	 */
+	void Build(const FNavigationGraph& Graph, float InClusterSize);
+
+	bool IsBuilt() const { return ClusterSize > 0.0f; }
+	float GetClusterSize() const { return ClusterSize; }
+
+	/**
+	 * Queries between nodes in the same or neighbouring clusters are short enough that a flat search is cheaper than
+	 * going through the coarse graph.
+	 * @return true if the query should be answered with FindPath rather than a flat search.
+	 */
+	bool ShouldSearch(int32 StartIndex, int32 EndIndex) const;
+
+	/**
+	 * Finds the shortest path by searching the coarse graph and refining the result. The path is the same length as
+	 * the one a flat search finds.
+	 * @param Scratch Working memory for the coarse search.
+	 * @param OutPath Filled with the node positions along the path, in reverse order. Emptied if there is no path.
+	 * @param OutNumExpanded Incremented by the number of coarse nodes that were expanded.
+	 * @return true if a path was found.
+	 */
+	bool FindPath(const FNavigationGraph& Graph, int32 StartIndex, int32 EndIndex, FNavigationSearchScratch& Scratch,
+		TArray<FVector>& OutPath, int32& OutNumExpanded) const;
+
+	int32 NumClusters() const { return Clusters.Num(); }
+	int32 NumEntrances() const { return Entrances.Num(); }
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	struct FCluster
+	{
+		FIntPoint Coordinate;
+		// Range of this cluster's nodes in ClusterNodes.
+		int32 NodeBegin = 0;
+		int32 NodeEnd = 0;
+		// Range of this cluster's entrances in Entrances.
+		int32 EntranceBegin = 0;
+		int32 EntranceEnd = 0;
+		// Where this cluster's distance tables start.
+		int32 DistanceOffset = 0;
+
+		int32 NumNodes() const { return NodeEnd - NodeBegin; }
+	};
+
+	FIntPoint GetClusterCoordinate(const FVector& Location) const;
+	const FCluster& GetCluster(int32 NodeIndex) const { return Clusters[ClusterOf[NodeIndex]]; }
+
+	/**
+	 * @return The distance within the cluster from the entrance to the node, or from the node to the entrance.
+	 */
+	float GetDistanceFromEntrance(int32 EntranceId, int32 NodeIndex) const;
+	float GetDistanceToEntrance(int32 EntranceId, int32 NodeIndex) const;
+
+	/**
+	 * Dijkstra from one node over the edges that stay inside its cluster.
+	 * @param bReverse Follow the edges backwards, giving the distances to the source rather than from it.
+	 * @param OutDistances Filled with the distance to every node of the cluster, by local index.
+	 */
+	void SearchCluster(const FNavigationGraph& Graph, const FCluster& Cluster, int32 SourceIndex, bool bReverse,
+		float* OutDistances, FIndexedMinHeap& OpenSet) const;
+
+	/**
+	 * Appends the nodes after FromIndex on the shortest path within the cluster to an entrance.
+	 */
+	bool AppendLegToEntrance(const FNavigationGraph& Graph, int32 FromIndex, int32 EntranceId, TArray<int32>& OutNodes) const;
+	/**
+	 * Appends the nodes after an entrance on the shortest path within the cluster to ToIndex.
+	 */
+	bool AppendLegFromEntrance(const FNavigationGraph& Graph, int32 EntranceId, int32 ToIndex, TArray<int32>& OutNodes) const;
+
+	float ClusterSize = 0.0f;
+	TArray<FCluster> Clusters;
+
+	// Per graph node: the cluster it belongs to, its index within the cluster and its entrance id if it is one.
+	TArray<int32> ClusterOf;
+	TArray<int32> LocalIndexOf;
+	TArray<int32> EntranceIdOf;
+
+	// Graph node indices grouped by cluster.
+	TArray<int32> ClusterNodes;
+	// The graph node of each entrance, grouped by cluster. An entrance id is an index into this array.
+	TArray<int32> Entrances;
+
+	// For each cluster a table with a row per entrance and a column per node of the cluster, holding the shortest
+	// distance inside the cluster from the entrance to the node and from the node to the entrance.
+	TArray<float> DistancesFromEntrance;
+	TArray<float> DistancesToEntrance;
+
+	// The coarse graph over entrance ids in compressed sparse row form.
+	TArray<int32> CoarseOffsets;
+	TArray<int32> CoarseNeighbours;
+	TArray<float> CoarseCosts;
+};
@@ -0,0 +1,212 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationIncrementalSearch.h"
+#include "Algo/Reverse.h"
+
+bool FNavigationIncrementalSearch::Start(const FNavigationGraphPtr& InGraph, int32 InStartIndex, int32 InGoalIndex)
+{
+	Graph = InGraph;
+	StartIndex = InStartIndex;
+	GoalIndex = InGoalIndex;
+	KeyModifier = 0.0f;
+	NumExpanded = 0;
+
+	if (!Graph.IsValid() || !Graph->IsValidNode(StartIndex) || !Graph->IsValidNode(GoalIndex))
+	{
+		Graph.Reset();
+		return false;
+	}
+
+	G.Init(Infinity, Graph->Num());
+	Rhs.Init(Infinity, Graph->Num());
+	OpenSet.Reset(Graph->Num());
+
+	Rhs[GoalIndex] = 0.0f;
+	OpenSet.PushOrDecrease(GoalIndex, CalculateKey(GoalIndex));
+	ComputeShortestPath();
+	return HasPath();
+}
+
+void FNavigationIncrementalSearch::MoveStart(int32 NewStartIndex)
+{
+	if (!Graph.IsValid() || !Graph->IsValidNode(NewStartIndex))
+	{
+		return;
+	}
+
+	// Keys already in the open set were made for the old start, so raise every new key by how far the start has moved
+	// instead of recomputing them all.
+	KeyModifier += FVector::Distance(Graph->Positions[StartIndex], Graph->Positions[NewStartIndex]);
+	StartIndex = NewStartIndex;
+}
+
+bool FNavigationIncrementalSearch::ApplyEdgeChanges(const FNavigationGraphPtr& NewGraph, TConstArrayView<int32> ChangedEdges)
+{
+	if (!Graph.IsValid() || !NewGraph.IsValid())
+	{
+		return false;
+	}
+	check(NewGraph->TopologyVersion == Graph->TopologyVersion);
+
+	const FNavigationGraphPtr OldGraph = Graph;
+	Graph = NewGraph;
+	for (const int32 Edge : ChangedEdges)
+	{
+		const float OldCost = OldGraph->EdgeCosts[Edge];
+		const float NewCost = Graph->EdgeCosts[Edge];
+		if (OldCost == NewCost) continue;
+
+		const int32 From = Graph->GetEdgeSource(Edge);
+		const int32 To = Graph->Neighbours[Edge];
+		if (From == GoalIndex) continue;
+
+		if (NewCost < OldCost)
+		{
+			Rhs[From] = FMath::Min(Rhs[From], AddCosts(NewCost, G[To]));
+		}
+		else if (Rhs[From] == AddCosts(OldCost, G[To]))
+		{
+			// This edge may have been the node's best way to the goal so look at all of them again.
+			Rhs[From] = LowestSuccessorCost(From);
+		}
+		UpdateNode(From);
+	}
+
+	ComputeShortestPath();
+	return HasPath();
+}
+
+bool FNavigationIncrementalSearch::GetPath(TArray<FVector>& OutPath) const
+{
+	OutPath.Reset();
+	if (!HasPath())
+	{
+		return false;
+	}
+
+	// Walk forwards from the start, always taking the edge with the lowest cost to the goal. Every node on the way
+	// strictly gets closer to the goal, but the step limit guards against a loop if the scores were ever inconsistent.
+	int32 Current = StartIndex;
+	OutPath.Add(Graph->Positions[Current]);
+	for (int32 Steps = 0; Current != GoalIndex; Steps++)
+	{
+		if (Steps >= Graph->Num())
+		{
+			OutPath.Reset();
+			return false;
+		}
+
+		int32 Best = INDEX_NONE;
+		float BestCost = Infinity;
+		for (int32 Edge = Graph->GetNeighbourBegin(Current); Edge < Graph->GetNeighbourEnd(Current); Edge++)
+		{
+			const int32 Neighbour = Graph->Neighbours[Edge];
+			const float Cost = AddCosts(Graph->EdgeCosts[Edge], G[Neighbour]);
+			if (Cost < BestCost)
+			{
+				BestCost = Cost;
+				Best = Neighbour;
+			}
+		}
+		if (Best == INDEX_NONE)
+		{
+			OutPath.Reset();
+			return false;
+		}
+
+		Current = Best;
+		OutPath.Add(Graph->Positions[Current]);
+	}
+
+	Algo::Reverse(OutPath);
+	return true;
+}
+
+float FNavigationIncrementalSearch::Heuristic(int32 Index) const
+{
+	return FVector::Distance(Graph->Positions[StartIndex], Graph->Positions[Index]);
+}
+
+FNavigationIncrementalSearch::FKey FNavigationIncrementalSearch::CalculateKey(int32 Index) const
+{
+	const float Best = FMath::Min(G[Index], Rhs[Index]);
+	return { AddCosts(AddCosts(Best, Heuristic(Index)), KeyModifier), Best };
+}
+
+float FNavigationIncrementalSearch::LowestSuccessorCost(int32 Index) const
+{
+	float Lowest = Infinity;
+	for (int32 Edge = Graph->GetNeighbourBegin(Index); Edge < Graph->GetNeighbourEnd(Index); Edge++)
+	{
+		Lowest = FMath::Min(Lowest, AddCosts(Graph->EdgeCosts[Edge], G[Graph->Neighbours[Edge]]));
+	}
+	return Lowest;
+}
+
+void FNavigationIncrementalSearch::UpdateNode(int32 Index)
+{
+	if (G[Index] != Rhs[Index])
+	{
+		OpenSet.PushOrUpdate(Index, CalculateKey(Index));
+	}
+	else
+	{
+		OpenSet.Remove(Index);
+	}
+}
+
+void FNavigationIncrementalSearch::ComputeShortestPath()
+{
+	const FNavigationGraph& NavGraph = *Graph;
+	while (!OpenSet.IsEmpty() && (OpenSet.TopKey() < CalculateKey(StartIndex) || Rhs[StartIndex] > G[StartIndex]))
+	{
+		const int32 Current = OpenSet.Top();
+		const FKey OldKey = OpenSet.TopKey();
+		const FKey NewKey = CalculateKey(Current);
+
+		if (OldKey < NewKey)
+		{
+			// The key is out of date because the start has moved since it was pushed.
+			OpenSet.PushOrUpdate(Current, NewKey);
+			continue;
+		}
+
+		OpenSet.Pop();
+		NumExpanded++;
+
+		if (G[Current] > Rhs[Current])
+		{
+			// The node got closer to the goal. Its predecessors may now be able to get there more cheaply through it.
+			G[Current] = Rhs[Current];
+			for (int32 i = NavGraph.ReverseOffsets[Current]; i < NavGraph.ReverseOffsets[Current + 1]; i++)
+			{
+				const int32 Predecessor = NavGraph.ReverseNeighbours[i];
+				if (Predecessor == GoalIndex) continue;
+
+				Rhs[Predecessor] = FMath::Min(Rhs[Predecessor], AddCosts(NavGraph.EdgeCosts[NavGraph.ReverseEdges[i]], G[Current]));
+				UpdateNode(Predecessor);
+			}
+		}
+		else
+		{
+			// The node got further from the goal. Anything whose best route went through it has to look again.
+			const float OldG = G[Current];
+			G[Current] = Infinity;
+			for (int32 i = NavGraph.ReverseOffsets[Current]; i < NavGraph.ReverseOffsets[Current + 1]; i++)
+			{
+				const int32 Predecessor = NavGraph.ReverseNeighbours[i];
+				if (Predecessor != GoalIndex && Rhs[Predecessor] == AddCosts(NavGraph.EdgeCosts[NavGraph.ReverseEdges[i]], OldG))
+				{
+					Rhs[Predecessor] = LowestSuccessorCost(Predecessor);
+				}
+				UpdateNode(Predecessor);
+			}
+			if (Current != GoalIndex)
+			{
+				Rhs[Current] = LowestSuccessorCost(Current);
+			}
+			UpdateNode(Current);
+		}
+	}
+}
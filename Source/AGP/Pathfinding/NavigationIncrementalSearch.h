@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavigationGraph.h"
+#include "PathfindingHeap.h"
+
+/**
+ * D* Lite over FNavigationGraph snapshots. The search runs backwards from the goal so that its scores stay valid while
+ * the start moves along the path, and when edge costs change only the nodes whose distance to the goal is affected are
+ * expanded again rather than searching from scratch. Only snapshots that share the same topology can be swapped in,
+ * which is the case for the ones made by FNavigationGraph::WithEdgeCosts.
+ */
+class AGP_API FNavigationIncrementalSearch
+{
+public:
+
+	/**
+	 * Throws away any previous state and searches for the shortest path between two nodes.
+	 * @return true if a path was found.
+	 */
+	bool Start(const FNavigationGraphPtr& InGraph, int32 InStartIndex, int32 InGoalIndex);
+
+	/**
+	 * Moves the start of the path, usually to the next node the agent has reached. The goal stays the same. Nothing is
+	 * searched until the next ApplyEdgeChanges, so a start that has moved off the path needs one before GetPath.
+	 */
+	void MoveStart(int32 NewStartIndex);
+
+	/**
+	 * Switches to a snapshot with some edge costs changed and repairs the path from the current start. ChangedEdges
+	 * can be empty to only catch up with the start having moved.
+	 * @param NewGraph The new snapshot. Must have the same TopologyVersion as the current one.
+	 * @param ChangedEdges The indices of the edges whose cost differs between the two snapshots.
+	 * @return true if there is still a path.
+	 */
+	bool ApplyEdgeChanges(const FNavigationGraphPtr& NewGraph, TConstArrayView<int32> ChangedEdges);
+
+	/**
+	 * Fills OutPath with the node positions from the goal back to the start, or empties it if there is no path.
+	 * @return true if there is a path.
+	 */
+	bool GetPath(TArray<FVector>& OutPath) const;
+
+	bool HasPath() const { return Graph.IsValid() && G[StartIndex] < Infinity; }
+	int32 GetStartIndex() const { return StartIndex; }
+	int32 GetGoalIndex() const { return GoalIndex; }
+	const FNavigationGraphPtr& GetGraph() const { return Graph; }
+
+	/**
+	 * @return The number of nodes expanded since Start was last called.
+	 */
+	int32 GetNumExpanded() const { return NumExpanded; }
+
+private:
+
+	static constexpr float Infinity = FNavigationGraph::BlockedCost;
+
+	struct FKey
+	{
+		float Primary;
+		float Secondary;
+
+		bool operator<(const FKey& Other) const
+		{
+			return Primary < Other.Primary || (Primary == Other.Primary && Secondary < Other.Secondary);
+		}
+	};
+
+	// Adds two costs, staying at Infinity rather than overflowing.
+	static float AddCosts(float A, float B) { return A >= Infinity || B >= Infinity ? Infinity : A + B; }
+
+	float Heuristic(int32 Index) const;
+	FKey CalculateKey(int32 Index) const;
+	// The best cost to the goal through any of the node's outgoing edges.
+	float LowestSuccessorCost(int32 Index) const;
+	void UpdateNode(int32 Index);
+	void ComputeShortestPath();
+
+	FNavigationGraphPtr Graph;
+	int32 StartIndex = INDEX_NONE;
+	int32 GoalIndex = INDEX_NONE;
+	// How far the start has moved in total, added to every new key so the old ones do not need to be recomputed.
+	float KeyModifier = 0.0f;
+	int32 NumExpanded = 0;
+
+	// The distance to the goal of every node, and the one step lookahead of it. Nodes where they differ are in the
+	// open set.
+	TArray<float> G;
+	TArray<float> Rhs;
+	TIndexedMinHeap<FKey> OpenSet;
+};
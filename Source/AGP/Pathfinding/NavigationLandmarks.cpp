@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationLandmarks.h"
+#include "NavigationGraph.h"
+#include "PathfindingHeap.h"
+#include "Async/ParallelFor.h"
+
+void FNavigationLandmarks::Build(const FNavigationGraph& Graph, int32 InNumLandmarks)
+{
+	*this = FNavigationLandmarks();
+	const int32 NumNodes = Graph.Num();
+	if (InNumLandmarks <= 0 || NumNodes == 0)
+	{
+		return;
+	}
+	NumLandmarks = FMath::Min(InNumLandmarks, NumNodes);
+	FromLandmark.SetNumUninitialized(NumNodes * NumLandmarks);
+	ToLandmark.SetNumUninitialized(NumNodes * NumLandmarks);
+
+	// Farthest point selection: every landmark is the node furthest from the landmarks before it, which needs the
+	// search from each landmark before the next can be picked. Starting from the node furthest from an arbitrary one
+	// puts the first landmark on the edge of the graph.
+	TArray<float> ClosestLandmark;
+	ClosestLandmark.Init(Unreachable, NumNodes);
+	int32 NextLandmark = FMath::Max(0, Graph.FindFurthestNode(Graph.Positions[0]));
+	for (int32 i = 0; i < NumLandmarks; i++)
+	{
+		LandmarkNodes.Add(NextLandmark);
+		Search(Graph, NextLandmark, false, &FromLandmark[i], NumLandmarks);
+
+		// Nodes that none of the landmarks so far can reach count as furthest away, so every part of a disconnected
+		// graph gets a landmark before any part gets a second one.
+		float FurthestDistance = -1.0f;
+		for (int32 Node = 0; Node < NumNodes; Node++)
+		{
+			ClosestLandmark[Node] = FMath::Min(ClosestLandmark[Node], FromLandmark[Node * NumLandmarks + i]);
+			if (ClosestLandmark[Node] > FurthestDistance && !LandmarkNodes.Contains(Node))
+			{
+				FurthestDistance = ClosestLandmark[Node];
+				NextLandmark = Node;
+			}
+		}
+	}
+
+	// The searches towards the landmarks don't affect which are picked, so they can all run at once.
+	ParallelFor(NumLandmarks, [this, &Graph](int32 i)
+	{
+		Search(Graph, LandmarkNodes[i], true, &ToLandmark[i], NumLandmarks);
+	});
+}
+
+void FNavigationLandmarks::Search(const FNavigationGraph& Graph, int32 SourceIndex, bool bReverse, float* OutDistances, int32 Stride)
+{
+	static thread_local FIndexedMinHeap OpenSet;
+	const int32 NumNodes = Graph.Num();
+	for (int32 i = 0; i < NumNodes; i++)
+	{
+		OutDistances[i * Stride] = Unreachable;
+	}
+	OpenSet.Reset(NumNodes);
+
+	OutDistances[SourceIndex * Stride] = 0.0f;
+	OpenSet.PushOrDecrease(SourceIndex, 0.0f);
+	while (!OpenSet.IsEmpty())
+	{
+		const int32 CurrentIndex = OpenSet.Pop();
+		const float CurrentDistance = OutDistances[CurrentIndex * Stride];
+		const int32 Begin = bReverse ? Graph.ReverseOffsets[CurrentIndex] : Graph.GetNeighbourBegin(CurrentIndex);
+		const int32 End = bReverse ? Graph.ReverseOffsets[CurrentIndex + 1] : Graph.GetNeighbourEnd(CurrentIndex);
+		for (int32 i = Begin; i < End; i++)
+		{
+			const int32 Edge = bReverse ? Graph.ReverseEdges[i] : i;
+			const int32 ConnectedIndex = bReverse ? Graph.ReverseNeighbours[i] : Graph.Neighbours[i];
+			// Blocked edges count at their normal length, so the distances are lower bounds whatever gets blocked.
+			const float Cost = Graph.IsEdgeBlocked(Edge)
+				? FVector::Distance(Graph.Positions[CurrentIndex], Graph.Positions[ConnectedIndex]) : Graph.EdgeCosts[Edge];
+			const float TentativeDistance = CurrentDistance + Cost;
+			if (TentativeDistance < OutDistances[ConnectedIndex * Stride])
+			{
+				OutDistances[ConnectedIndex * Stride] = TentativeDistance;
+				OpenSet.PushOrDecrease(ConnectedIndex, TentativeDistance);
+			}
+		}
+	}
+}
+
+void FNavigationLandmarks::Serialize(FArchive& Ar, int32 NumNodes)
+{
+	Ar << NumLandmarks;
+	LandmarkNodes.BulkSerialize(Ar);
+	FromLandmark.BulkSerialize(Ar);
+	ToLandmark.BulkSerialize(Ar);
+	if (Ar.IsLoading() && (NumLandmarks < 0 || LandmarkNodes.Num() != NumLandmarks
+		|| FromLandmark.Num() != NumNodes * NumLandmarks || ToLandmark.Num() != NumNodes * NumLandmarks))
+	{
+		Ar.SetError();
+		*this = FNavigationLandmarks();
+	}
+}
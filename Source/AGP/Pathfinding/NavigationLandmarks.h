@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FNavigationGraph;
+
+/**
+ * Precomputed distances to and from a handful of landmark nodes, which give A* a lower bound on the distance between
+ * any two nodes through the triangle inequality (ALT). In dungeons where corridors force long detours the bound is far
+ * tighter than the straight line distance, so much less of the graph is expanded. The distances are worked out with
+ * every edge at its unblocked length, so they stay lower bounds however edges are blocked and can be shared by every
+ * snapshot with the same topology.
+ */
+class AGP_API FNavigationLandmarks
+{
+public:
+
+	/**
+	 * Picks the landmarks, each as far as possible from the ones before it, and runs a Dijkstra search to and from
+	 * each of them.
+	 * @param Graph The graph to build the landmarks for. The graph's adjacency arrays must already be built.
+	 * @param InNumLandmarks How many landmarks to pick. Each one costs 8 bytes per node.
+	 */
+	void Build(const FNavigationGraph& Graph, int32 InNumLandmarks);
+
+	bool IsBuilt() const { return NumLandmarks > 0; }
+	int32 GetNumLandmarks() const { return NumLandmarks; }
+	const TArray<int32>& GetLandmarkNodes() const { return LandmarkNodes; }
+
+	/**
+	 * @return A lower bound on the length of the shortest path from Index to EndIndex. 0 if no landmark can tell.
+	 */
+	float GetLowerBound(int32 Index, int32 EndIndex) const
+	{
+		const float* FromNode = &FromLandmark[Index * NumLandmarks];
+		const float* FromEnd = &FromLandmark[EndIndex * NumLandmarks];
+		const float* ToNode = &ToLandmark[Index * NumLandmarks];
+		const float* ToEnd = &ToLandmark[EndIndex * NumLandmarks];
+		float Bound = 0.0f;
+		for (int32 i = 0; i < NumLandmarks; i++)
+		{
+			// The landmark can't reach the end any quicker than through the node, and the node can't reach the landmark
+			// any quicker than through the end. Landmarks that can't reach or be reached from both say nothing.
+			if (FromNode[i] < Unreachable && FromEnd[i] < Unreachable)
+			{
+				Bound = FMath::Max(Bound, FromEnd[i] - FromNode[i]);
+			}
+			if (ToNode[i] < Unreachable && ToEnd[i] < Unreachable)
+			{
+				Bound = FMath::Max(Bound, ToNode[i] - ToEnd[i]);
+			}
+		}
+		return Bound;
+	}
+
+	/**
+	 * Reads or writes the landmarks for a baked graph. Tables that don't match NumNodes set an error on the archive
+	 * when loaded and are left empty.
+	 */
+	void Serialize(FArchive& Ar, int32 NumNodes);
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return LandmarkNodes.GetAllocatedSize() + FromLandmark.GetAllocatedSize() + ToLandmark.GetAllocatedSize();
+	}
+
+private:
+
+	static constexpr float Unreachable = UE_MAX_FLT;
+
+	/**
+	 * Dijkstra from or to one node over the unblocked edge lengths.
+	 * @param OutDistances Written with the distance of every node at Stride apart.
+	 */
+	static void Search(const FNavigationGraph& Graph, int32 SourceIndex, bool bReverse, float* OutDistances, int32 Stride);
+
+	int32 NumLandmarks = 0;
+	TArray<int32> LandmarkNodes;
+	// The distance from each landmark to each node and from each node to each landmark, with the landmarks of a node
+	// next to each other so that a bound only reads two short runs.
+	TArray<float> FromLandmark;
+	TArray<float> ToLandmark;
+};
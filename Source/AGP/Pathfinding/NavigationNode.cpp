@@ -2,13 +2,14 @@
 
 
 #include "NavigationNode.h"
+#include "PathfindingSubsystem.h"
 
 // Sets default values
 ANavigationNode::ANavigationNode()
 {
-	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
-	PrimaryActorTick.bStartWithTickEnabled = true;
+	// Nodes never tick. The whole graph is drawn in one batch by the UPathfindingSubsystem, in editor viewports as well
+	// as in game, when AGP.Pathfinding.DrawGraph is on.
+	PrimaryActorTick.bCanEverTick = false;
 
 	bNetLoadOnClient = false;
 
@@ -21,38 +22,38 @@ ANavigationNode::ANavigationNode()
 void ANavigationNode::BeginPlay()
 {
 	Super::BeginPlay();
-	
 }
 
-// Called every frame
-void ANavigationNode::Tick(float DeltaTime)
+void ANavigationNode::Destroyed()
 {
-	Super::Tick(DeltaTime);
+	Super::Destroyed();
+	NotifyGraphChanged();
+}
 
-	FColor SphereColor = FColor::Blue;
-	if (ConnectedNodes.Contains(this))
+#if WITH_EDITOR
+void ANavigationNode::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	NotifyGraphChanged();
+}
+
+void ANavigationNode::PostEditMove(bool bFinished)
+{
+	Super::PostEditMove(bFinished);
+	if (bFinished)
 	{
-		SphereColor = FColor::Red;
+		NotifyGraphChanged();
 	}
-	
-	DrawDebugSphere(GetWorld(), GetActorLocation(), 50.0f, 4, SphereColor, false, -1, 0, 5.0f);
-	
-	for (const ANavigationNode* ConnectedNode : ConnectedNodes)
+}
+#endif
+
+void ANavigationNode::NotifyGraphChanged() const
+{
+	if (UWorld* World = GetWorld())
 	{
-		if (ConnectedNode)
+		if (UPathfindingSubsystem* PathfindingSubsystem = World->GetSubsystem<UPathfindingSubsystem>())
 		{
-			FColor LineColor = FColor::Red;
-			if (ConnectedNode->ConnectedNodes.Contains(this))
-			{
-				LineColor = FColor::Green;
-			}
-			DrawDebugLine(GetWorld(), GetActorLocation(), ConnectedNode->GetActorLocation(),
-				LineColor, false, -1, 0, 5.0f);
+			PathfindingSubsystem->MarkGraphDirty();
 		}
 	}
 }
-
-bool ANavigationNode::ShouldTickIfViewportsOnly() const
-{
-	return true;
-}
\ No newline at end of file
@@ -6,18 +6,38 @@
 #include "GameFramework/Actor.h"
 #include "NavigationNode.generated.h"
 
+/**
+ * What a navigation node represents. Stored with every node so that it can be checked in constant time in any build,
+ * unlike the actor label.
+ */
+UENUM(BlueprintType)
+enum class ENavigationNodeKind : uint8
+{
+	Room,
+	Corridor,
+	HidingSpot,
+	Spawn
+};
+
 UCLASS()
 class AGP_API ANavigationNode : public AActor
 {
 	GENERATED_BODY()
 
 	friend class UPathfindingSubsystem;
+#if !UE_BUILD_SHIPPING
+	friend class FPathfindingBenchmark;
+#endif
 	
 public:	
 	// Sets default values for this actor's properties
 	ANavigationNode();
 
-	virtual bool ShouldTickIfViewportsOnly() const override;
+	virtual void Destroyed() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+	virtual void PostEditMove(bool bFinished) override;
+#endif
 
 protected:
 	// Called when the game starts or when spawned
@@ -25,11 +45,25 @@ protected:
 
 	UPROPERTY(EditAnywhere)
 	TArray<ANavigationNode*> ConnectedNodes;
+	UPROPERTY(EditAnywhere)
+	ENavigationNodeKind NodeKind = ENavigationNodeKind::Room;
+	// A blocked node can't be walked into or out of, for example while a door is shut. The connections are kept so the
+	// node can be unblocked without rebuilding the graph.
+	UPROPERTY(EditAnywhere)
+	bool bBlocked = false;
+	// Connected nodes that can't currently be reached from this node or reach it.
+	UPROPERTY(EditAnywhere)
+	TArray<ANavigationNode*> BlockedConnections;
 	UPROPERTY(VisibleAnywhere)
 	USceneComponent* LocationComponent;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	// Dense index of this node in the UPathfindingSubsystem's Nodes array. Assigned by the subsystem whenever the
+	// node list changes and used to index the per-node search arrays.
+	int32 NodeIndex = INDEX_NONE;
+
+	/**
+	 * Lets the UPathfindingSubsystem know that its graph snapshot no longer matches the node actors.
+	 */
+	void NotifyGraphChanged() const;
 
 };
\ No newline at end of file
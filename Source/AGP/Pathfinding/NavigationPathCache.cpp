@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationPathCache.h"
+
+void FNavigationPathCache::SetCapacity(int32 NewCapacity)
+{
+	NewCapacity = FMath::Max(0, NewCapacity);
+	if (NewCapacity < Lookup.Num())
+	{
+		// Rather than compacting the entry array just start again, shrinking the cache is rare.
+		Empty();
+	}
+	Capacity = NewCapacity;
+}
+
+const TArray<FVector>* FNavigationPathCache::Find(uint32 GraphVersion, int32 StartIndex, int32 EndIndex)
+{
+	if (SyncVersion(GraphVersion))
+	{
+		if (const int32* EntryIndex = Lookup.Find(MakeKey(StartIndex, EndIndex)))
+		{
+			NumHits++;
+			Unlink(*EntryIndex);
+			LinkAsNewest(*EntryIndex);
+			return &Entries[*EntryIndex].Path;
+		}
+	}
+	NumMisses++;
+	return nullptr;
+}
+
+void FNavigationPathCache::Add(uint32 GraphVersion, int32 StartIndex, int32 EndIndex, const TArray<FVector>& Path)
+{
+	if (Capacity == 0 || !SyncVersion(GraphVersion))
+	{
+		return;
+	}
+
+	const uint64 Key = MakeKey(StartIndex, EndIndex);
+	int32 EntryIndex;
+	if (const int32* ExistingIndex = Lookup.Find(Key))
+	{
+		EntryIndex = *ExistingIndex;
+		Unlink(EntryIndex);
+	}
+	else if (Lookup.Num() < Capacity)
+	{
+		EntryIndex = Entries.AddDefaulted();
+		Lookup.Add(Key, EntryIndex);
+	}
+	else
+	{
+		// Reuse the least recently used entry, its path array keeps its allocation.
+		EntryIndex = Oldest;
+		Unlink(EntryIndex);
+		Lookup.Remove(Entries[EntryIndex].Key);
+		Lookup.Add(Key, EntryIndex);
+	}
+
+	FEntry& Entry = Entries[EntryIndex];
+	Entry.Key = Key;
+	// Copying into the existing array keeps its allocation when it is already big enough, assigning may not.
+	Entry.Path.Reset();
+	Entry.Path.Append(Path);
+	LinkAsNewest(EntryIndex);
+}
+
+void FNavigationPathCache::Empty()
+{
+	Entries.Reset();
+	Lookup.Reset();
+	Newest = INDEX_NONE;
+	Oldest = INDEX_NONE;
+}
+
+bool FNavigationPathCache::SyncVersion(uint32 GraphVersion)
+{
+	if (GraphVersion == Version)
+	{
+		return true;
+	}
+	if (GraphVersion < Version)
+	{
+		return false;
+	}
+	Empty();
+	Version = GraphVersion;
+	return true;
+}
+
+void FNavigationPathCache::Unlink(int32 EntryIndex)
+{
+	FEntry& Entry = Entries[EntryIndex];
+	if (Entry.Newer != INDEX_NONE)
+	{
+		Entries[Entry.Newer].Older = Entry.Older;
+	}
+	else
+	{
+		Newest = Entry.Older;
+	}
+	if (Entry.Older != INDEX_NONE)
+	{
+		Entries[Entry.Older].Newer = Entry.Newer;
+	}
+	else
+	{
+		Oldest = Entry.Newer;
+	}
+	Entry.Newer = INDEX_NONE;
+	Entry.Older = INDEX_NONE;
+}
+
+void FNavigationPathCache::LinkAsNewest(int32 EntryIndex)
+{
+	FEntry& Entry = Entries[EntryIndex];
+	Entry.Newer = INDEX_NONE;
+	Entry.Older = Newest;
+	if (Newest != INDEX_NONE)
+	{
+		Entries[Newest].Newer = EntryIndex;
+	}
+	Newest = EntryIndex;
+	if (Oldest == INDEX_NONE)
+	{
+		Oldest = EntryIndex;
+	}
+}
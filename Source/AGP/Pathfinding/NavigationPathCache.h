@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * A least recently used cache of reconstructed paths keyed by their start and end node. Every entry belongs to one
+ * graph version, and the whole cache is dropped as soon as it is used with a newer version, so a path is never handed
+ * out for a graph it was not found on. Only meant to be used from the game thread.
+ */
+class AGP_API FNavigationPathCache
+{
+public:
+
+	/**
+	 * Sets the most paths the cache will hold, evicting the least recently used ones if there are too many.
+	 */
+	void SetCapacity(int32 NewCapacity);
+
+	/**
+	 * Looks up a path and marks it as the most recently used one.
+	 * @param GraphVersion The version of the graph the caller is querying.
+	 * @param StartIndex The start node of the path.
+	 * @param EndIndex The end node of the path.
+	 * @return The cached path, which may be empty if there was no path, or nullptr if it is not in the cache. Only valid
+	 * until the cache is next modified.
+	 */
+	const TArray<FVector>* Find(uint32 GraphVersion, int32 StartIndex, int32 EndIndex);
+
+	/**
+	 * Adds a path to the cache. Paths found on an older graph version than the cache currently holds are ignored.
+	 */
+	void Add(uint32 GraphVersion, int32 StartIndex, int32 EndIndex, const TArray<FVector>& Path);
+
+	/**
+	 * Removes every cached path.
+	 */
+	void Empty();
+
+	int32 Num() const { return Lookup.Num(); }
+	uint64 GetNumHits() const { return NumHits; }
+	uint64 GetNumMisses() const { return NumMisses; }
+
+private:
+
+	struct FEntry
+	{
+		uint64 Key;
+		TArray<FVector> Path;
+		// Neighbours in the recency list, towards the most and least recently used ends.
+		int32 Newer = INDEX_NONE;
+		int32 Older = INDEX_NONE;
+	};
+
+	static uint64 MakeKey(int32 StartIndex, int32 EndIndex)
+	{
+		return (static_cast<uint64>(static_cast<uint32>(StartIndex)) << 32) | static_cast<uint32>(EndIndex);
+	}
+
+	/**
+	 * Drops the cache if the graph has moved on to a newer version.
+	 * @return false if GraphVersion is older than the cache and should not be used with it.
+	 */
+	bool SyncVersion(uint32 GraphVersion);
+	void Unlink(int32 EntryIndex);
+	void LinkAsNewest(int32 EntryIndex);
+
+	TArray<FEntry> Entries;
+	TMap<uint64, int32> Lookup;
+	int32 Newest = INDEX_NONE;
+	int32 Oldest = INDEX_NONE;
+	uint32 Version = 0;
+	int32 Capacity = 256;
+	uint64 NumHits = 0;
+	uint64 NumMisses = 0;
+};
@@ -0,0 +1,18 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationPathPool.h"
+
+TArray<FVector> FNavigationPathPool::Acquire()
+{
+	return FreePaths.IsEmpty() ? TArray<FVector>() : FreePaths.Pop(false);
+}
+
+void FNavigationPathPool::Release(TArray<FVector>&& Path)
+{
+	if (FreePaths.Num() < MaxPooledPaths && Path.Max() > 0)
+	{
+		Path.Reset();
+		FreePaths.Add(MoveTemp(Path));
+	}
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Path arrays that have already been handed out and given back, so the next path can be written into memory that is
+ * already big enough instead of allocating. Once every buffer has grown to the length of the longest path, handing
+ * out paths doesn't allocate at all. Only meant to be used from the game thread.
+ */
+class AGP_API FNavigationPathPool
+{
+public:
+
+	/**
+	 * @return An empty path, with the allocation of one that was given back if there are any.
+	 */
+	TArray<FVector> Acquire();
+
+	/**
+	 * Gives a path back to be reused. Paths past the most the pool holds are freed instead.
+	 */
+	void Release(TArray<FVector>&& Path);
+
+	int32 GetNumPooled() const { return FreePaths.Num(); }
+
+private:
+
+	// More than the paths solved in a typical frame, so steady state repathing never frees a buffer.
+	static constexpr int32 MaxPooledPaths = 256;
+
+	TArray<TArray<FVector>> FreePaths;
+};
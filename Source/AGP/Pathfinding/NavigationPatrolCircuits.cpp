@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationPatrolCircuits.h"
+#include "NavigationGraph.h"
+
+void FNavigationPatrolCircuits::Build(const FNavigationGraph& Graph, int32 InNumVariants, int32 Seed)
+{
+	*this = FNavigationPatrolCircuits();
+	if (InNumVariants <= 0 || Graph.Num() == 0)
+	{
+		return;
+	}
+	NumVariants = InNumVariants;
+	NumNodes = Graph.Num();
+	NodeCircuits.Init(INDEX_NONE, NumVariants * NumNodes);
+	NodeSteps.Init(INDEX_NONE, NumVariants * NumNodes);
+	CircuitOffsets.Add(0);
+
+	// A circuit walks back along every edge it goes down, so it can only use edges that are open both ways.
+	TBitArray<> TwoWayEdges(false, Graph.NumEdges());
+	for (int32 Node = 0; Node < NumNodes; Node++)
+	{
+		for (int32 Edge = Graph.GetNeighbourBegin(Node); Edge < Graph.GetNeighbourEnd(Node); Edge++)
+		{
+			const int32 ReverseEdge = Graph.FindEdge(Graph.Neighbours[Edge], Node);
+			TwoWayEdges[Edge] = !Graph.IsEdgeBlocked(Edge) && ReverseEdge != INDEX_NONE && !Graph.IsEdgeBlocked(ReverseEdge);
+		}
+	}
+
+	TBitArray<> Visited;
+	TArray<int32> Stack;
+	TArray<int32> Candidates;
+	for (int32 Variant = 0; Variant < NumVariants; Variant++)
+	{
+		FRandomStream Random(Seed + Variant);
+		Visited.Init(false, NumNodes);
+
+		// Every node that hasn't been reached yet starts the circuit of a new connected part. Starting from a different
+		// node in each variant moves where the laps begin.
+		const int32 FirstRoot = Random.RandHelper(NumNodes);
+		for (int32 i = 0; i < NumNodes; i++)
+		{
+			const int32 Root = (FirstRoot + i) % NumNodes;
+			if (Visited[Root]) continue;
+
+			const int32 CircuitStart = CircuitNodes.Num();
+			Visited[Root] = true;
+			Stack.Reset();
+			Stack.Add(Root);
+			CircuitNodes.Add(Root);
+			while (!Stack.IsEmpty())
+			{
+				// Go down a random edge to a node that isn't on the tree yet, or back up to the parent once there are none.
+				const int32 Current = Stack.Last();
+				Candidates.Reset();
+				for (int32 Edge = Graph.GetNeighbourBegin(Current); Edge < Graph.GetNeighbourEnd(Current); Edge++)
+				{
+					if (TwoWayEdges[Edge] && !Visited[Graph.Neighbours[Edge]])
+					{
+						Candidates.Add(Graph.Neighbours[Edge]);
+					}
+				}
+				if (!Candidates.IsEmpty())
+				{
+					const int32 Next = Candidates[Random.RandHelper(Candidates.Num())];
+					Visited[Next] = true;
+					Stack.Add(Next);
+					CircuitNodes.Add(Next);
+				}
+				else
+				{
+					Stack.Pop(false);
+					if (!Stack.IsEmpty())
+					{
+						CircuitNodes.Add(Stack.Last());
+					}
+				}
+			}
+			// The walk ends back at the root, which is where the next lap starts anyway.
+			CircuitNodes.Pop(false);
+
+			// A node on its own has nowhere to patrol to.
+			if (CircuitNodes.Num() - CircuitStart < 2)
+			{
+				CircuitNodes.SetNum(CircuitStart, false);
+				continue;
+			}
+			const int32 Circuit = CircuitOffsets.Num() - 1;
+			for (int32 Step = CircuitNodes.Num() - CircuitStart - 1; Step >= 0; Step--)
+			{
+				// Going backwards leaves each node with the first step it comes up at.
+				const int32 Slot = Variant * NumNodes + CircuitNodes[CircuitStart + Step];
+				NodeCircuits[Slot] = Circuit;
+				NodeSteps[Slot] = Step;
+			}
+			CircuitOffsets.Add(CircuitNodes.Num());
+		}
+	}
+}
+
+bool FNavigationPatrolCircuits::FindStep(int32 Variant, int32 NodeIndex, int32& OutCircuit, int32& OutStep) const
+{
+	if (Variant < 0 || Variant >= NumVariants || NodeIndex < 0 || NodeIndex >= NumNodes)
+	{
+		return false;
+	}
+	OutCircuit = NodeCircuits[Variant * NumNodes + NodeIndex];
+	OutStep = NodeSteps[Variant * NumNodes + NodeIndex];
+	return OutCircuit != INDEX_NONE;
+}
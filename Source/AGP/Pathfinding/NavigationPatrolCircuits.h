@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FNavigationGraph;
+
+/**
+ * Where an agent is on a patrol circuit.
+ */
+struct FNavigationPatrolRoute
+{
+	int32 Circuit = INDEX_NONE;
+	int32 Step = 0;
+	// The build of the circuits that Circuit and Step refer to.
+	uint32 CircuitsVersion = 0;
+
+	bool IsValid() const { return Circuit != INDEX_NONE; }
+};
+
+/**
+ * Closed patrol loops over the navigation graph, so a patrolling agent only has to step to the next node of its loop
+ * instead of searching for a path to a random node every time it arrives. Each loop is a walk around a random depth
+ * first spanning tree of one connected part of the graph, going down every branch and back, so it visits every node of
+ * that part at least once per lap. A few variants are built with differently shuffled trees so that agents sharing a
+ * part of the graph take different routes through it. Consecutive steps, including the last and first, are always
+ * joined by an edge that was open in both directions when the loops were built.
+ */
+class AGP_API FNavigationPatrolCircuits
+{
+public:
+
+	/**
+	 * Walks a random spanning tree of every connected part of the graph for each variant.
+	 * @param Graph The graph to build the circuits over.
+	 * @param InNumVariants How many differently shuffled circuits to build through each part of the graph.
+	 * @param Seed Seeds the shuffling, so the same graph and seed always give the same circuits.
+	 */
+	void Build(const FNavigationGraph& Graph, int32 InNumVariants, int32 Seed);
+
+	bool IsBuilt() const { return NumVariants > 0; }
+	int32 GetNumVariants() const { return NumVariants; }
+	int32 GetNumCircuits() const { return FMath::Max(0, CircuitOffsets.Num() - 1); }
+	int32 GetCircuitLength(int32 Circuit) const { return CircuitOffsets[Circuit + 1] - CircuitOffsets[Circuit]; }
+
+	/**
+	 * @return The node at a step of a circuit.
+	 */
+	int32 GetNode(int32 Circuit, int32 Step) const { return CircuitNodes[CircuitOffsets[Circuit] + Step]; }
+
+	/**
+	 * Finds where a node first comes up on the circuit of one of the variants.
+	 * @param OutCircuit Set to the circuit that goes through the node.
+	 * @param OutStep Set to the step of that circuit the node is at.
+	 * @return false if the node isn't on any circuit, which is the case when none of its edges are open both ways.
+	 */
+	bool FindStep(int32 Variant, int32 NodeIndex, int32& OutCircuit, int32& OutStep) const;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return CircuitOffsets.GetAllocatedSize() + CircuitNodes.GetAllocatedSize() + NodeCircuits.GetAllocatedSize()
+			+ NodeSteps.GetAllocatedSize();
+	}
+
+private:
+
+	int32 NumVariants = 0;
+	int32 NumNodes = 0;
+	// The steps of circuit i are CircuitNodes[CircuitOffsets[i]] to CircuitNodes[CircuitOffsets[i+1]-1].
+	TArray<int32> CircuitOffsets;
+	TArray<int32> CircuitNodes;
+	// The circuit and first step of each node in each variant, at Variant * NumNodes + NodeIndex. INDEX_NONE for nodes
+	// that aren't on a circuit.
+	TArray<int32> NodeCircuits;
+	TArray<int32> NodeSteps;
+};
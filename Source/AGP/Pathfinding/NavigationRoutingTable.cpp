@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationRoutingTable.h"
+#include "NavigationGraph.h"
+#include "PathfindingHeap.h"
+#include "Algo/Reverse.h"
+#include "Async/ParallelFor.h"
+
+void FNavigationRoutingTable::Build(const FNavigationGraph& Graph)
+{
+	NumNodes = Graph.Num();
+	if (NumNodes == 0 || NumNodes > MaxNodes)
+	{
+		NumNodes = 0;
+		NextHops.Empty();
+		return;
+	}
+	NextHops.SetNumUninitialized(static_cast<int64>(NumNodes) * NumNodes);
+
+	ParallelFor(NumNodes, [this, &Graph](int32 SourceIndex)
+	{
+		// Plain Dijkstra from the source. Nodes are settled in order of distance so by the time a node is settled its
+		// parent already knows which first hop leads to it.
+		static thread_local TArray<float> Distances;
+		static thread_local FIndexedMinHeap OpenSet;
+		Distances.Init(UE_MAX_FLT, NumNodes);
+		OpenSet.Reset(NumNodes);
+
+		uint16* Row = &NextHops[GetEntryIndex(SourceIndex, 0)];
+		for (int32 i = 0; i < NumNodes; i++)
+		{
+			Row[i] = Unreachable;
+		}
+		Row[SourceIndex] = static_cast<uint16>(SourceIndex);
+
+		Distances[SourceIndex] = 0.0f;
+		OpenSet.PushOrDecrease(SourceIndex, 0.0f);
+		while (!OpenSet.IsEmpty())
+		{
+			const int32 CurrentIndex = OpenSet.Pop();
+			const float CurrentDistance = Distances[CurrentIndex];
+			for (int32 Edge = Graph.GetNeighbourBegin(CurrentIndex); Edge < Graph.GetNeighbourEnd(CurrentIndex); Edge++)
+			{
+				const int32 ConnectedIndex = Graph.Neighbours[Edge];
+				const float TentativeDistance = CurrentDistance + Graph.EdgeCosts[Edge];
+				if (TentativeDistance < Distances[ConnectedIndex])
+				{
+					Distances[ConnectedIndex] = TentativeDistance;
+					// Neighbours of the source are their own first hop, everything else inherits its parent's.
+					Row[ConnectedIndex] = CurrentIndex == SourceIndex ? static_cast<uint16>(ConnectedIndex) : Row[CurrentIndex];
+					OpenSet.PushOrDecrease(ConnectedIndex, TentativeDistance);
+				}
+			}
+		}
+	});
+}
+
+bool FNavigationRoutingTable::FindPath(const FNavigationGraph& Graph, int32 StartIndex, int32 EndIndex, TArray<FVector>& OutPath) const
+{
+	OutPath.Reset();
+	if (GetNextHop(StartIndex, EndIndex) == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// Walk from the start to the end, then flip it so the path is in the same reverse order as the A* results. A
+	// shortest path never visits a node twice, so a walk that takes more steps than there are nodes is going round in
+	// circles through a table that doesn't match the graph.
+	int32 CurrentIndex = StartIndex;
+	OutPath.Push(Graph.Positions[CurrentIndex]);
+	for (int32 Step = 0; CurrentIndex != EndIndex; Step++)
+	{
+		CurrentIndex = GetNextHop(CurrentIndex, EndIndex);
+		if (CurrentIndex == INDEX_NONE || Step >= NumNodes)
+		{
+			UE_LOG(LogTemp, Error, TEXT("The routing table has no path from node %d to node %d that it said it had"), StartIndex, EndIndex)
+			OutPath.Reset();
+			return false;
+		}
+		OutPath.Push(Graph.Positions[CurrentIndex]);
+	}
+	Algo::Reverse(OutPath);
+	return true;
+}
+
+void FNavigationRoutingTable::Serialize(FArchive& Ar)
+{
+	Ar << NumNodes;
+	Ar << NextHops;
+	if (Ar.IsLoading() && (NumNodes < 0 || NumNodes > MaxNodes || NextHops.Num() != static_cast<int64>(NumNodes) * NumNodes))
+	{
+		Ar.SetError();
+		NumNodes = 0;
+		NextHops.Empty();
+	}
+}
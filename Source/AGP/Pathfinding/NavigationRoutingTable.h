@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FNavigationGraph;
+
+/**
+ * A precomputed all pairs next hop table. For every pair of nodes it stores the first node to step to on the shortest
+ * path between them, so a path query is just a walk along the table with no search at all. It takes N^2 entries so it
+ * is only built for small graphs, such as the dungeons made by the ADungeonGenerator.
+ */
+class AGP_API FNavigationRoutingTable
+{
+public:
+
+	// The largest graph the table can be built for. Node indices are stored as uint16 with MAX_uint16 kept free for
+	// unreachable pairs, and at this size the table already takes 512 MB.
+	static constexpr int32 MaxNodes = 16384;
+
+	/**
+	 * Runs a Dijkstra search from every node, in parallel, to fill in the table.
+	 * @param Graph The graph to build the table for. The graph's adjacency arrays must already be built.
+	 */
+	void Build(const FNavigationGraph& Graph);
+
+	bool IsBuilt() const { return NumNodes > 0; }
+	int32 GetNumNodes() const { return NumNodes; }
+
+	/**
+	 * @return The node after StartIndex on the shortest path to EndIndex, or INDEX_NONE if EndIndex can't be reached.
+	 */
+	int32 GetNextHop(int32 StartIndex, int32 EndIndex) const
+	{
+		const uint16 NextHop = NextHops[GetEntryIndex(StartIndex, EndIndex)];
+		return NextHop == Unreachable ? INDEX_NONE : NextHop;
+	}
+
+	/**
+	 * Fills OutPath with the node positions from the end node back to the start node.
+	 * @return false if there is no path, or the table doesn't lead to the end node within NumNodes steps, in which case
+	 * OutPath is emptied.
+	 */
+	bool FindPath(const FNavigationGraph& Graph, int32 StartIndex, int32 EndIndex, TArray<FVector>& OutPath) const;
+
+	SIZE_T GetAllocatedSize() const { return NextHops.GetAllocatedSize(); }
+
+	/**
+	 * Reads or writes the table for a baked graph. A table that doesn't have a row and column for every node sets an
+	 * error on the archive when loaded and is left empty.
+	 */
+	void Serialize(FArchive& Ar);
+
+private:
+
+	static constexpr uint16 Unreachable = MAX_uint16;
+
+	int64 GetEntryIndex(int32 StartIndex, int32 EndIndex) const
+	{
+		return static_cast<int64>(StartIndex) * NumNodes + EndIndex;
+	}
+
+	int32 NumNodes = 0;
+	// Row StartIndex, column EndIndex holds the next hop from StartIndex towards EndIndex. Indexed with 64 bits as
+	// NumNodes squared doesn't fit in an int32 for the larger tables.
+	TArray64<uint16> NextHops;
+};
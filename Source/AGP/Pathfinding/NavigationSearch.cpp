@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationSearch.h"
+#include "NavigationGraph.h"
+
+namespace
+{
+	/**
+	 * Calls Func with a search over the snapshot that uses the landmark heuristic if the snapshot has landmarks and the
+	 * straight line distance if not. The choice is made once per call instead of for every node the search touches.
+	 */
+	template <typename FuncType>
+	auto WithGraphSearch(const FNavigationGraph& Graph, FNavigationSearchScratch& Scratch, FuncType&& Func)
+	{
+		const FNavigationGraphAdapter Adapter(Graph);
+		if (Graph.Landmarks.IsBuilt())
+		{
+			TNavigationSearch<FNavigationGraphAdapter, FLandmarkHeuristic> Search(Adapter, Scratch, FLandmarkHeuristic(Graph.Landmarks));
+			return Func(Search);
+		}
+		TNavigationSearch<FNavigationGraphAdapter, FEuclideanHeuristic> Search(Adapter, Scratch);
+		return Func(Search);
+	}
+}
+
+void FNavigationSearchScratch::Prepare(int32 NumNodes)
+{
+	if (Stamps.Num() < NumNodes)
+	{
+		GScores.SetNumUninitialized(NumNodes);
+		HScores.SetNumUninitialized(NumNodes);
+		CameFrom.SetNumUninitialized(NumNodes);
+		Stamps.SetNumZeroed(NumNodes);
+	}
+	// A new stamp marks every node's scores as stale so they will be initialised the first time the search reaches
+	// them, instead of clearing all the arrays up front.
+	if (++CurrentStamp == 0)
+	{
+		// The stamp wrapped around so clear the stamps to avoid mistaking old entries for new ones.
+		FMemory::Memzero(Stamps.GetData(), Stamps.Num() * sizeof(uint32));
+		CurrentStamp = 1;
+	}
+	OpenSet.Reset(NumNodes);
+}
+
+bool FNavigationSearch::FindPath(const FNavigationGraph& Graph, int32 StartIndex, int32 EndIndex,
+	FNavigationSearchScratch& Scratch, TArray<FVector>& OutPath)
+{
+	OutPath.Reset();
+	Scratch.NumExpanded = 0;
+	Scratch.PeakOpenSetSize = 0;
+	if (!Graph.IsValidNode(StartIndex) || !Graph.IsValidNode(EndIndex))
+	{
+		return false;
+	}
+
+	if (Graph.RoutingTable.IsBuilt())
+	{
+		return Graph.RoutingTable.FindPath(Graph, StartIndex, EndIndex, OutPath);
+	}
+	if (Graph.Hierarchy.ShouldSearch(StartIndex, EndIndex))
+	{
+		return Graph.Hierarchy.FindPath(Graph, StartIndex, EndIndex, Scratch, OutPath, Scratch.NumExpanded);
+	}
+
+	return WithGraphSearch(Graph, Scratch, [StartIndex, EndIndex, &Scratch, &OutPath](auto& Search)
+	{
+		if (!Search.Run(StartIndex, EndIndex, Scratch.NumExpanded))
+		{
+			return false;
+		}
+		Search.ReconstructPath(EndIndex, OutPath);
+		return true;
+	});
+}
+
+void FNavigationSearch::BeginSearch(const FNavigationGraph& Graph, int32 StartIndex, int32 EndIndex, FNavigationSearchScratch& Scratch)
+{
+	WithGraphSearch(Graph, Scratch, [StartIndex, EndIndex](auto& Search)
+	{
+		Search.Begin(StartIndex, EndIndex);
+	});
+}
+
+ENavigationSearchStatus FNavigationSearch::ExpandSearch(const FNavigationGraph& Graph, int32 EndIndex, FNavigationSearchScratch& Scratch,
+	int32 MaxExpansions, int32& OutNumExpanded)
+{
+	return WithGraphSearch(Graph, Scratch, [EndIndex, MaxExpansions, &OutNumExpanded](auto& Search)
+	{
+		return Search.Expand(EndIndex, MaxExpansions, OutNumExpanded);
+	});
+}
+
+void FNavigationSearchQuery::Start(const FNavigationGraphPtr& InGraph, int32 InStartIndex, int32 InEndIndex)
+{
+	Graph = InGraph;
+	bHierarchicalPath = false;
+	StartIndex = InStartIndex;
+	EndIndex = InEndIndex;
+	NumExpanded = 0;
+	if (!Graph || !Graph->IsValidNode(InStartIndex) || !Graph->IsValidNode(InEndIndex))
+	{
+		Status = ENavigationSearchStatus::Failed;
+		return;
+	}
+
+	// With a routing table the answer is already known so there is nothing to spread across frames.
+	if (Graph->RoutingTable.IsBuilt())
+	{
+		Status = Graph->RoutingTable.GetNextHop(InStartIndex, InEndIndex) != INDEX_NONE
+			? ENavigationSearchStatus::Succeeded : ENavigationSearchStatus::Failed;
+		return;
+	}
+	// Long searches on a large graph go through the coarse graph, which is quick enough to finish straight away.
+	if (Graph->Hierarchy.ShouldSearch(InStartIndex, InEndIndex))
+	{
+		bHierarchicalPath = true;
+		Status = Graph->Hierarchy.FindPath(*Graph, InStartIndex, InEndIndex, Scratch, HierarchicalPath, NumExpanded)
+			? ENavigationSearchStatus::Succeeded : ENavigationSearchStatus::Failed;
+		return;
+	}
+
+	FNavigationSearch::BeginSearch(*Graph, InStartIndex, InEndIndex, Scratch);
+	Status = ENavigationSearchStatus::InProgress;
+}
+
+ENavigationSearchStatus FNavigationSearchQuery::Step(int32 MaxExpansions)
+{
+	if (Status == ENavigationSearchStatus::InProgress)
+	{
+		Status = FNavigationSearch::ExpandSearch(*Graph, EndIndex, Scratch, MaxExpansions, NumExpanded);
+	}
+	return Status;
+}
+
+void FNavigationSearchQuery::GetPath(TArray<FVector>& OutPath) const
+{
+	if (Status == ENavigationSearchStatus::Succeeded && bHierarchicalPath)
+	{
+		OutPath.Reset();
+		OutPath.Append(HierarchicalPath);
+	}
+	else if (Status == ENavigationSearchStatus::Succeeded && Graph->RoutingTable.IsBuilt())
+	{
+		Graph->RoutingTable.FindPath(*Graph, StartIndex, EndIndex, OutPath);
+	}
+	else if (Status == ENavigationSearchStatus::Succeeded)
+	{
+		TNavigationSearch<FNavigationGraphAdapter>::ReconstructPath(FNavigationGraphAdapter(*Graph), Scratch, EndIndex, OutPath);
+	}
+	else
+	{
+		OutPath.Reset();
+	}
+}
+
+void FNavigationSearchQuery::Reset()
+{
+	Graph.Reset();
+	Status = ENavigationSearchStatus::Failed;
+}
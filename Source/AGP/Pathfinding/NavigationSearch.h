@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavigationGraph.h"
+#include "NavigationSearchCore.h"
+
+/**
+ * Reads an FNavigationGraph snapshot for TNavigationSearch. Edges are the snapshot's edge indices.
+ */
+struct FNavigationGraphAdapter
+{
+	const FNavigationGraph& Graph;
+
+	explicit FNavigationGraphAdapter(const FNavigationGraph& InGraph) : Graph(InGraph) {}
+
+	int32 Num() const { return Graph.Num(); }
+	const FVector& GetPosition(int32 Index) const { return Graph.Positions[Index]; }
+	float GetEdgeCost(int32 Edge) const { return Graph.EdgeCosts[Edge]; }
+
+	template <typename FuncType>
+	void ForEachEdge(int32 Index, FuncType&& Func) const
+	{
+		for (int32 Edge = Graph.GetNeighbourBegin(Index); Edge < Graph.GetNeighbourEnd(Index); Edge++)
+		{
+			Func(Edge, Graph.Neighbours[Edge]);
+		}
+	}
+};
+
+/**
+ * A* over an FNavigationGraph snapshot, through TNavigationSearch with the snapshot's stored edge costs and the
+ * tightest heuristic it has. This only reads the snapshot so it is safe to run on any thread as long as every
+ * concurrent search uses a different scratch.
+ */
+struct AGP_API FNavigationSearch
+{
+	/**
+	 * Finds the shortest path between two nodes.
+	 * @param Graph The graph snapshot to search.
+	 * @param StartIndex The node the path starts at.
+	 * @param EndIndex The node the path ends at.
+	 * @param Scratch The working memory to use for the search.
+	 * @param OutPath Filled with the node positions along the path, in reverse order. Emptied if there is no path.
+	 * @return true if a path was found.
+	 */
+	static bool FindPath(const FNavigationGraph& Graph, int32 StartIndex, int32 EndIndex,
+		FNavigationSearchScratch& Scratch, TArray<FVector>& OutPath);
+
+	/**
+	 * Sets up the scratch for a new search and adds the start node to the open set.
+	 */
+	static void BeginSearch(const FNavigationGraph& Graph, int32 StartIndex, int32 EndIndex, FNavigationSearchScratch& Scratch);
+
+	/**
+	 * Expands up to MaxExpansions nodes of a search started with BeginSearch. Read the path back with
+	 * TNavigationSearch<FNavigationGraphAdapter>::ReconstructPath once it succeeds.
+	 * @param OutNumExpanded Incremented by the number of nodes that were expanded.
+	 * @return Whether the search is still going, found the end node or ran out of nodes to expand.
+	 */
+	static ENavigationSearchStatus ExpandSearch(const FNavigationGraph& Graph, int32 EndIndex, FNavigationSearchScratch& Scratch,
+		int32 MaxExpansions, int32& OutNumExpanded);
+};
+
+/**
+ * A search whose open set and scores persist between calls so it can be run a slice at a time across several frames.
+ * It keeps its own graph snapshot alive, so it carries on safely even if the subsystem rebuilds the graph meanwhile.
+ */
+class AGP_API FNavigationSearchQuery
+{
+public:
+
+	void Start(const FNavigationGraphPtr& InGraph, int32 InStartIndex, int32 InEndIndex);
+
+	/**
+	 * Continues the search.
+	 * @param MaxExpansions The most nodes to expand before returning.
+	 * @return The status of the search after this step.
+	 */
+	ENavigationSearchStatus Step(int32 MaxExpansions);
+
+	ENavigationSearchStatus GetStatus() const { return Status; }
+	int32 GetNumExpanded() const { return NumExpanded; }
+
+	/**
+	 * Fills OutPath with the path that was found, in reverse order, or empties it if the search failed.
+	 */
+	void GetPath(TArray<FVector>& OutPath) const;
+
+	/**
+	 * Lets go of the graph snapshot. The scratch is kept so the query can be reused without allocating.
+	 */
+	void Reset();
+
+private:
+
+	FNavigationGraphPtr Graph;
+	int32 StartIndex = INDEX_NONE;
+	int32 EndIndex = INDEX_NONE;
+	int32 NumExpanded = 0;
+	ENavigationSearchStatus Status = ENavigationSearchStatus::Failed;
+	FNavigationSearchScratch Scratch;
+	// Set when the query was answered through the graph's hierarchy, which hands back the whole path at once.
+	bool bHierarchicalPath = false;
+	TArray<FVector> HierarchicalPath;
+};
@@ -0,0 +1,275 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavigationLandmarks.h"
+#include "PathfindingHeap.h"
+
+/**
+ * Per-node working memory for A*, indexed by graph node index. It is kept between searches so that a search does not
+ * have to allocate. Entries are lazily initialised using a search stamp so that a short search on a large graph does
+ * not pay to clear every node. Each thread that searches needs its own scratch.
+ */
+struct AGP_API FNavigationSearchScratch
+{
+	TArray<float> GScores;
+	TArray<float> HScores;
+	TArray<int32> CameFrom;
+	TArray<uint32> Stamps;
+	uint32 CurrentStamp = 0;
+	FIndexedMinHeap OpenSet;
+	// The entrances and nodes of a hierarchical path while it is being refined, before they are turned into positions.
+	TArray<int32> PathEntrances;
+	TArray<int32> PathNodes;
+	// Counters from the latest FNavigationSearch::FindPath, for the pathfinding stats.
+	int32 NumExpanded = 0;
+	int32 PeakOpenSetSize = 0;
+
+	/**
+	 * Makes sure the arrays can hold NumNodes entries and starts a new search stamp.
+	 */
+	void Prepare(int32 NumNodes);
+};
+
+enum class ENavigationSearchStatus : uint8
+{
+	InProgress,
+	Succeeded,
+	Failed
+};
+
+// Heuristic policies for TNavigationSearch. Each is called as Heuristic(Graph, Index, EndIndex) and has to return a
+// lower bound on the cost of getting from Index to EndIndex under the cost policy it is paired with.
+
+/**
+ * The straight line distance between the nodes. Admissible whenever edges cost at least their length.
+ */
+struct FEuclideanHeuristic
+{
+	template <typename GraphType>
+	float operator()(const GraphType& Graph, int32 Index, int32 EndIndex) const
+	{
+		return FVector::Distance(Graph.GetPosition(Index), Graph.GetPosition(EndIndex));
+	}
+};
+
+/**
+ * The distance between the nodes along the axes. Tighter than the straight line distance on graphs that only connect
+ * along the axes, such as the dungeon grid, but overestimates on any graph with diagonal edges.
+ */
+struct FManhattanHeuristic
+{
+	template <typename GraphType>
+	float operator()(const GraphType& Graph, int32 Index, int32 EndIndex) const
+	{
+		const FVector Delta = (Graph.GetPosition(Index) - Graph.GetPosition(EndIndex)).GetAbs();
+		return Delta.X + Delta.Y + Delta.Z;
+	}
+};
+
+/**
+ * No estimate at all, which turns the search into Dijkstra's algorithm. Needed for cost policies that have nothing to
+ * do with distance.
+ */
+struct FZeroHeuristic
+{
+	template <typename GraphType>
+	float operator()(const GraphType& Graph, int32 Index, int32 EndIndex) const
+	{
+		return 0.0f;
+	}
+};
+
+/**
+ * The larger of the straight line distance and the landmark lower bound. Only for graphs whose node indices are the
+ * ones the landmarks were built over.
+ */
+struct FLandmarkHeuristic
+{
+	const FNavigationLandmarks& Landmarks;
+
+	explicit FLandmarkHeuristic(const FNavigationLandmarks& InLandmarks) : Landmarks(InLandmarks) {}
+
+	template <typename GraphType>
+	float operator()(const GraphType& Graph, int32 Index, int32 EndIndex) const
+	{
+		const float Distance = FVector::Distance(Graph.GetPosition(Index), Graph.GetPosition(EndIndex));
+		return FMath::Max(Distance, Landmarks.GetLowerBound(Index, EndIndex));
+	}
+};
+
+// Cost policies for TNavigationSearch. Each is called as Cost(Graph, FromIndex, ToIndex, Edge) for every edge the
+// search relaxes.
+
+/**
+ * The cost the graph stores for the edge, which is how blocked edges are kept out of paths.
+ */
+struct FStoredEdgeCost
+{
+	template <typename GraphType>
+	float operator()(const GraphType& Graph, int32 FromIndex, int32 ToIndex, int32 Edge) const
+	{
+		return Graph.GetEdgeCost(Edge);
+	}
+};
+
+/**
+ * The straight line length of the edge, worked out as it is relaxed. Ignores the stored costs, so blocked edges are
+ * treated as open.
+ */
+struct FDistanceCost
+{
+	template <typename GraphType>
+	float operator()(const GraphType& Graph, int32 FromIndex, int32 ToIndex, int32 Edge) const
+	{
+		return FVector::Distance(Graph.GetPosition(FromIndex), Graph.GetPosition(ToIndex));
+	}
+};
+
+/**
+ * One per edge, for the path with the fewest steps. Only admissible alongside FZeroHeuristic.
+ */
+struct FUnitCost
+{
+	template <typename GraphType>
+	float operator()(const GraphType& Graph, int32 FromIndex, int32 ToIndex, int32 Edge) const
+	{
+		return 1.0f;
+	}
+};
+
+/**
+ * A* over any graph, with the heuristic and edge costs picked at compile time so the inner loop has no branches or
+ * virtual calls for them. The graph is read through an adapter that has to provide:
+ *
+ *   int32 Num() const                                   The number of nodes. Node indices are 0 to Num()-1.
+ *   FVector GetPosition(int32 Index) const              For the distance based policies and the path.
+ *   float GetEdgeCost(int32 Edge) const                 For FStoredEdgeCost.
+ *   void ForEachEdge(int32 Index, FuncType&& Func) const  Calls Func(Edge, NeighbourIndex) for every edge out of Index.
+ *
+ * Edge can be any id the adapter likes as long as GetEdgeCost understands it. The search only reads the graph, so any
+ * number can run at once as long as each has its own scratch.
+ */
+template <typename GraphType, typename HeuristicType = FEuclideanHeuristic, typename CostType = FStoredEdgeCost>
+class TNavigationSearch
+{
+public:
+
+	TNavigationSearch(const GraphType& InGraph, FNavigationSearchScratch& InScratch,
+		const HeuristicType& InHeuristic = HeuristicType(), const CostType& InCost = CostType())
+		: Graph(InGraph), Scratch(InScratch), Heuristic(InHeuristic), Cost(InCost)
+	{
+	}
+
+	/**
+	 * Sets up the scratch for a new search and adds the start node to the open set.
+	 */
+	void Begin(int32 StartIndex, int32 EndIndex)
+	{
+		Scratch.Prepare(Graph.Num());
+		TouchNode(StartIndex, EndIndex);
+		Scratch.GScores[StartIndex] = 0.0f;
+		Scratch.OpenSet.PushOrDecrease(StartIndex, Scratch.HScores[StartIndex]);
+	}
+
+	/**
+	 * Expands up to MaxExpansions nodes of a search started with Begin.
+	 * @param OutNumExpanded Incremented by the number of nodes that were expanded.
+	 * @return Whether the search is still going, found the end node or ran out of nodes to expand.
+	 */
+	ENavigationSearchStatus Expand(int32 EndIndex, int32 MaxExpansions, int32& OutNumExpanded)
+	{
+		for (int32 Expansion = 0; Expansion < MaxExpansions; Expansion++)
+		{
+			if (Scratch.OpenSet.IsEmpty())
+			{
+				// If we get here, then no path has been found.
+				return ENavigationSearchStatus::Failed;
+			}
+
+			// The heap gives us the node with the lowest FScore without scanning the whole open set.
+			const int32 CurrentIndex = Scratch.OpenSet.Pop();
+			if (CurrentIndex == EndIndex)
+			{
+				return ENavigationSearchStatus::Succeeded;
+			}
+			OutNumExpanded++;
+
+			const float CurrentGScore = Scratch.GScores[CurrentIndex];
+			Graph.ForEachEdge(CurrentIndex, [this, CurrentIndex, CurrentGScore, EndIndex](int32 Edge, int32 ConnectedIndex)
+			{
+				TouchNode(ConnectedIndex, EndIndex);
+
+				// Update this nodes scores and came from if the tentative g score is lower than the current g score, then
+				// add it to the open set or move it up the heap if it is already in there.
+				const float TentativeGScore = CurrentGScore + Cost(Graph, CurrentIndex, ConnectedIndex, Edge);
+				if (TentativeGScore < Scratch.GScores[ConnectedIndex])
+				{
+					Scratch.CameFrom[ConnectedIndex] = CurrentIndex;
+					Scratch.GScores[ConnectedIndex] = TentativeGScore;
+					Scratch.OpenSet.PushOrDecrease(ConnectedIndex, TentativeGScore + Scratch.HScores[ConnectedIndex]);
+				}
+			});
+			Scratch.PeakOpenSetSize = FMath::Max(Scratch.PeakOpenSetSize, Scratch.OpenSet.Num());
+		}
+
+		return Scratch.OpenSet.IsEmpty() ? ENavigationSearchStatus::Failed : ENavigationSearchStatus::InProgress;
+	}
+
+	/**
+	 * Runs a whole search.
+	 * @param OutNumExpanded Incremented by the number of nodes that were expanded.
+	 * @return true if the end node was reached.
+	 */
+	bool Run(int32 StartIndex, int32 EndIndex, int32& OutNumExpanded)
+	{
+		Begin(StartIndex, EndIndex);
+		return Expand(EndIndex, MAX_int32, OutNumExpanded) == ENavigationSearchStatus::Succeeded;
+	}
+
+	/**
+	 * Fills OutPath with the node positions from the end node back to the start of a search that succeeded.
+	 */
+	void ReconstructPath(int32 EndIndex, TArray<FVector>& OutPath) const
+	{
+		ReconstructPath(Graph, Scratch, EndIndex, OutPath);
+	}
+
+	/**
+	 * The same for a search that has already finished, for callers that only kept its scratch. The path doesn't
+	 * depend on the policies the search ran with.
+	 */
+	static void ReconstructPath(const GraphType& InGraph, const FNavigationSearchScratch& InScratch, int32 EndIndex,
+		TArray<FVector>& OutPath)
+	{
+		OutPath.Reset();
+		for (int32 NextIndex = EndIndex; NextIndex != INDEX_NONE; NextIndex = InScratch.CameFrom[NextIndex])
+		{
+			OutPath.Push(InGraph.GetPosition(NextIndex));
+		}
+	}
+
+	/**
+	 * @return The cost of the path to a node the search has settled.
+	 */
+	float GetCost(int32 Index) const { return Scratch.GScores[Index]; }
+
+private:
+
+	void TouchNode(int32 Index, int32 EndIndex)
+	{
+		if (Scratch.Stamps[Index] != Scratch.CurrentStamp)
+		{
+			Scratch.Stamps[Index] = Scratch.CurrentStamp;
+			Scratch.GScores[Index] = UE_MAX_FLT;
+			Scratch.HScores[Index] = Heuristic(Graph, Index, EndIndex);
+			Scratch.CameFrom[Index] = INDEX_NONE;
+		}
+	}
+
+	const GraphType& Graph;
+	FNavigationSearchScratch& Scratch;
+	HeuristicType Heuristic;
+	CostType Cost;
+};
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationSpatialHash.h"
+
+void FNavigationSpatialHash::Build(const TArray<FVector>& Positions, float InCellSize)
+{
+	CellSize = InCellSize;
+	CellRanges.Reset();
+	SortedIndices.Reset();
+	if (CellSize <= 0.0f)
+	{
+		return;
+	}
+
+	// Sort the indices by cell so each cell's positions are contiguous, then record where each cell's run starts and ends.
+	TArray<TPair<FIntPoint, int32>> Keyed;
+	Keyed.Reserve(Positions.Num());
+	for (int32 i = 0; i < Positions.Num(); i++)
+	{
+		Keyed.Emplace(GetCell(Positions[i]), i);
+	}
+	Keyed.Sort([](const TPair<FIntPoint, int32>& A, const TPair<FIntPoint, int32>& B)
+	{
+		return A.Key.Y != B.Key.Y ? A.Key.Y < B.Key.Y : A.Key.X < B.Key.X;
+	});
+
+	SortedIndices.Reserve(Keyed.Num());
+	for (int32 i = 0; i < Keyed.Num(); i++)
+	{
+		if (i == 0 || Keyed[i].Key != Keyed[i - 1].Key)
+		{
+			CellRanges.Add(Keyed[i].Key, TPair<int32, int32>(i, i));
+		}
+		SortedIndices.Add(Keyed[i].Value);
+		CellRanges.FindChecked(Keyed[i].Key).Value = i + 1;
+	}
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Buckets positions into a uniform grid of square cells on the XY plane. Finding everything within a radius only has
+ * to look at the cells the radius overlaps, so connecting every node to its neighbours is linear in the number of
+ * nodes rather than quadratic. It suits the evenly spaced dungeon nodes, where a cell the size of a room holds a
+ * handful of nodes. Unlike FNavigationSpatialIndex it is cheap enough to build just for one batch of queries.
+ */
+class AGP_API FNavigationSpatialHash
+{
+public:
+
+	/**
+	 * Buckets the positions. The positions array is not stored so the same array needs to be passed to the queries.
+	 * @param Positions The positions to bucket.
+	 * @param InCellSize The width of a cell. Queries are cheapest when their radius is about the same.
+	 */
+	void Build(const TArray<FVector>& Positions, float InCellSize);
+
+	/**
+	 * Calls Visit with the index of every position within Radius of Location, in no particular order.
+	 */
+	template <typename FunctorType>
+	void ForEachInRadius(const TArray<FVector>& Positions, const FVector& Location, float Radius, FunctorType&& Visit) const
+	{
+		if (CellSize <= 0.0f) return;
+
+		const FIntPoint Min = GetCell(Location - FVector(Radius));
+		const FIntPoint Max = GetCell(Location + FVector(Radius));
+		const double RadiusSquared = FMath::Square(static_cast<double>(Radius));
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			for (int32 X = Min.X; X <= Max.X; X++)
+			{
+				const TPair<int32, int32>* Range = CellRanges.Find(FIntPoint(X, Y));
+				if (!Range) continue;
+
+				for (int32 i = Range->Key; i < Range->Value; i++)
+				{
+					const int32 Index = SortedIndices[i];
+					if (FVector::DistSquared(Positions[Index], Location) <= RadiusSquared)
+					{
+						Visit(Index);
+					}
+				}
+			}
+		}
+	}
+
+	SIZE_T GetAllocatedSize() const { return CellRanges.GetAllocatedSize() + SortedIndices.GetAllocatedSize(); }
+
+private:
+
+	FIntPoint GetCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+	}
+
+	float CellSize = 0.0f;
+	// The range of SortedIndices in each occupied cell.
+	TMap<FIntPoint, TPair<int32, int32>> CellRanges;
+	// Position indices grouped by cell.
+	TArray<int32> SortedIndices;
+};
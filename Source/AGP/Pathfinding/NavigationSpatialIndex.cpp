@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavigationSpatialIndex.h"
+#include <algorithm>
+
+namespace
+{
+	// Number of positions below which a tree node is not split any further.
+	constexpr int32 MaxLeafSize = 8;
+}
+
+void FNavigationSpatialIndex::Build(const TArray<FVector>& Positions)
+{
+	TreeNodes.Reset();
+	SortedIndices.SetNumUninitialized(Positions.Num());
+	for (int32 i = 0; i < Positions.Num(); i++)
+	{
+		SortedIndices[i] = i;
+	}
+
+	if (Positions.Num() > 0)
+	{
+		// A balanced tree has fewer than 2 * N / MaxLeafSize nodes, reserve that so building does not reallocate.
+		TreeNodes.Reserve(2 * Positions.Num() / MaxLeafSize + 1);
+		BuildRecursive(Positions, 0, Positions.Num());
+	}
+}
+
+int32 FNavigationSpatialIndex::BuildRecursive(const TArray<FVector>& Positions, int32 Begin, int32 End)
+{
+	FBox Bounds(ForceInit);
+	for (int32 i = Begin; i < End; i++)
+	{
+		Bounds += Positions[SortedIndices[i]];
+	}
+
+	const int32 TreeIndex = TreeNodes.Add({Bounds, Begin, End});
+	if (End - Begin <= MaxLeafSize)
+	{
+		return TreeIndex;
+	}
+
+	// Split on the median of the widest axis.
+	const FVector Extent = Bounds.GetSize();
+	const int32 Axis = Extent.X >= Extent.Y && Extent.X >= Extent.Z ? 0 : (Extent.Y >= Extent.Z ? 1 : 2);
+	const int32 Mid = Begin + (End - Begin) / 2;
+	int32* Indices = SortedIndices.GetData();
+	std::nth_element(Indices + Begin, Indices + Mid, Indices + End, [&Positions, Axis](int32 A, int32 B)
+	{
+		return Positions[A][Axis] < Positions[B][Axis];
+	});
+
+	// Children are built after the parent is added so take copies rather than holding a reference into TreeNodes.
+	const int32 Left = BuildRecursive(Positions, Begin, Mid);
+	const int32 Right = BuildRecursive(Positions, Mid, End);
+	TreeNodes[TreeIndex].Left = Left;
+	TreeNodes[TreeIndex].Right = Right;
+	return TreeIndex;
+}
+
+int32 FNavigationSpatialIndex::FindNearest(const TArray<FVector>& Positions, const FVector& Location) const
+{
+	int32 BestIndex = INDEX_NONE;
+	double BestDistSquared = TNumericLimits<double>::Max();
+	if (!TreeNodes.IsEmpty())
+	{
+		FindNearestRecursive(Positions, 0, Location, BestIndex, BestDistSquared);
+	}
+	return BestIndex;
+}
+
+int32 FNavigationSpatialIndex::FindFurthest(const TArray<FVector>& Positions, const FVector& Location) const
+{
+	int32 BestIndex = INDEX_NONE;
+	double BestDistSquared = -1.0;
+	if (!TreeNodes.IsEmpty())
+	{
+		FindFurthestRecursive(Positions, 0, Location, BestIndex, BestDistSquared);
+	}
+	return BestIndex;
+}
+
+void FNavigationSpatialIndex::FindNearestRecursive(const TArray<FVector>& Positions, int32 TreeIndex, const FVector& Location,
+	int32& BestIndex, double& BestDistSquared) const
+{
+	const FTreeNode& Node = TreeNodes[TreeIndex];
+	if (Node.Left == INDEX_NONE)
+	{
+		for (int32 i = Node.Begin; i < Node.End; i++)
+		{
+			const double DistSquared = FVector::DistSquared(Positions[SortedIndices[i]], Location);
+			if (DistSquared < BestDistSquared)
+			{
+				BestDistSquared = DistSquared;
+				BestIndex = SortedIndices[i];
+			}
+		}
+		return;
+	}
+
+	// Visit the closer child first so the second one is more likely to be skipped.
+	const double LeftDistSquared = TreeNodes[Node.Left].Bounds.ComputeSquaredDistanceToPoint(Location);
+	const double RightDistSquared = TreeNodes[Node.Right].Bounds.ComputeSquaredDistanceToPoint(Location);
+	const bool bLeftFirst = LeftDistSquared <= RightDistSquared;
+	const int32 First = bLeftFirst ? Node.Left : Node.Right;
+	const int32 Second = bLeftFirst ? Node.Right : Node.Left;
+	const double SecondDistSquared = bLeftFirst ? RightDistSquared : LeftDistSquared;
+
+	FindNearestRecursive(Positions, First, Location, BestIndex, BestDistSquared);
+	if (SecondDistSquared < BestDistSquared)
+	{
+		FindNearestRecursive(Positions, Second, Location, BestIndex, BestDistSquared);
+	}
+}
+
+void FNavigationSpatialIndex::FindFurthestRecursive(const TArray<FVector>& Positions, int32 TreeIndex, const FVector& Location,
+	int32& BestIndex, double& BestDistSquared) const
+{
+	const FTreeNode& Node = TreeNodes[TreeIndex];
+	if (Node.Left == INDEX_NONE)
+	{
+		for (int32 i = Node.Begin; i < Node.End; i++)
+		{
+			const double DistSquared = FVector::DistSquared(Positions[SortedIndices[i]], Location);
+			if (DistSquared > BestDistSquared)
+			{
+				BestDistSquared = DistSquared;
+				BestIndex = SortedIndices[i];
+			}
+		}
+		return;
+	}
+
+	// The furthest corner of a child's bounding box is an upper bound on how far any of its nodes can be, so visit the
+	// child with the further corner first and skip the other one if it cannot beat what has been found.
+	const double LeftMaxDistSquared = MaxDistSquaredToBox(TreeNodes[Node.Left].Bounds, Location);
+	const double RightMaxDistSquared = MaxDistSquaredToBox(TreeNodes[Node.Right].Bounds, Location);
+	const bool bLeftFirst = LeftMaxDistSquared >= RightMaxDistSquared;
+	const int32 First = bLeftFirst ? Node.Left : Node.Right;
+	const int32 Second = bLeftFirst ? Node.Right : Node.Left;
+	const double SecondMaxDistSquared = bLeftFirst ? RightMaxDistSquared : LeftMaxDistSquared;
+
+	FindFurthestRecursive(Positions, First, Location, BestIndex, BestDistSquared);
+	if (SecondMaxDistSquared > BestDistSquared)
+	{
+		FindFurthestRecursive(Positions, Second, Location, BestIndex, BestDistSquared);
+	}
+}
+
+double FNavigationSpatialIndex::MaxDistSquaredToBox(const FBox& Box, const FVector& Location)
+{
+	double DistSquared = 0.0;
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		const double Furthest = FMath::Max(FMath::Abs(Location[Axis] - Box.Min[Axis]), FMath::Abs(Box.Max[Axis] - Location[Axis]));
+		DistSquared += Furthest * Furthest;
+	}
+	return DistSquared;
+}
+
+SIZE_T FNavigationSpatialIndex::GetAllocatedSize() const
+{
+	return TreeNodes.GetAllocatedSize() + SortedIndices.GetAllocatedSize();
+}
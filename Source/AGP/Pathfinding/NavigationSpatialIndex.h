@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * A k-d tree over the navigation node positions used to answer nearest and furthest node queries without scanning
+ * every node. Each tree node stores the bounding box of the positions below it so that whole subtrees can be skipped
+ * when they cannot be closer (or further) than the best node found so far. It works for any node layout, so it serves
+ * both hand placed levels and the procedural dungeon and landscape graphs.
+ */
+class AGP_API FNavigationSpatialIndex
+{
+public:
+
+	/**
+	 * Builds the tree. The positions array is not stored so the same array needs to be passed to the queries.
+	 * @param Positions The positions of the nodes to index.
+	 */
+	void Build(const TArray<FVector>& Positions);
+
+	/**
+	 * @return The index of the position closest to Location, or INDEX_NONE if there are no positions.
+	 */
+	int32 FindNearest(const TArray<FVector>& Positions, const FVector& Location) const;
+
+	/**
+	 * @return The index of the position furthest from Location, or INDEX_NONE if there are no positions.
+	 */
+	int32 FindFurthest(const TArray<FVector>& Positions, const FVector& Location) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	struct FTreeNode
+	{
+		FBox Bounds;
+		// Range of SortedIndices covered by this tree node.
+		int32 Begin;
+		int32 End;
+		// Children, or INDEX_NONE for a leaf.
+		int32 Left = INDEX_NONE;
+		int32 Right = INDEX_NONE;
+	};
+
+	int32 BuildRecursive(const TArray<FVector>& Positions, int32 Begin, int32 End);
+	void FindNearestRecursive(const TArray<FVector>& Positions, int32 TreeIndex, const FVector& Location, int32& BestIndex, double& BestDistSquared) const;
+	void FindFurthestRecursive(const TArray<FVector>& Positions, int32 TreeIndex, const FVector& Location, int32& BestIndex, double& BestDistSquared) const;
+
+	static double MaxDistSquaredToBox(const FBox& Box, const FVector& Location);
+
+	TArray<FTreeNode> TreeNodes;
+	// Node indices reordered so that every tree node covers a contiguous range.
+	TArray<int32> SortedIndices;
+};
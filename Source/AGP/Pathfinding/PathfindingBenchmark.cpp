@@ -0,0 +1,2443 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PathfindingSubsystem.h"
+#include "NavigationNode.h"
+#include "NavigationSpatialHash.h"
+#include "AGP/Landscape/DungeonGenerator.h"
+#include "AGP/Characters/EnemyAIManagerSubsystem.h"
+#include "AGP/Characters/EnemyCharacter.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "DrawDebugHelpers.h"
+#include "Algo/Count.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include <atomic>
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Development only benchmarks for the UPathfindingSubsystem. These spawn synthetic navigation graphs into the current
+ * world, swap them in for the subsystem's own nodes while measuring, then put everything back the way it was.
+ */
+class FPathfindingBenchmark
+{
+public:
+
+	/**
+	 * Compares the current A* on the CSR graph snapshot against the heap based search walking the node actors and the
+	 * original linear scan open set, on a grid graph with random blocked cells. Also reports the memory used by each
+	 * graph representation.
+	 * @param World The world whose UPathfindingSubsystem will be benchmarked.
+	 * @param GridSize The width and height of the synthetic grid.
+	 * @param NumQueries The number of random start/end pairs to search between.
+	 */
+	static void RunAStar(UWorld* World, int32 GridSize, int32 NumQueries)
+	{
+		UPathfindingSubsystem* Subsystem = World ? World->GetSubsystem<UPathfindingSubsystem>() : nullptr;
+		if (!Subsystem)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unable to find the PathfindingSubsystem to benchmark."))
+			return;
+		}
+
+		FRandomStream Random(1234);
+		TArray<ANavigationNode*> GraphNodes = SpawnGridGraph(World, GridSize, 0.2f, Random);
+		if (GraphNodes.Num() < 2)
+		{
+			DestroyGraph(World, GraphNodes);
+			return;
+		}
+
+		// Swap the synthetic graph in so the subsystem searches it instead of the level's nodes.
+		TArray<ANavigationNode*> SavedNodes = MoveTemp(Subsystem->Nodes);
+		TArray<FNavigationNodeData> SavedNodeData = MoveTemp(Subsystem->NodeData);
+		const bool bSavedGeneratedNodes = Subsystem->bGeneratedNodes;
+		Subsystem->Nodes = GraphNodes;
+		Subsystem->bGeneratedNodes = false;
+		double StartTime = FPlatformTime::Seconds();
+		Subsystem->RebuildGraph();
+		const double BuildSeconds = FPlatformTime::Seconds() - StartTime;
+		const FNavigationGraphPtr NavGraph = Subsystem->Graph;
+
+		TArray<TPair<ANavigationNode*, ANavigationNode*>> Queries;
+		for (int32 i = 0; i < NumQueries; i++)
+		{
+			Queries.Emplace(GraphNodes[Random.RandRange(0, GraphNodes.Num() - 1)], GraphNodes[Random.RandRange(0, GraphNodes.Num() - 1)]);
+		}
+
+		int32 Mismatches = 0;
+		double LinearScanSeconds = 0.0;
+		double ActorWalkSeconds = 0.0;
+		double SnapshotSeconds = 0.0;
+		FActorWalkScratch ActorWalkScratch;
+		for (const TPair<ANavigationNode*, ANavigationNode*>& Query : Queries)
+		{
+			StartTime = FPlatformTime::Seconds();
+			const TArray<FVector> LinearScanPath = GetPathLinearScan(Query.Key, Query.Value);
+			LinearScanSeconds += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			const TArray<FVector> ActorWalkPath = GetPathActorWalk(ActorWalkScratch, GraphNodes, Query.Key, Query.Value);
+			ActorWalkSeconds += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			const TArray<FVector> SnapshotPath = Subsystem->GetPath(*NavGraph, Query.Key->NodeIndex, Query.Value->NodeIndex);
+			SnapshotSeconds += FPlatformTime::Seconds() - StartTime;
+
+			// Ties can give different but equally short paths so compare the lengths rather than the waypoints.
+			if (!PathLengthsMatch(LinearScanPath, ActorWalkPath) || !PathLengthsMatch(LinearScanPath, SnapshotPath))
+			{
+				Mismatches++;
+			}
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("A* benchmark on a %dx%d grid (%d nodes, %d edges), %d queries, %d mismatched paths:"),
+			GridSize, GridSize, NavGraph->Num(), NavGraph->NumEdges(), NumQueries, Mismatches)
+		UE_LOG(LogTemp, Display, TEXT("  Linear scan open set, actor walking: %.3f ms/query"), LinearScanSeconds * 1000.0 / NumQueries)
+		UE_LOG(LogTemp, Display, TEXT("  Heap open set, actor walking:        %.3f ms/query (%.1fx)"),
+			ActorWalkSeconds * 1000.0 / NumQueries, ActorWalkSeconds > 0.0 ? LinearScanSeconds / ActorWalkSeconds : 0.0)
+		UE_LOG(LogTemp, Display, TEXT("  Heap open set, CSR snapshot:         %.3f ms/query (%.1fx)"),
+			SnapshotSeconds * 1000.0 / NumQueries, SnapshotSeconds > 0.0 ? LinearScanSeconds / SnapshotSeconds : 0.0)
+
+		// Compare plain A* on the snapshot against walking an all pairs routing table, whether or not the subsystem would
+		// have chosen to build one for a graph this size.
+		if (NavGraph->Num() <= FNavigationRoutingTable::MaxNodes)
+		{
+			FNavigationGraph AStarGraph = *NavGraph;
+			AStarGraph.RoutingTable = FNavigationRoutingTable();
+			StartTime = FPlatformTime::Seconds();
+			FNavigationRoutingTable RoutingTable;
+			RoutingTable.Build(AStarGraph);
+			const double TableBuildSeconds = FPlatformTime::Seconds() - StartTime;
+
+			FNavigationSearchScratch Scratch;
+			TArray<FVector> AStarPath;
+			TArray<FVector> TablePath;
+			double AStarSeconds = 0.0;
+			double TableSeconds = 0.0;
+			int32 TableMismatches = 0;
+			for (const TPair<ANavigationNode*, ANavigationNode*>& Query : Queries)
+			{
+				StartTime = FPlatformTime::Seconds();
+				FNavigationSearch::FindPath(AStarGraph, Query.Key->NodeIndex, Query.Value->NodeIndex, Scratch, AStarPath);
+				AStarSeconds += FPlatformTime::Seconds() - StartTime;
+
+				StartTime = FPlatformTime::Seconds();
+				RoutingTable.FindPath(AStarGraph, Query.Key->NodeIndex, Query.Value->NodeIndex, TablePath);
+				TableSeconds += FPlatformTime::Seconds() - StartTime;
+
+				if (!PathLengthsMatch(AStarPath, TablePath))
+				{
+					TableMismatches++;
+				}
+			}
+			UE_LOG(LogTemp, Display, TEXT("  A* on snapshot:                      %.3f ms/query"), AStarSeconds * 1000.0 / NumQueries)
+			UE_LOG(LogTemp, Display, TEXT("  Routing table walk:                  %.3f ms/query (%.1fx), %d mismatched paths"),
+				TableSeconds * 1000.0 / NumQueries, TableSeconds > 0.0 ? AStarSeconds / TableSeconds : 0.0, TableMismatches)
+			UE_LOG(LogTemp, Display, TEXT("  Routing table memory %.1f KB, build %.3f ms"),
+				RoutingTable.GetAllocatedSize() / 1024.0, TableBuildSeconds * 1000.0)
+		}
+
+		// The actor side only counts what the search actually reads: the node actor, its scene component and its
+		// ConnectedNodes allocation. The real footprint of an actor is larger than this.
+		SIZE_T ActorBytes = 0;
+		for (const ANavigationNode* Node : GraphNodes)
+		{
+			ActorBytes += Node->GetClass()->GetStructureSize() + Node->LocationComponent->GetClass()->GetStructureSize()
+				+ Node->ConnectedNodes.GetAllocatedSize();
+		}
+		SIZE_T NodeDataBytes = Subsystem->NodeData.GetAllocatedSize();
+		for (const FNavigationNodeData& Node : Subsystem->NodeData)
+		{
+			NodeDataBytes += Node.ConnectedNodes.GetAllocatedSize() + Node.BlockedConnections.GetAllocatedSize();
+		}
+		UE_LOG(LogTemp, Display, TEXT("  Graph memory: node actors %.1f KB, node data %.1f KB, CSR snapshot %.1f KB, snapshot build %.3f ms"),
+			ActorBytes / 1024.0, NodeDataBytes / 1024.0, NavGraph->GetAllocatedSize() / 1024.0, BuildSeconds * 1000.0)
+
+		// Put the level's own nodes back.
+		Subsystem->Nodes = MoveTemp(SavedNodes);
+		Subsystem->NodeData = MoveTemp(SavedNodeData);
+		Subsystem->bGeneratedNodes = bSavedGeneratedNodes;
+		Subsystem->RebuildNodeIndices();
+		Subsystem->MarkGraphDirty();
+		DestroyGraph(World, GraphNodes);
+	}
+
+	/**
+	 * Compares the k-d tree nearest and furthest node lookups against linear scans over random node positions.
+	 * @param NumNodes The number of random node positions to index.
+	 * @param NumQueries The number of random locations to look up.
+	 */
+	static void RunSpatialIndex(int32 NumNodes, int32 NumQueries)
+	{
+		FRandomStream Random(1234);
+		const FBox Area(FVector(-50000.0f, -50000.0f, -500.0f), FVector(50000.0f, 50000.0f, 500.0f));
+		TArray<FVector> Positions;
+		for (int32 i = 0; i < NumNodes; i++)
+		{
+			Positions.Add(FVector(Random.FRandRange(Area.Min.X, Area.Max.X), Random.FRandRange(Area.Min.Y, Area.Max.Y), Random.FRandRange(Area.Min.Z, Area.Max.Z)));
+		}
+		TArray<TArray<int32>> NoEdges;
+		NoEdges.SetNum(NumNodes);
+
+		double StartTime = FPlatformTime::Seconds();
+		const FNavigationGraphPtr NavGraph = FNavigationGraph::Build(Positions, NoEdges, 0);
+		const double BuildSeconds = FPlatformTime::Seconds() - StartTime;
+
+		TArray<FVector> Queries;
+		for (int32 i = 0; i < NumQueries; i++)
+		{
+			// Query from a slightly larger area so some lookups come from outside the graph.
+			Queries.Add(FVector(Random.FRandRange(Area.Min.X * 1.2f, Area.Max.X * 1.2f), Random.FRandRange(Area.Min.Y * 1.2f, Area.Max.Y * 1.2f), 0.0f));
+		}
+
+		int32 Mismatches = 0;
+		double LinearNearestSeconds = 0.0, TreeNearestSeconds = 0.0, LinearFurthestSeconds = 0.0, TreeFurthestSeconds = 0.0;
+		for (const FVector& Query : Queries)
+		{
+			StartTime = FPlatformTime::Seconds();
+			int32 LinearNearest = INDEX_NONE, LinearFurthest = INDEX_NONE;
+			double MinDistSquared = TNumericLimits<double>::Max();
+			for (int32 i = 0; i < Positions.Num(); i++)
+			{
+				const double DistSquared = FVector::DistSquared(Query, Positions[i]);
+				if (DistSquared < MinDistSquared)
+				{
+					MinDistSquared = DistSquared;
+					LinearNearest = i;
+				}
+			}
+			LinearNearestSeconds += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			double MaxDistSquared = -1.0;
+			for (int32 i = 0; i < Positions.Num(); i++)
+			{
+				const double DistSquared = FVector::DistSquared(Query, Positions[i]);
+				if (DistSquared > MaxDistSquared)
+				{
+					MaxDistSquared = DistSquared;
+					LinearFurthest = i;
+				}
+			}
+			LinearFurthestSeconds += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			const int32 TreeNearest = NavGraph->FindNearestNode(Query);
+			TreeNearestSeconds += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			const int32 TreeFurthest = NavGraph->FindFurthestNode(Query);
+			TreeFurthestSeconds += FPlatformTime::Seconds() - StartTime;
+
+			// Compare distances rather than indices in case two nodes are equally far away.
+			if (!FMath::IsNearlyEqual(FVector::DistSquared(Query, Positions[TreeNearest]), MinDistSquared)
+				|| !FMath::IsNearlyEqual(FVector::DistSquared(Query, Positions[TreeFurthest]), MaxDistSquared))
+			{
+				Mismatches++;
+			}
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("Spatial index benchmark with %d nodes, %d queries, %d mismatches, tree build %.3f ms:"),
+			NumNodes, NumQueries, Mismatches, BuildSeconds * 1000.0)
+		UE_LOG(LogTemp, Display, TEXT("  Nearest:  linear %.2f us/query, k-d tree %.2f us/query"),
+			LinearNearestSeconds * 1e6 / NumQueries, TreeNearestSeconds * 1e6 / NumQueries)
+		UE_LOG(LogTemp, Display, TEXT("  Furthest: linear %.2f us/query, k-d tree %.2f us/query"),
+			LinearFurthestSeconds * 1e6 / NumQueries, TreeFurthestSeconds * 1e6 / NumQueries)
+	}
+
+	/**
+	 * Compares hierarchical pathfinding against flat A* on grid graphs of increasing size, measuring the nodes each
+	 * expands and the time taken for queries long enough to go through the coarse graph.
+	 * @param MaxGridSize The width of the largest grid to measure, starting from 32 and doubling.
+	 * @param NumQueries The number of random start and end pairs per grid size.
+	 */
+	static void RunHierarchy(int32 MaxGridSize, int32 NumQueries)
+	{
+		constexpr float Spacing = 100.0f;
+		constexpr int32 ClusterCells = 8;
+		FRandomStream Random(1234);
+		UE_LOG(LogTemp, Display, TEXT("Hierarchy benchmark, %dx%d cell clusters, %d queries per grid:"), ClusterCells, ClusterCells, NumQueries)
+
+		for (int32 GridSize = 32; GridSize <= MaxGridSize; GridSize *= 2)
+		{
+			TArray<FVector> Positions;
+			TArray<TArray<int32>> Adjacency;
+			MakeGridGraph(GridSize, Spacing, 0.2f, Random, Positions, Adjacency);
+
+			const FNavigationGraphPtr FlatGraph = FNavigationGraph::Build(Positions, Adjacency, 0);
+			FNavigationGraphBuildSettings Settings;
+			Settings.HierarchyClusterSize = ClusterCells * Spacing;
+			double StartTime = FPlatformTime::Seconds();
+			const FNavigationGraphPtr HierarchicalGraph = FNavigationGraph::Build(Positions, Adjacency, 0, Settings);
+			const double BuildSeconds = FPlatformTime::Seconds() - StartTime;
+			const FNavigationHierarchy& Hierarchy = HierarchicalGraph->Hierarchy;
+
+			FNavigationSearchScratch Scratch;
+			TArray<FVector> FlatPath;
+			TArray<FVector> HierarchicalPath;
+			double FlatSeconds = 0.0;
+			double HierarchicalSeconds = 0.0;
+			int64 FlatExpanded = 0;
+			int64 HierarchicalExpanded = 0;
+			int32 Mismatches = 0;
+			int32 NumLongQueries = 0;
+			for (int32 i = 0; i < NumQueries; i++)
+			{
+				const int32 StartIndex = Random.RandRange(0, Positions.Num() - 1);
+				const int32 EndIndex = Random.RandRange(0, Positions.Num() - 1);
+				if (!Hierarchy.ShouldSearch(StartIndex, EndIndex)) continue;
+				NumLongQueries++;
+
+				StartTime = FPlatformTime::Seconds();
+				int32 NumExpanded = 0;
+				FNavigationSearch::BeginSearch(*FlatGraph, StartIndex, EndIndex, Scratch);
+				if (FNavigationSearch::ExpandSearch(*FlatGraph, EndIndex, Scratch, MAX_int32, NumExpanded) == ENavigationSearchStatus::Succeeded)
+				{
+					TNavigationSearch<FNavigationGraphAdapter>::ReconstructPath(FNavigationGraphAdapter(*FlatGraph), Scratch, EndIndex, FlatPath);
+				}
+				else
+				{
+					FlatPath.Reset();
+				}
+				FlatSeconds += FPlatformTime::Seconds() - StartTime;
+				FlatExpanded += NumExpanded;
+
+				StartTime = FPlatformTime::Seconds();
+				NumExpanded = 0;
+				Hierarchy.FindPath(*HierarchicalGraph, StartIndex, EndIndex, Scratch, HierarchicalPath, NumExpanded);
+				HierarchicalSeconds += FPlatformTime::Seconds() - StartTime;
+				HierarchicalExpanded += NumExpanded;
+
+				if (!PathLengthsMatch(FlatPath, HierarchicalPath))
+				{
+					Mismatches++;
+				}
+			}
+
+			const int32 Divisor = FMath::Max(1, NumLongQueries);
+			UE_LOG(LogTemp, Display, TEXT("  %dx%d grid (%d nodes), %d long queries, %d mismatched paths, %d clusters, %d entrances, build %.2f ms, %.1f KB"),
+				GridSize, GridSize, Positions.Num(), NumLongQueries, Mismatches, Hierarchy.NumClusters(), Hierarchy.NumEntrances(),
+				BuildSeconds * 1000.0, Hierarchy.GetAllocatedSize() / 1024.0)
+			UE_LOG(LogTemp, Display, TEXT("    Flat A*:      %.3f ms/query, %lld nodes expanded/query"),
+				FlatSeconds * 1000.0 / Divisor, FlatExpanded / Divisor)
+			UE_LOG(LogTemp, Display, TEXT("    Hierarchical: %.3f ms/query, %lld nodes expanded/query (%.1fx)"),
+				HierarchicalSeconds * 1000.0 / Divisor, HierarchicalExpanded / Divisor,
+				HierarchicalSeconds > 0.0 ? FlatSeconds / HierarchicalSeconds : 0.0)
+		}
+	}
+
+	/**
+	 * Compares routes on a dungeon occupancy grid against A* over the same rooms and corridors as a node graph.
+	 * @param GridSize The number of rooms along each side of the dungeon.
+	 * @param NumQueries The number of random room to room routes to find.
+	 */
+	static void RunDungeonGrid(int32 GridSize, int32 NumQueries)
+	{
+		constexpr float RoomSize = 500.0f;
+		FRandomStream Random(1234);
+
+		FDungeonNavigationGrid DungeonGrid;
+		TArray<int32> CellNodes;
+		TArray<FVector> Positions;
+		TArray<TArray<int32>> Adjacency;
+		const TArray<FIntPoint> Rooms = MakeDungeonGrid(GridSize, RoomSize, Random, DungeonGrid, CellNodes, Positions, Adjacency);
+		if (Rooms.IsEmpty())
+		{
+			return;
+		}
+		const FNavigationGraphPtr NavGraph = FNavigationGraph::Build(Positions, Adjacency, 0);
+
+		FNavigationSearchScratch Scratch;
+		TArray<FVector> GridPath;
+		TArray<FVector> GraphPath;
+		double GridSeconds = 0.0;
+		double GraphSeconds = 0.0;
+		int32 Mismatches = 0;
+		for (int32 i = 0; i < NumQueries; i++)
+		{
+			const FIntPoint Start = Rooms[Random.RandRange(0, Rooms.Num() - 1)];
+			const FIntPoint End = Rooms[Random.RandRange(0, Rooms.Num() - 1)];
+
+			double StartTime = FPlatformTime::Seconds();
+			DungeonGrid.FindPath(Start, End, GridPath);
+			GridSeconds += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			FNavigationSearch::FindPath(*NavGraph, CellNodes[Start.Y * GridSize + Start.X], CellNodes[End.Y * GridSize + End.X], Scratch, GraphPath);
+			GraphSeconds += FPlatformTime::Seconds() - StartTime;
+
+			if (!PathLengthsMatch(GridPath, GraphPath))
+			{
+				Mismatches++;
+			}
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("Dungeon grid benchmark, %dx%d rooms (%d walkable cells), %d queries, %d mismatched paths:"),
+			GridSize, GridSize, Positions.Num(), NumQueries, Mismatches)
+		UE_LOG(LogTemp, Display, TEXT("  A* on node graph:    %.2f us/query, %.1f KB"), GraphSeconds * 1e6 / NumQueries, NavGraph->GetAllocatedSize() / 1024.0)
+		UE_LOG(LogTemp, Display, TEXT("  BFS on dungeon grid: %.2f us/query (%.1fx), %.1f KB"), GridSeconds * 1e6 / NumQueries,
+			GridSeconds > 0.0 ? GraphSeconds / GridSeconds : 0.0, DungeonGrid.GetAllocatedSize() / 1024.0)
+	}
+
+	/**
+	 * Compares repairing paths with D* Lite against searching again with A* as nodes on the path get blocked.
+	 * @param GridSize The width and height of the synthetic grid.
+	 * @param NumQueries The number of random start/end pairs to follow.
+	 * @param BlocksPerQuery How many times a node on each path is blocked.
+	 */
+	static void RunIncremental(int32 GridSize, int32 NumQueries, int32 BlocksPerQuery)
+	{
+		FRandomStream Random(1234);
+		TArray<FVector> Positions;
+		TArray<TArray<int32>> Adjacency;
+		MakeGridGraph(GridSize, 100.0f, 0.2f, Random, Positions, Adjacency);
+		const FNavigationGraphPtr BaseGraph = FNavigationGraph::Build(Positions, Adjacency, 0);
+
+		FNavigationIncrementalSearch IncrementalSearch;
+		FNavigationSearchScratch Scratch;
+		TArray<FVector> IncrementalPath;
+		TArray<FVector> AStarPath;
+		double IncrementalSeconds = 0.0;
+		double AStarSeconds = 0.0;
+		int64 IncrementalExpanded = 0;
+		int64 AStarExpanded = 0;
+		int32 NumRepairs = 0;
+		int32 Mismatches = 0;
+		for (int32 i = 0; i < NumQueries; i++)
+		{
+			FNavigationGraphPtr NavGraph = BaseGraph;
+			const int32 StartIndex = Random.RandRange(0, Positions.Num() - 1);
+			const int32 EndIndex = Random.RandRange(0, Positions.Num() - 1);
+			if (!IncrementalSearch.Start(NavGraph, StartIndex, EndIndex)) continue;
+
+			for (int32 Block = 0; Block < BlocksPerQuery; Block++)
+			{
+				// Block a node somewhere along the middle of the current path, cutting all of its edges.
+				IncrementalSearch.GetPath(IncrementalPath);
+				if (IncrementalPath.Num() < 3) break;
+				const int32 BlockedNode = NavGraph->FindNearestNode(IncrementalPath[Random.RandRange(1, IncrementalPath.Num() - 2)]);
+
+				TArray<TPair<int32, float>> CostChanges;
+				TArray<int32> ChangedEdges;
+				for (int32 Edge = NavGraph->GetNeighbourBegin(BlockedNode); Edge < NavGraph->GetNeighbourEnd(BlockedNode); Edge++)
+				{
+					CostChanges.Emplace(Edge, FNavigationGraph::BlockedCost);
+					ChangedEdges.Add(Edge);
+				}
+				for (int32 j = NavGraph->ReverseOffsets[BlockedNode]; j < NavGraph->ReverseOffsets[BlockedNode + 1]; j++)
+				{
+					CostChanges.Emplace(NavGraph->ReverseEdges[j], FNavigationGraph::BlockedCost);
+					ChangedEdges.Add(NavGraph->ReverseEdges[j]);
+				}
+				NavGraph = FNavigationGraph::WithEdgeCosts(*NavGraph, CostChanges, Block + 1);
+
+				const int32 ExpandedBefore = IncrementalSearch.GetNumExpanded();
+				double StartTime = FPlatformTime::Seconds();
+				IncrementalSearch.ApplyEdgeChanges(NavGraph, ChangedEdges);
+				IncrementalSearch.GetPath(IncrementalPath);
+				IncrementalSeconds += FPlatformTime::Seconds() - StartTime;
+				IncrementalExpanded += IncrementalSearch.GetNumExpanded() - ExpandedBefore;
+
+				StartTime = FPlatformTime::Seconds();
+				int32 NumExpanded = 0;
+				FNavigationSearch::BeginSearch(*NavGraph, StartIndex, EndIndex, Scratch);
+				if (FNavigationSearch::ExpandSearch(*NavGraph, EndIndex, Scratch, MAX_int32, NumExpanded) == ENavigationSearchStatus::Succeeded)
+				{
+					TNavigationSearch<FNavigationGraphAdapter>::ReconstructPath(FNavigationGraphAdapter(*NavGraph), Scratch, EndIndex, AStarPath);
+				}
+				else
+				{
+					AStarPath.Reset();
+				}
+				AStarSeconds += FPlatformTime::Seconds() - StartTime;
+				AStarExpanded += NumExpanded;
+
+				NumRepairs++;
+				if (!PathLengthsMatch(IncrementalPath, AStarPath))
+				{
+					Mismatches++;
+				}
+			}
+		}
+
+		const int32 Divisor = FMath::Max(1, NumRepairs);
+		UE_LOG(LogTemp, Display, TEXT("Incremental replanning benchmark, %dx%d grid (%d nodes), %d repairs, %d mismatched paths:"),
+			GridSize, GridSize, Positions.Num(), NumRepairs, Mismatches)
+		UE_LOG(LogTemp, Display, TEXT("  A* from scratch: %.3f ms/repair, %lld nodes expanded/repair"),
+			AStarSeconds * 1000.0 / Divisor, AStarExpanded / Divisor)
+		UE_LOG(LogTemp, Display, TEXT("  D* Lite repair:  %.3f ms/repair, %lld nodes expanded/repair (%.1fx)"),
+			IncrementalSeconds * 1000.0 / Divisor, IncrementalExpanded / Divisor,
+			IncrementalSeconds > 0.0 ? AStarSeconds / IncrementalSeconds : 0.0)
+	}
+
+	/**
+	 * Simulates a crowd of agents chasing one moving target, comparing every agent running its own A* each time the
+	 * target moves with all of them reading one shared flow field.
+	 * @param NumAgents The number of agents in the crowd.
+	 * @param GridSize The width and height of the synthetic grid.
+	 * @param NumSteps How many times the target moves to a neighbouring node.
+	 */
+	static void RunFlowField(int32 NumAgents, int32 GridSize, int32 NumSteps)
+	{
+		FRandomStream Random(1234);
+		TArray<FVector> Positions;
+		TArray<TArray<int32>> Adjacency;
+		MakeGridGraph(GridSize, 100.0f, 0.2f, Random, Positions, Adjacency);
+		const FNavigationGraphPtr NavGraph = FNavigationGraph::Build(Positions, Adjacency, 0);
+
+		TArray<int32> AStarAgents;
+		for (int32 i = 0; i < NumAgents; i++)
+		{
+			AStarAgents.Add(Random.RandRange(0, NavGraph->Num() - 1));
+		}
+		TArray<int32> FlowFieldAgents = AStarAgents;
+		int32 TargetIndex = Random.RandRange(0, NavGraph->Num() - 1);
+
+		FNavigationSearchScratch Scratch;
+		FNavigationFlowField FlowField;
+		TArray<FVector> Path;
+		double AStarSeconds = 0.0;
+		double BuildSeconds = 0.0;
+		double LookupSeconds = 0.0;
+		int32 Mismatches = 0;
+		for (int32 Step = 0; Step < NumSteps; Step++)
+		{
+			// Every agent wants its next node towards where the target is now, then takes one step.
+			double StartTime = FPlatformTime::Seconds();
+			for (int32& AgentIndex : AStarAgents)
+			{
+				if (FNavigationSearch::FindPath(*NavGraph, AgentIndex, TargetIndex, Scratch, Path) && Path.Num() > 1)
+				{
+					AgentIndex = NavGraph->FindNearestNode(Path[Path.Num() - 2]);
+				}
+			}
+			AStarSeconds += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			FlowField.Build(NavGraph, TargetIndex);
+			BuildSeconds += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			for (int32& AgentIndex : FlowFieldAgents)
+			{
+				const int32 NextIndex = FlowField.GetNextNode(AgentIndex);
+				if (NextIndex != INDEX_NONE)
+				{
+					AgentIndex = NextIndex;
+				}
+			}
+			LookupSeconds += FPlatformTime::Seconds() - StartTime;
+
+			// The two crowds can break ties differently and drift apart, so check the field at the A* agents' nodes.
+			for (const int32 AgentIndex : AStarAgents)
+			{
+				FNavigationSearch::FindPath(*NavGraph, AgentIndex, TargetIndex, Scratch, Path);
+				const float AStarDistance = Path.IsEmpty() ? UE_MAX_FLT : GetPathLength(Path);
+				if (!FMath::IsNearlyEqual(AStarDistance, FlowField.GetDistance(AgentIndex), 1.0f))
+				{
+					Mismatches++;
+				}
+			}
+
+			const int32 Begin = NavGraph->GetNeighbourBegin(TargetIndex);
+			const int32 End = NavGraph->GetNeighbourEnd(TargetIndex);
+			if (End > Begin)
+			{
+				TargetIndex = NavGraph->Neighbours[Random.RandRange(Begin, End - 1)];
+			}
+		}
+
+		const double FlowFieldSeconds = BuildSeconds + LookupSeconds;
+		UE_LOG(LogTemp, Display, TEXT("Flow field benchmark, %d agents, %dx%d grid (%d nodes), %d target moves, %d mismatched distances:"),
+			NumAgents, GridSize, GridSize, NavGraph->Num(), NumSteps, Mismatches)
+		UE_LOG(LogTemp, Display, TEXT("  A* per agent: %.3f ms/move"), AStarSeconds * 1000.0 / NumSteps)
+		UE_LOG(LogTemp, Display, TEXT("  Flow field:   %.3f ms/move (%.3f ms build, %.3f us lookups), %.1f KB (%.1fx)"),
+			FlowFieldSeconds * 1000.0 / NumSteps, BuildSeconds * 1000.0 / NumSteps, LookupSeconds * 1e6 / NumSteps,
+			FlowField.GetAllocatedSize() / 1024.0, FlowFieldSeconds > 0.0 ? AStarSeconds / FlowFieldSeconds : 0.0)
+	}
+
+	/**
+	 * Times connecting the nodes of square dungeons of increasing size with the spatial hash, and with the original
+	 * nested loops over every pair of nodes on the sizes where that finishes in reasonable time.
+	 * @param MaxGridSize The number of rooms along each side of the largest dungeon.
+	 */
+	static void RunGraphConstruction(int32 MaxGridSize)
+	{
+		constexpr float RoomSize = 500.0f;
+		constexpr int32 MaxBruteForceNodes = 20000;
+		FRandomStream Random(1234);
+		UE_LOG(LogTemp, Display, TEXT("Graph construction benchmark:"))
+
+		for (int32 GridSize = 25; GridSize <= MaxGridSize; GridSize *= 2)
+		{
+			TArray<FVector> Positions;
+			TArray<ENavigationNodeKind> Kinds;
+			for (int32 Y = 0; Y < GridSize; Y++)
+			{
+				for (int32 X = 0; X < GridSize; X++)
+				{
+					Positions.Add(FVector(X * RoomSize, Y * RoomSize, 0.0f));
+					Kinds.Add(Random.FRand() < 0.3f ? ENavigationNodeKind::Corridor : ENavigationNodeKind::Room);
+				}
+			}
+
+			TArray<TArray<int32>> HashAdjacency;
+			double StartTime = FPlatformTime::Seconds();
+			UPathfindingSubsystem::ConnectDungeonNodes(Positions, Kinds, RoomSize, HashAdjacency);
+			const double HashSeconds = FPlatformTime::Seconds() - StartTime;
+
+			if (Positions.Num() > MaxBruteForceNodes)
+			{
+				UE_LOG(LogTemp, Display, TEXT("  %dx%d rooms (%d nodes): spatial hash %.2f ms, all pairs skipped"),
+					GridSize, GridSize, Positions.Num(), HashSeconds * 1000.0)
+				continue;
+			}
+
+			TArray<TArray<int32>> BruteForceAdjacency;
+			StartTime = FPlatformTime::Seconds();
+			ConnectDungeonNodesAllPairs(Positions, Kinds, RoomSize, BruteForceAdjacency);
+			const double BruteForceSeconds = FPlatformTime::Seconds() - StartTime;
+
+			int32 Mismatches = 0;
+			for (int32 i = 0; i < Positions.Num(); i++)
+			{
+				HashAdjacency[i].Sort();
+				BruteForceAdjacency[i].Sort();
+				if (HashAdjacency[i] != BruteForceAdjacency[i])
+				{
+					Mismatches++;
+				}
+			}
+
+			UE_LOG(LogTemp, Display, TEXT("  %dx%d rooms (%d nodes): spatial hash %.2f ms, all pairs %.2f ms (%.1fx), %d nodes with mismatched connections"),
+				GridSize, GridSize, Positions.Num(), HashSeconds * 1000.0, BruteForceSeconds * 1000.0,
+				HashSeconds > 0.0 ? BruteForceSeconds / HashSeconds : 0.0, Mismatches)
+		}
+	}
+
+	/**
+	 * Compares placing generated nodes as ANavigationNode actors, the way the dungeon and landscape generators used to,
+	 * with placing them as node data.
+	 * @param World The world to spawn the actors into.
+	 * @param NumNodes The number of nodes to place.
+	 */
+	static void RunNodePlacement(UWorld* World, int32 NumNodes)
+	{
+		if (!World) return;
+
+		const FVector Origin(0.0f, 0.0f, -100000.0f);
+		TArray<ANavigationNode*> Actors;
+		Actors.Reserve(NumNodes);
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumNodes; i++)
+		{
+			if (ANavigationNode* Node = World->SpawnActor<ANavigationNode>(Origin + FVector(i * 100.0f, 0.0f, 0.0f), FRotator::ZeroRotator))
+			{
+				Actors.Add(Node);
+			}
+		}
+		const double ActorSeconds = FPlatformTime::Seconds() - StartTime;
+		SIZE_T ActorBytes = 0;
+		for (const ANavigationNode* Node : Actors)
+		{
+			ActorBytes += Node->GetClass()->GetStructureSize() + Node->LocationComponent->GetClass()->GetStructureSize();
+		}
+		DestroyGraph(World, Actors);
+
+		TArray<FNavigationNodeData> NodeData;
+		StartTime = FPlatformTime::Seconds();
+		NodeData.SetNum(NumNodes);
+		for (int32 i = 0; i < NumNodes; i++)
+		{
+			NodeData[i].Location = Origin + FVector(i * 100.0f, 0.0f, 0.0f);
+		}
+		const double DataSeconds = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogTemp, Display, TEXT("Node placement benchmark, %d nodes:"), NumNodes)
+		UE_LOG(LogTemp, Display, TEXT("  Actors:    %.2f ms, at least %.1f KB"), ActorSeconds * 1000.0, ActorBytes / 1024.0)
+		UE_LOG(LogTemp, Display, TEXT("  Node data: %.2f ms, %.1f KB (%.1fx)"), DataSeconds * 1000.0, NodeData.GetAllocatedSize() / 1024.0,
+			DataSeconds > 0.0 ? ActorSeconds / DataSeconds : 0.0)
+	}
+
+	/**
+	 * Compares the ways the current level's graph can be made ready on begin play: gathering the node actors, connecting
+	 * the generated dungeon nodes again, laying the dungeon out again from its generator's settings and loading the
+	 * level's baked graph. Each one includes building the snapshot. Runs headless, for example with
+	 * DungeonMap -nullrhi -ExecCmds="AGP.Pathfinding.BenchmarkStartup,Quit".
+	 * @param World The world whose UPathfindingSubsystem will be benchmarked. Its level must have been baked.
+	 * @param NumIterations How many times to repeat each one.
+	 */
+	static void RunStartup(UWorld* World, int32 NumIterations)
+	{
+		UPathfindingSubsystem* Subsystem = World ? World->GetSubsystem<UPathfindingSubsystem>() : nullptr;
+		if (!Subsystem)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unable to find the PathfindingSubsystem to benchmark."))
+			return;
+		}
+
+		TArray<ANavigationNode*> SavedNodes = Subsystem->Nodes;
+		TArray<FNavigationNodeData> SavedNodeData = Subsystem->NodeData;
+		const bool bSavedGeneratedNodes = Subsystem->bGeneratedNodes;
+		const float SavedRoomSize = Subsystem->DungeonRoomSize;
+
+		// The bake is only loaded for the nodes it was baked from, so bring NodeData up to date with the level first. The
+		// load time includes hashing NodeData to check it.
+		Subsystem->GetGraphSnapshot();
+		const FNavigationGraphBuildSettings Settings = Subsystem->GetBuildSettings(Subsystem->NodeData.Num(), Subsystem->DungeonRoomSize);
+		FNavigationGraphPtr BakedGraph;
+		double LoadSeconds = 0.0;
+		for (int32 i = 0; i < NumIterations; i++)
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			BakedGraph = Subsystem->LoadBakedGraph(Settings);
+			if (!BakedGraph)
+			{
+				UE_LOG(LogTemp, Error, TEXT("The level has no baked graph at %s that matches its nodes. Save the level or run AGP.Pathfinding.BakeGraph first."),
+					*UPathfindingSubsystem::GetBakedGraphPath(*World))
+				return;
+			}
+			LoadSeconds += FPlatformTime::Seconds() - StartTime;
+		}
+
+		// Generated dungeons are made again from the node positions their generator saved with the level.
+		double ConnectSeconds = 0.0;
+		if (Subsystem->DungeonRoomSize > 0.0f)
+		{
+			TArray<FVector> Positions;
+			TArray<ENavigationNodeKind> Kinds;
+			for (const FNavigationNodeData& Node : Subsystem->NodeData)
+			{
+				Positions.Add(Node.Location);
+				Kinds.Add(Node.Kind);
+			}
+			for (int32 i = 0; i < NumIterations; i++)
+			{
+				const double StartTime = FPlatformTime::Seconds();
+				TArray<TArray<int32>> Adjacency;
+				UPathfindingSubsystem::ConnectDungeonNodes(Positions, Kinds, Subsystem->DungeonRoomSize, Adjacency);
+				for (int32 NodeIndex = 0; NodeIndex < Adjacency.Num(); NodeIndex++)
+				{
+					Subsystem->NodeData[NodeIndex].ConnectedNodes = MoveTemp(Adjacency[NodeIndex]);
+				}
+				Subsystem->MarkGraphDirty();
+				Subsystem->RebuildGraph();
+				ConnectSeconds += FPlatformTime::Seconds() - StartTime;
+			}
+		}
+
+		// Levels with a dungeon generator can also lay the dungeon out again from its settings, as they had to before the
+		// generator saved its nodes with the level. Only the layout is made, nothing is spawned.
+		double RegenerateSeconds = 0.0;
+		int32 NumRegenerated = 0;
+		TActorIterator<ADungeonGenerator> Generator(World);
+		if (Generator)
+		{
+			for (int32 i = 0; i < NumIterations; i++)
+			{
+				const double StartTime = FPlatformTime::Seconds();
+				FDungeonLayout Layout;
+				ADungeonGenerator::MakeLayout(Generator->GridSizeX, Generator->GridSizeY, Generator->RoomSize, Generator->RoomTypes,
+					Generator->RandomSeed, Layout);
+				TArray<TArray<int32>> Adjacency;
+				UPathfindingSubsystem::ConnectDungeonNodes(Layout.NodeLocations, Layout.NodeKinds, Generator->RoomSize, Adjacency);
+				Subsystem->NodeData.SetNum(Layout.NodeLocations.Num());
+				for (int32 NodeIndex = 0; NodeIndex < Adjacency.Num(); NodeIndex++)
+				{
+					FNavigationNodeData& Node = Subsystem->NodeData[NodeIndex];
+					Node = FNavigationNodeData();
+					Node.Location = Layout.NodeLocations[NodeIndex];
+					Node.Kind = Layout.NodeKinds[NodeIndex];
+					Node.ConnectedNodes = MoveTemp(Adjacency[NodeIndex]);
+				}
+				Subsystem->bGeneratedNodes = true;
+				Subsystem->MarkGraphDirty();
+				Subsystem->RebuildGraph();
+				RegenerateSeconds += FPlatformTime::Seconds() - StartTime;
+				NumRegenerated = Layout.NodeLocations.Num();
+			}
+		}
+
+		double GatherSeconds = 0.0;
+		int32 NumActors = 0;
+		for (int32 i = 0; i < NumIterations; i++)
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			Subsystem->PopulateNodes();
+			Subsystem->RebuildGraph();
+			GatherSeconds += FPlatformTime::Seconds() - StartTime;
+			NumActors = Subsystem->Nodes.Num();
+		}
+
+		Subsystem->Nodes = MoveTemp(SavedNodes);
+		Subsystem->NodeData = MoveTemp(SavedNodeData);
+		Subsystem->bGeneratedNodes = bSavedGeneratedNodes;
+		Subsystem->DungeonRoomSize = SavedRoomSize;
+		Subsystem->RebuildNodeIndices();
+		Subsystem->MarkGraphDirty();
+
+		UE_LOG(LogTemp, Display, TEXT("Startup benchmark for %s, %d iterations:"), *UPathfindingSubsystem::GetBakedGraphPath(*World), NumIterations)
+		UE_LOG(LogTemp, Display, TEXT("  Gather node actors:   %.3f ms (%d actors)"), GatherSeconds * 1000.0 / NumIterations, NumActors)
+		if (ConnectSeconds > 0.0)
+		{
+			UE_LOG(LogTemp, Display, TEXT("  Connect dungeon data: %.3f ms"), ConnectSeconds * 1000.0 / NumIterations)
+		}
+		if (RegenerateSeconds > 0.0)
+		{
+			UE_LOG(LogTemp, Display, TEXT("  Regenerate dungeon:   %.3f ms (%d nodes)"), RegenerateSeconds * 1000.0 / NumIterations,
+				NumRegenerated)
+		}
+		UE_LOG(LogTemp, Display, TEXT("  Load baked graph:     %.3f ms (%d nodes, %s routing table)"), LoadSeconds * 1000.0 / NumIterations,
+			BakedGraph->Num(), BakedGraph->RoutingTable.IsBuilt() ? TEXT("with") : TEXT("without"))
+	}
+
+	/**
+	 * Compares the number of nodes A* expands on generated dungeon layouts with the straight line heuristic and with
+	 * landmark lower bounds, for a range of landmark counts.
+	 * @param GridSize The number of rooms along each side of the dungeon.
+	 * @param NumQueries The number of random start/end pairs to search between.
+	 * @param MaxLandmarks The most landmarks to try, doubling from 1.
+	 */
+	static void RunLandmarks(int32 GridSize, int32 NumQueries, int32 MaxLandmarks)
+	{
+		constexpr float RoomSize = 500.0f;
+		FRandomStream Random(1234);
+		TArray<FVector> Positions;
+		TArray<ENavigationNodeKind> Kinds;
+		TArray<TArray<int32>> Adjacency;
+		MakeDungeonLayout(GridSize, RoomSize, Random, Positions, Kinds);
+		UPathfindingSubsystem::ConnectDungeonNodes(Positions, Kinds, RoomSize, Adjacency);
+		if (Positions.Num() < 2) return;
+
+		const FNavigationGraphPtr PlainGraph = FNavigationGraph::Build(Positions, Adjacency, 1);
+		TArray<TPair<int32, int32>> Queries;
+		for (int32 i = 0; i < NumQueries; i++)
+		{
+			Queries.Emplace(Random.RandRange(0, PlainGraph->Num() - 1), Random.RandRange(0, PlainGraph->Num() - 1));
+		}
+
+		FNavigationSearchScratch Scratch;
+		TArray<FVector> Path;
+		auto RunQueries = [&Queries, &Scratch, &Path](const FNavigationGraph& Graph, int64& OutExpanded, double& OutSeconds, TArray<float>& OutLengths)
+		{
+			OutExpanded = 0;
+			const double StartTime = FPlatformTime::Seconds();
+			for (const TPair<int32, int32>& Query : Queries)
+			{
+				int32 NumExpanded = 0;
+				FNavigationSearch::BeginSearch(Graph, Query.Key, Query.Value, Scratch);
+				const bool bFound = FNavigationSearch::ExpandSearch(Graph, Query.Value, Scratch, MAX_int32, NumExpanded) == ENavigationSearchStatus::Succeeded;
+				Path.Reset();
+				if (bFound)
+				{
+					TNavigationSearch<FNavigationGraphAdapter>::ReconstructPath(FNavigationGraphAdapter(Graph), Scratch, Query.Value, Path);
+				}
+				OutLengths.Add(bFound ? GetPathLength(Path) : -1.0f);
+				OutExpanded += NumExpanded;
+			}
+			OutSeconds = FPlatformTime::Seconds() - StartTime;
+		};
+
+		int64 PlainExpanded = 0;
+		double PlainSeconds = 0.0;
+		TArray<float> PlainLengths;
+		RunQueries(*PlainGraph, PlainExpanded, PlainSeconds, PlainLengths);
+		UE_LOG(LogTemp, Display, TEXT("Landmark benchmark on a %dx%d room dungeon (%d nodes), %d queries:"), GridSize, GridSize,
+			PlainGraph->Num(), NumQueries)
+		UE_LOG(LogTemp, Display, TEXT("  Straight line: %.1f nodes expanded/query, %.3f ms/query"),
+			static_cast<double>(PlainExpanded) / NumQueries, PlainSeconds * 1000.0 / NumQueries)
+
+		for (int32 NumLandmarks = 1; NumLandmarks <= MaxLandmarks; NumLandmarks *= 2)
+		{
+			FNavigationGraphBuildSettings Settings;
+			Settings.NumLandmarks = NumLandmarks;
+			const double StartTime = FPlatformTime::Seconds();
+			const FNavigationGraphPtr LandmarkGraph = FNavigationGraph::Build(Positions, Adjacency, 1, Settings);
+			const double BuildSeconds = FPlatformTime::Seconds() - StartTime;
+
+			int64 LandmarkExpanded = 0;
+			double LandmarkSeconds = 0.0;
+			TArray<float> LandmarkLengths;
+			RunQueries(*LandmarkGraph, LandmarkExpanded, LandmarkSeconds, LandmarkLengths);
+			int32 Mismatches = 0;
+			for (int32 i = 0; i < NumQueries; i++)
+			{
+				Mismatches += FMath::IsNearlyEqual(PlainLengths[i], LandmarkLengths[i], 1.0f) ? 0 : 1;
+			}
+
+			UE_LOG(LogTemp, Display, TEXT("  %2d landmarks:  %.1f nodes expanded/query (%.1f%% fewer), %.3f ms/query, built in %.2f ms using %.1f KB, %d mismatched paths"),
+				NumLandmarks, static_cast<double>(LandmarkExpanded) / NumQueries,
+				PlainExpanded > 0 ? 100.0 * (PlainExpanded - LandmarkExpanded) / PlainExpanded : 0.0,
+				LandmarkSeconds * 1000.0 / NumQueries, BuildSeconds * 1000.0, LandmarkGraph->Landmarks.GetAllocatedSize() / 1024.0, Mismatches)
+		}
+	}
+
+	/**
+	 * Runs the same queries over synthetic grids, random geometric graphs and generated dungeon layouts from 100 nodes up
+	 * to MaxNodes, through the search the subsystem uses, with whichever routing table or hierarchy the subsystem's
+	 * console variables would give a graph that size. Every path is checked against a plain Dijkstra search and the
+	 * results are written to a CSV file in the profiling folder, so they can be compared across commits. Runs headless,
+	 * for example with -nullrhi -ExecCmds="AGP.Pathfinding.BenchmarkSuite,Quit".
+	 * @param MaxNodes The rough node count of the largest graphs.
+	 * @param NumQueries The number of random start/end pairs to search between on each graph.
+	 * @param Label Written into every row, such as the commit being measured.
+	 */
+	static void RunSuite(int32 MaxNodes, int32 NumQueries, const FString& Label)
+	{
+		FString Csv = TEXT("Label,Graph,Nodes,Edges,ConnectMs,BuildMs,Accelerator,Landmarks,GraphKB,Queries,Unreachable,Suboptimal,")
+			TEXT("MeanUs,P50Us,P90Us,P99Us,MaxUs,MeanExpanded,AllocsPerQuery\n");
+		UE_LOG(LogTemp, Display, TEXT("Pathfinding benchmark suite up to %d nodes, %d queries per graph:"), MaxNodes, NumQueries)
+
+		constexpr float Spacing = 100.0f;
+		for (int32 TargetNodes = 100; TargetNodes <= MaxNodes; TargetNodes *= 10)
+		{
+			for (const TCHAR* GraphType : { TEXT("Grid"), TEXT("Geometric"), TEXT("Dungeon") })
+			{
+				FRandomStream Random(1234);
+				TArray<FVector> Positions;
+				TArray<TArray<int32>> Adjacency;
+				double StartTime = FPlatformTime::Seconds();
+				if (FCString::Strcmp(GraphType, TEXT("Grid")) == 0)
+				{
+					// A fifth of the cells are walls.
+					const int32 GridSize = FMath::CeilToInt32(FMath::Sqrt(TargetNodes / 0.8f));
+					MakeGridGraph(GridSize, Spacing, 0.2f, Random, Positions, Adjacency);
+				}
+				else if (FCString::Strcmp(GraphType, TEXT("Geometric")) == 0)
+				{
+					MakeGeometricGraph(TargetNodes, Spacing, Random, Positions, Adjacency);
+				}
+				else
+				{
+					// Around three quarters of a node per cell of the room grid, between the rooms and the corridor ends.
+					const int32 GridSize = FMath::CeilToInt32(FMath::Sqrt(TargetNodes / 0.75f));
+					TArray<ENavigationNodeKind> Kinds;
+					MakeDungeonLayout(GridSize, Spacing, Random, Positions, Kinds);
+					UPathfindingSubsystem::ConnectDungeonNodes(Positions, Kinds, Spacing, Adjacency);
+				}
+				const double ConnectSeconds = FPlatformTime::Seconds() - StartTime;
+				if (Positions.Num() < 2) continue;
+
+				StartTime = FPlatformTime::Seconds();
+				const FNavigationGraphPtr NavGraph = FNavigationGraph::Build(Positions, Adjacency, 1, GetSubsystemBuildSettings(Positions.Num(), Spacing));
+				const double BuildSeconds = FPlatformTime::Seconds() - StartTime;
+				Adjacency.Empty();
+
+				TArray<TPair<int32, int32>> Queries;
+				for (int32 i = 0; i < NumQueries; i++)
+				{
+					Queries.Emplace(Random.RandRange(0, NavGraph->Num() - 1), Random.RandRange(0, NavGraph->Num() - 1));
+				}
+
+				// One query object is reused for all of them, the same as the subsystem's time sliced searches, and a
+				// first query sizes its scratch so the allocations counted are the ones every query makes.
+				FNavigationSearchQuery Query;
+				TArray<FVector> Path;
+				Query.Start(NavGraph, Queries[0].Key, Queries[0].Value);
+				Query.Step(MAX_int32);
+				Query.GetPath(Path);
+
+				TArray<double> Latencies;
+				TArray<TArray<FVector>> Paths;
+				Latencies.Reserve(NumQueries);
+				Paths.Reserve(NumQueries);
+				int64 TotalExpanded = 0;
+				uint64 NumAllocations = 0;
+				{
+					FAllocationCounter AllocationCounter;
+					for (const TPair<int32, int32>& Pair : Queries)
+					{
+						const uint64 StartCycles = FPlatformTime::Cycles64();
+						Query.Start(NavGraph, Pair.Key, Pair.Value);
+						Query.Step(MAX_int32);
+						Query.GetPath(Path);
+						Latencies.Add(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles) * 1e6);
+						TotalExpanded += Query.GetNumExpanded();
+
+						// Keeping the path is left out of the count.
+						AllocationCounter.Pause();
+						Paths.Add(Path);
+						AllocationCounter.Resume();
+					}
+					NumAllocations = AllocationCounter.GetNumAllocations();
+				}
+				Query.Reset();
+
+				int32 Unreachable = 0;
+				int32 Suboptimal = 0;
+				TArray<float> Distances;
+				FIndexedMinHeap OpenSet;
+				for (int32 i = 0; i < Queries.Num(); i++)
+				{
+					const float Reference = GetShortestDistance(*NavGraph, Queries[i].Key, Queries[i].Value, Distances, OpenSet);
+					if (Reference >= UE_MAX_FLT)
+					{
+						Unreachable++;
+						Suboptimal += Paths[i].IsEmpty() ? 0 : 1;
+					}
+					else if (Paths[i].IsEmpty() || GetPathLength(Paths[i]) > Reference * 1.001f + 1.0f)
+					{
+						Suboptimal++;
+					}
+				}
+
+				Latencies.Sort();
+				double TotalLatency = 0.0;
+				for (const double Latency : Latencies)
+				{
+					TotalLatency += Latency;
+				}
+				const TCHAR* Accelerator = NavGraph->RoutingTable.IsBuilt() ? TEXT("RoutingTable")
+					: NavGraph->Hierarchy.IsBuilt() ? TEXT("Hierarchy") : TEXT("None");
+				const FString Row = FString::Printf(TEXT("%s,%s,%d,%d,%.3f,%.3f,%s,%d,%.1f,%d,%d,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.1f,%.2f"),
+					*Label, GraphType, NavGraph->Num(), NavGraph->NumEdges(), ConnectSeconds * 1000.0, BuildSeconds * 1000.0,
+					Accelerator, NavGraph->Landmarks.GetNumLandmarks(), NavGraph->GetAllocatedSize() / 1024.0, NumQueries, Unreachable, Suboptimal,
+					TotalLatency / NumQueries, GetPercentile(Latencies, 0.5), GetPercentile(Latencies, 0.9),
+					GetPercentile(Latencies, 0.99), Latencies.Last(), static_cast<double>(TotalExpanded) / NumQueries,
+					static_cast<double>(NumAllocations) / NumQueries);
+				Csv += Row + TEXT("\n");
+				UE_LOG(LogTemp, Display, TEXT("  %s"), *Row)
+			}
+		}
+
+		const FString CsvPath = FPaths::ProfilingDir() / TEXT("Pathfinding")
+			/ FString::Printf(TEXT("BenchmarkSuite-%s.csv"), *FDateTime::Now().ToString());
+		if (FFileHelper::SaveStringToFile(Csv, *CsvPath))
+		{
+			UE_LOG(LogTemp, Display, TEXT("Wrote the benchmark suite results to %s"), *FPaths::ConvertRelativePathToFull(CsvPath))
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unable to write the benchmark suite results to %s"), *CsvPath)
+		}
+	}
+
+	/**
+	 * Compares the ways of checking landscape vertices for solid ground: one trace at a time with a hit result and a
+	 * debug line each, the way PlaceProceduralNodes used to, and UPathfindingSubsystem::ProbeGround tracing serially and
+	 * across the workers.
+	 * @param World The world to trace against, with a landscape or other ground around the origin.
+	 * @param GridSize The width and height of the grid of locations to probe, 100 units apart around the origin.
+	 */
+	static void RunGroundProbes(UWorld* World, int32 GridSize)
+	{
+		UPathfindingSubsystem* Subsystem = World ? World->GetSubsystem<UPathfindingSubsystem>() : nullptr;
+		if (!Subsystem) return;
+
+		TArray<FVector> Locations;
+		Locations.Reserve(GridSize * GridSize);
+		for (int32 Y = 0; Y < GridSize; Y++)
+		{
+			for (int32 X = 0; X < GridSize; X++)
+			{
+				Locations.Emplace((X - GridSize / 2) * 100.0f, (Y - GridSize / 2) * 100.0f, 0.0f);
+			}
+		}
+
+		double StartTime = FPlatformTime::Seconds();
+		int32 NumOldHits = 0;
+		for (const FVector& Location : Locations)
+		{
+			const FVector Start = Location + FVector(0.0f, 0.0f, 100.0f);
+			const FVector End = Location - FVector(0.0f, 0.0f, 1000.0f);
+			FHitResult HitResult;
+			const bool bHit = World->LineTraceSingleByChannel(HitResult, Start, End, ECC_Visibility);
+			DrawDebugLine(World, Start, End, bHit ? FColor::Green : FColor::Red, false, 1.0f);
+			NumOldHits += bHit ? 1 : 0;
+		}
+		const double OldSeconds = FPlatformTime::Seconds() - StartTime;
+
+		IConsoleVariable* ParallelVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("AGP.Pathfinding.ParallelGroundProbes"));
+		const int32 OldParallel = ParallelVariable ? ParallelVariable->GetInt() : 1;
+		auto TimeProbes = [Subsystem, ParallelVariable, &Locations](int32 bParallel, int32& OutNumHits)
+		{
+			if (ParallelVariable)
+			{
+				ParallelVariable->Set(bParallel, ECVF_SetByConsole);
+			}
+			TArray<bool> AboveGround;
+			const double Start = FPlatformTime::Seconds();
+			Subsystem->ProbeGround(Locations, AboveGround);
+			const double Seconds = FPlatformTime::Seconds() - Start;
+			OutNumHits = Algo::Count(AboveGround, true);
+			return Seconds;
+		};
+		int32 NumSerialHits = 0;
+		int32 NumParallelHits = 0;
+		const double SerialSeconds = TimeProbes(0, NumSerialHits);
+		const double ParallelSeconds = TimeProbes(1, NumParallelHits);
+		if (ParallelVariable)
+		{
+			ParallelVariable->Set(OldParallel, ECVF_SetByConsole);
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("Ground probe benchmark, %d locations:"), Locations.Num())
+		UE_LOG(LogTemp, Display, TEXT("  Single traces with debug lines: %.2f ms, %d above ground"), OldSeconds * 1000.0, NumOldHits)
+		UE_LOG(LogTemp, Display, TEXT("  Test traces, serial:            %.2f ms, %d above ground (%.1fx)"), SerialSeconds * 1000.0,
+			NumSerialHits, SerialSeconds > 0.0 ? OldSeconds / SerialSeconds : 0.0)
+		UE_LOG(LogTemp, Display, TEXT("  Test traces, parallel:          %.2f ms, %d above ground (%.1fx)"), ParallelSeconds * 1000.0,
+			NumParallelHits, ParallelSeconds > 0.0 ? OldSeconds / ParallelSeconds : 0.0)
+		if (NumSerialHits != NumOldHits || NumParallelHits != NumOldHits)
+		{
+			UE_LOG(LogTemp, Error, TEXT("  The batched probes disagree with the single traces"))
+		}
+	}
+
+	/**
+	 * Counts the heap allocations made per path query once repathing has reached a steady state, for the by value
+	 * queries, the queries that write into a caller's path with and without the path cache, and batched requests. The
+	 * synchronous queries into a reused path are expected to make none, and an error is logged if they do.
+	 * @param World The world whose UPathfindingSubsystem will be measured. Its nodes are put back afterwards.
+	 * @param GridSize The number of rooms along each side of the generated dungeon to search.
+	 * @param NumQueries The number of random start/end pairs, each searched once to warm up and once measured.
+	 */
+	static void RunPathAllocations(UWorld* World, int32 GridSize, int32 NumQueries)
+	{
+		UPathfindingSubsystem* Subsystem = World ? World->GetSubsystem<UPathfindingSubsystem>() : nullptr;
+		if (!Subsystem)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unable to find the PathfindingSubsystem to benchmark."))
+			return;
+		}
+
+		FRandomStream Random(1234);
+		FSavedNodes SavedNodes;
+		const TArray<FVector> Positions = SwapInDungeon(Subsystem, GridSize, Random, SavedNodes);
+
+		TArray<TPair<FVector, FVector>> Queries;
+		for (int32 i = 0; i < NumQueries; i++)
+		{
+			Queries.Emplace(Positions[Random.RandRange(0, Positions.Num() - 1)], Positions[Random.RandRange(0, Positions.Num() - 1)]);
+		}
+
+		IConsoleVariable* CacheSizeVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("AGP.Pathfinding.PathCacheSize"));
+		const int32 SavedCacheSize = CacheSizeVariable ? CacheSizeVariable->GetInt() : 0;
+		auto SetCacheSize = [CacheSizeVariable](int32 CacheSize)
+		{
+			if (CacheSizeVariable)
+			{
+				CacheSizeVariable->Set(CacheSize, ECVF_SetByConsole);
+			}
+		};
+
+		// Every query is run once to let the scratch memory and buffers grow, then again while counting. The
+		// synchronous queries only count the game thread so the rest of the engine doesn't add noise.
+		const uint32 GameThreadId = FPlatformTLS::GetCurrentThreadId();
+		auto CountAllocations = [&Queries, GameThreadId](auto&& RunQuery, bool bAllThreads)
+		{
+			for (const TPair<FVector, FVector>& Query : Queries)
+			{
+				RunQuery(Query);
+			}
+			FAllocationCounter AllocationCounter(bAllThreads ? 0 : GameThreadId);
+			for (const TPair<FVector, FVector>& Query : Queries)
+			{
+				RunQuery(Query);
+			}
+			return static_cast<double>(AllocationCounter.GetNumAllocations()) / Queries.Num();
+		};
+
+		SetCacheSize(0);
+		const double ByValueAllocations = CountAllocations([Subsystem](const TPair<FVector, FVector>& Query)
+		{
+			const TArray<FVector> Path = Subsystem->GetPath(Query.Key, Query.Value);
+		}, false);
+		TArray<FVector> ReusedPath;
+		const double ReusedAllocations = CountAllocations([Subsystem, &ReusedPath](const TPair<FVector, FVector>& Query)
+		{
+			Subsystem->GetPath(Query.Key, Query.Value, ReusedPath);
+		}, false);
+		SetCacheSize(NumQueries);
+		const double CachedAllocations = CountAllocations([Subsystem, &ReusedPath](const TPair<FVector, FVector>& Query)
+		{
+			Subsystem->GetPath(Query.Key, Query.Value, ReusedPath);
+		}, false);
+
+		// Batched requests are solved on the workers, so every thread is counted. Each request is dispatched and
+		// delivered straight away so the benchmark doesn't have to wait for the world to tick.
+		SetCacheSize(0);
+		const double BatchedAllocations = CountAllocations([Subsystem, &ReusedPath](const TPair<FVector, FVector>& Query)
+		{
+			Subsystem->RequestPath(Query.Key, Query.Value, FOnPathRequestComplete::CreateLambda([&ReusedPath](const TArray<FVector>& Path)
+			{
+				ReusedPath.Reset();
+				ReusedPath.Append(Path);
+			}));
+			Subsystem->DispatchPathRequests();
+			if (Subsystem->InFlightBatch.IsValid())
+			{
+				Subsystem->InFlightBatch.Wait();
+				Subsystem->DeliverPathResults();
+			}
+		}, true);
+		SetCacheSize(SavedCacheSize);
+		RestoreNodes(Subsystem, MoveTemp(SavedNodes));
+
+		UE_LOG(LogTemp, Display, TEXT("Path allocation benchmark, %d nodes, %d queries, heap allocations per query:"), Positions.Num(), NumQueries)
+		UE_LOG(LogTemp, Display, TEXT("  By value:                  %.2f"), ByValueAllocations)
+		UE_LOG(LogTemp, Display, TEXT("  Into a reused path:        %.2f"), ReusedAllocations)
+		UE_LOG(LogTemp, Display, TEXT("  Into a reused path cached: %.2f"), CachedAllocations)
+		UE_LOG(LogTemp, Display, TEXT("  Batched request:           %.2f (the task launch and callback binding, on every thread)"), BatchedAllocations)
+		if (ReusedAllocations > 0.0 || CachedAllocations > 0.0)
+		{
+			UE_LOG(LogTemp, Error, TEXT("  Steady state queries into a reused path should not allocate"))
+		}
+	}
+
+	/**
+	 * Compares fleeing a threat towards the node furthest from it in a straight line, with a search per agent, against
+	 * fleeing along the shared escape field, on a generated dungeon. Also reports how far from the threat by path each
+	 * way ends up.
+	 * @param World The world whose UPathfindingSubsystem will be benchmarked. Its nodes are put back afterwards.
+	 * @param GridSize The number of rooms along each side of the dungeon.
+	 * @param NumAgents How many agents flee the threat.
+	 */
+	static void RunPathAway(UWorld* World, int32 GridSize, int32 NumAgents)
+	{
+		UPathfindingSubsystem* Subsystem = World ? World->GetSubsystem<UPathfindingSubsystem>() : nullptr;
+		if (!Subsystem)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unable to find the PathfindingSubsystem to benchmark."))
+			return;
+		}
+
+		FRandomStream Random(1234);
+		FSavedNodes SavedNodes;
+		const TArray<FVector> Positions = SwapInDungeon(Subsystem, GridSize, Random, SavedNodes);
+		const FNavigationGraphPtr NavGraph = Subsystem->GetGraphSnapshot();
+		const FVector ThreatLocation = Positions[Random.RandRange(0, Positions.Num() - 1)];
+		TArray<FVector> AgentLocations;
+		for (int32 i = 0; i < NumAgents; i++)
+		{
+			AgentLocations.Add(Positions[Random.RandRange(0, Positions.Num() - 1)]);
+		}
+
+		// The distance from where each path ends to the threat, by path.
+		FNavigationFlowField ThreatField;
+		ThreatField.Build(NavGraph, NavGraph->FindNearestNode(ThreatLocation));
+
+		IConsoleVariable* EscapeFieldsVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("AGP.Pathfinding.EscapeFields"));
+		const int32 SavedEscapeFields = EscapeFieldsVariable ? EscapeFieldsVariable->GetInt() : 1;
+		auto TimePathsAway = [Subsystem, &NavGraph, &ThreatField, &ThreatLocation, &AgentLocations, EscapeFieldsVariable](int32 bEscapeFields, double& OutMeanDistance)
+		{
+			if (EscapeFieldsVariable)
+			{
+				EscapeFieldsVariable->Set(bEscapeFields, ECVF_SetByConsole);
+			}
+			Subsystem->EscapeFields.Reset();
+			Subsystem->PathCache.Empty();
+
+			TArray<FVector> Path;
+			double TotalDistance = 0.0;
+			int32 NumPaths = 0;
+			double Seconds = 0.0;
+			for (const FVector& AgentLocation : AgentLocations)
+			{
+				const double StartTime = FPlatformTime::Seconds();
+				Subsystem->GetPathAway(AgentLocation, ThreatLocation, Path);
+				Seconds += FPlatformTime::Seconds() - StartTime;
+				if (!Path.IsEmpty())
+				{
+					const float Distance = ThreatField.GetDistance(NavGraph->FindNearestNode(Path[0]));
+					if (Distance < UE_MAX_FLT)
+					{
+						TotalDistance += Distance;
+						NumPaths++;
+					}
+				}
+			}
+			OutMeanDistance = NumPaths > 0 ? TotalDistance / NumPaths : 0.0;
+			return Seconds;
+		};
+		double StraightLineDistance = 0.0;
+		double EscapeFieldDistance = 0.0;
+		const double StraightLineSeconds = TimePathsAway(0, StraightLineDistance);
+		const double EscapeFieldSeconds = TimePathsAway(1, EscapeFieldDistance);
+		if (EscapeFieldsVariable)
+		{
+			EscapeFieldsVariable->Set(SavedEscapeFields, ECVF_SetByConsole);
+		}
+		RestoreNodes(Subsystem, MoveTemp(SavedNodes));
+
+		UE_LOG(LogTemp, Display, TEXT("Path away benchmark, %d nodes, %d agents fleeing one threat:"), Positions.Num(), NumAgents)
+		UE_LOG(LogTemp, Display, TEXT("  Furthest in a straight line: %.2f ms, ends %.0f from the threat by path on average"),
+			StraightLineSeconds * 1000.0, StraightLineDistance)
+		UE_LOG(LogTemp, Display, TEXT("  Escape field:                %.2f ms (%.1fx), ends %.0f from the threat by path on average, furthest is %.0f"),
+			EscapeFieldSeconds * 1000.0, EscapeFieldSeconds > 0.0 ? StraightLineSeconds / EscapeFieldSeconds : 0.0, EscapeFieldDistance,
+			ThreatField.GetDistance(ThreatField.FindFurthestNode()))
+	}
+
+	static void RunPatrol(UWorld* World, int32 GridSize, int32 NumAgents, int32 NumSteps)
+	{
+		UPathfindingSubsystem* Subsystem = World ? World->GetSubsystem<UPathfindingSubsystem>() : nullptr;
+		if (!Subsystem)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unable to find the PathfindingSubsystem to benchmark."))
+			return;
+		}
+
+		FRandomStream Random(1234);
+		FSavedNodes SavedNodes;
+		const TArray<FVector> Positions = SwapInDungeon(Subsystem, GridSize, Random, SavedNodes);
+		const FNavigationGraphPtr NavGraph = Subsystem->GetGraphSnapshot();
+		TArray<FVector> StartLocations;
+		for (int32 i = 0; i < NumAgents; i++)
+		{
+			StartLocations.Add(Positions[Random.RandRange(0, Positions.Num() - 1)]);
+		}
+
+		// Every agent takes NumSteps steps from node to node, either along random paths or along the circuits, and
+		// only the time spent asking the subsystem for the next steps is counted.
+		struct FCoverage
+		{
+			double Seconds = 0.0;
+			int32 NumQueries = 0;
+			int32 NumVisited = 0;
+			// Standard deviation over mean of how often each node was visited, lower is spread more evenly.
+			double VisitSpread = 0.0;
+		};
+		auto FinishCoverage = [](const TArray<int32>& Visits, FCoverage& Coverage)
+		{
+			double Mean = 0.0;
+			for (const int32 Count : Visits)
+			{
+				Coverage.NumVisited += Count > 0 ? 1 : 0;
+				Mean += Count;
+			}
+			Mean /= FMath::Max(1, Visits.Num());
+			double Variance = 0.0;
+			for (const int32 Count : Visits)
+			{
+				Variance += FMath::Square(Count - Mean);
+			}
+			Coverage.VisitSpread = Mean > 0.0 ? FMath::Sqrt(Variance / Visits.Num()) / Mean : 0.0;
+		};
+
+		FCoverage RandomCoverage;
+		{
+			Subsystem->PathCache.Empty();
+			TArray<int32> Visits;
+			Visits.SetNumZeroed(NavGraph->Num());
+			TArray<FVector> Path;
+			for (const FVector& StartLocation : StartLocations)
+			{
+				FVector Location = StartLocation;
+				Path.Reset();
+				for (int32 Step = 0; Step < NumSteps; Step++)
+				{
+					if (Path.IsEmpty())
+					{
+						const double StartTime = FPlatformTime::Seconds();
+						Subsystem->GetRandomPath(Location, Path);
+						RandomCoverage.Seconds += FPlatformTime::Seconds() - StartTime;
+						RandomCoverage.NumQueries++;
+						// The path starts at the node the agent is already on.
+						if (Path.Num() > 1)
+						{
+							Path.Pop(false);
+						}
+					}
+					if (!Path.IsEmpty())
+					{
+						Location = Path.Pop(false);
+					}
+					Visits[NavGraph->FindNearestNode(Location)]++;
+				}
+			}
+			FinishCoverage(Visits, RandomCoverage);
+		}
+
+		IConsoleVariable* PatrolCircuitsVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("AGP.Pathfinding.PatrolCircuits"));
+		const int32 SavedPatrolCircuits = PatrolCircuitsVariable ? PatrolCircuitsVariable->GetInt() : 1;
+		if (PatrolCircuitsVariable)
+		{
+			PatrolCircuitsVariable->Set(1, ECVF_SetByConsole);
+		}
+		Subsystem->PatrolCircuitsVersion = 0;
+		const double BuildStartTime = FPlatformTime::Seconds();
+		Subsystem->UpdatePatrolCircuits(*NavGraph);
+		const double BuildSeconds = FPlatformTime::Seconds() - BuildStartTime;
+		const int32 NumCircuits = Subsystem->PatrolCircuits.GetNumCircuits();
+		const SIZE_T CircuitBytes = Subsystem->PatrolCircuits.GetAllocatedSize();
+
+		FCoverage CircuitCoverage;
+		{
+			TArray<int32> Visits;
+			Visits.SetNumZeroed(NavGraph->Num());
+			for (const FVector& StartLocation : StartLocations)
+			{
+				FVector Location = StartLocation;
+				FNavigationPatrolRoute Route;
+				for (int32 Step = 0; Step < NumSteps; Step++)
+				{
+					const double StartTime = FPlatformTime::Seconds();
+					if (!Subsystem->AdvancePatrol(Route, Location))
+					{
+						Subsystem->StartPatrol(Location, Route, Location);
+					}
+					CircuitCoverage.Seconds += FPlatformTime::Seconds() - StartTime;
+					CircuitCoverage.NumQueries++;
+					Visits[NavGraph->FindNearestNode(Location)]++;
+				}
+			}
+			FinishCoverage(Visits, CircuitCoverage);
+		}
+		if (PatrolCircuitsVariable)
+		{
+			PatrolCircuitsVariable->Set(SavedPatrolCircuits, ECVF_SetByConsole);
+		}
+		RestoreNodes(Subsystem, MoveTemp(SavedNodes));
+
+		UE_LOG(LogTemp, Display, TEXT("Patrol benchmark, %d nodes, %d agents taking %d steps each:"), Positions.Num(), NumAgents, NumSteps)
+		UE_LOG(LogTemp, Display, TEXT("  Random paths:    %.2f ms over %d searches, visited %d nodes (%.1f%%), visit spread %.2f"),
+			RandomCoverage.Seconds * 1000.0, RandomCoverage.NumQueries, RandomCoverage.NumVisited,
+			100.0 * RandomCoverage.NumVisited / FMath::Max(1, Positions.Num()), RandomCoverage.VisitSpread)
+		UE_LOG(LogTemp, Display, TEXT("  Patrol circuits: %.2f ms (%.1fx) over %d steps, visited %d nodes (%.1f%%), visit spread %.2f"),
+			CircuitCoverage.Seconds * 1000.0, CircuitCoverage.Seconds > 0.0 ? RandomCoverage.Seconds / CircuitCoverage.Seconds : 0.0,
+			CircuitCoverage.NumQueries, CircuitCoverage.NumVisited, 100.0 * CircuitCoverage.NumVisited / FMath::Max(1, Positions.Num()),
+			CircuitCoverage.VisitSpread)
+		UE_LOG(LogTemp, Display, TEXT("  Built %d circuits in %.2f ms using %.1f KB"), NumCircuits, BuildSeconds * 1000.0, CircuitBytes / 1024.0)
+	}
+
+	/**
+	 * Times each instantiation of TNavigationSearch over the same random room to room queries on a generated dungeon,
+	 * searched as the node graph snapshot, as the dungeon grid and as plain adjacency lists. Path lengths are checked
+	 * against Dijkstra on the snapshot, so inadmissible pairings of heuristic and graph show up as longer paths.
+	 * @param GridSize The width and height of the dungeon in rooms.
+	 * @param NumQueries The number of random start/end pairs to search between.
+	 */
+	static void RunSearchPolicies(int32 GridSize, int32 NumQueries)
+	{
+		constexpr float RoomSize = 500.0f;
+		FRandomStream Random(1234);
+		FDungeonNavigationGrid DungeonGrid;
+		TArray<int32> CellNodes;
+		TArray<FVector> Positions;
+		TArray<TArray<int32>> Adjacency;
+		const TArray<FIntPoint> Rooms = MakeDungeonGrid(GridSize, RoomSize, Random, DungeonGrid, CellNodes, Positions, Adjacency);
+		if (Rooms.IsEmpty())
+		{
+			return;
+		}
+		FNavigationGraphBuildSettings Settings;
+		Settings.NumLandmarks = 8;
+		const FNavigationGraphPtr NavGraph = FNavigationGraph::Build(Positions, Adjacency, 0, Settings);
+
+		TArray<TPair<int32, int32>> NodeQueries;
+		TArray<TPair<int32, int32>> CellQueries;
+		for (int32 i = 0; i < NumQueries; i++)
+		{
+			const FIntPoint Start = Rooms[Random.RandRange(0, Rooms.Num() - 1)];
+			const FIntPoint End = Rooms[Random.RandRange(0, Rooms.Num() - 1)];
+			NodeQueries.Emplace(CellNodes[DungeonGrid.GetCellIndex(Start)], CellNodes[DungeonGrid.GetCellIndex(End)]);
+			CellQueries.Emplace(DungeonGrid.GetCellIndex(Start), DungeonGrid.GetCellIndex(End));
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("Search policy benchmark, %dx%d rooms (%d walkable cells), %d queries:"), GridSize, GridSize,
+			Positions.Num(), NumQueries)
+
+		// Dijkstra on the snapshot gives the shortest length of every query for the others to be checked against.
+		FNavigationSearchScratch Scratch;
+		const FNavigationGraphAdapter GraphAdapter(*NavGraph);
+		TArray<float> ShortestLengths;
+		TArray<float> Lengths;
+		{
+			TNavigationSearch<FNavigationGraphAdapter, FZeroHeuristic> Search(GraphAdapter, Scratch);
+			TimeSearchPolicy(TEXT("Graph, zero, stored costs"), Search, NodeQueries, nullptr, ShortestLengths);
+		}
+		{
+			TNavigationSearch<FNavigationGraphAdapter, FEuclideanHeuristic> Search(GraphAdapter, Scratch);
+			TimeSearchPolicy(TEXT("Graph, euclidean, stored costs"), Search, NodeQueries, &ShortestLengths, Lengths);
+		}
+		{
+			TNavigationSearch<FNavigationGraphAdapter, FLandmarkHeuristic> Search(GraphAdapter, Scratch, FLandmarkHeuristic(NavGraph->Landmarks));
+			TimeSearchPolicy(TEXT("Graph, landmarks, stored costs"), Search, NodeQueries, &ShortestLengths, Lengths);
+		}
+		{
+			TNavigationSearch<FNavigationGraphAdapter, FManhattanHeuristic> Search(GraphAdapter, Scratch);
+			TimeSearchPolicy(TEXT("Graph, manhattan, stored costs"), Search, NodeQueries, &ShortestLengths, Lengths);
+		}
+		{
+			TNavigationSearch<FNavigationGraphAdapter, FEuclideanHeuristic, FDistanceCost> Search(GraphAdapter, Scratch);
+			TimeSearchPolicy(TEXT("Graph, euclidean, distance costs"), Search, NodeQueries, &ShortestLengths, Lengths);
+		}
+
+		const FDungeonGridAdapter GridAdapter(DungeonGrid);
+		{
+			TNavigationSearch<FDungeonGridAdapter, FZeroHeuristic> Search(GridAdapter, Scratch);
+			TimeSearchPolicy(TEXT("Grid, zero, stored costs"), Search, CellQueries, &ShortestLengths, Lengths);
+		}
+		{
+			TNavigationSearch<FDungeonGridAdapter, FEuclideanHeuristic> Search(GridAdapter, Scratch);
+			TimeSearchPolicy(TEXT("Grid, euclidean, stored costs"), Search, CellQueries, &ShortestLengths, Lengths);
+		}
+		{
+			TNavigationSearch<FDungeonGridAdapter, FManhattanHeuristic> Search(GridAdapter, Scratch);
+			TimeSearchPolicy(TEXT("Grid, manhattan, stored costs"), Search, CellQueries, &ShortestLengths, Lengths);
+		}
+		{
+			TNavigationSearch<FDungeonGridAdapter, FZeroHeuristic, FUnitCost> Search(GridAdapter, Scratch);
+			TimeSearchPolicy(TEXT("Grid, zero, unit costs"), Search, CellQueries, &ShortestLengths, Lengths);
+		}
+
+		const FAdjacencyListAdapter ListAdapter{ Positions, Adjacency };
+		{
+			TNavigationSearch<FAdjacencyListAdapter, FEuclideanHeuristic, FDistanceCost> Search(ListAdapter, Scratch);
+			TimeSearchPolicy(TEXT("Adjacency lists, euclidean, distance"), Search, NodeQueries, &ShortestLengths, Lengths);
+		}
+
+		// The grid's own breadth first search, for reference.
+		TArray<FVector> Path;
+		const double StartTime = FPlatformTime::Seconds();
+		for (const TPair<int32, int32>& Query : CellQueries)
+		{
+			DungeonGrid.FindPath(DungeonGrid.GetCell(Query.Key), DungeonGrid.GetCell(Query.Value), Path);
+		}
+		UE_LOG(LogTemp, Display, TEXT("  %-38s %7.2f us/query"), TEXT("Grid, breadth first search"),
+			(FPlatformTime::Seconds() - StartTime) * 1e6 / CellQueries.Num())
+	}
+
+	/**
+	 * Runs path queries on worker threads against the published graph versions while the game thread keeps blocking
+	 * and unblocking connections, each of which publishes a new version.
+	 * @param World The world whose UPathfindingSubsystem will be benchmarked.
+	 * @param GridSize The width and height of the dungeon in rooms.
+	 * @param NumReaders The number of worker tasks querying at once.
+	 * @param NumEdits The number of connections to block and unblock on the game thread.
+	 */
+	static void RunConcurrentReaders(UWorld* World, int32 GridSize, int32 NumReaders, int32 NumEdits)
+	{
+		UPathfindingSubsystem* Subsystem = World ? World->GetSubsystem<UPathfindingSubsystem>() : nullptr;
+		if (!Subsystem)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unable to find the PathfindingSubsystem to benchmark."))
+			return;
+		}
+
+		FRandomStream Random(1234);
+		FSavedNodes SavedNodes;
+		const TArray<FVector> Positions = SwapInDungeon(Subsystem, GridSize, Random, SavedNodes);
+		const FNavigationGraphPtr NavGraph = Subsystem->GetGraphSnapshot();
+		if (NavGraph->NumEdges() == 0)
+		{
+			RestoreNodes(Subsystem, MoveTemp(SavedNodes));
+			return;
+		}
+		const uint64 PublishedBefore = Subsystem->GraphVersions.GetNumPublished();
+
+		std::atomic<bool> bStop{ false };
+		std::atomic<int64> NumQueries{ 0 };
+		std::atomic<int64> NumFound{ 0 };
+		std::atomic<uint32> NewestVersionSeen{ 0 };
+		TArray<UE::Tasks::FTask> Readers;
+		for (int32 i = 0; i < NumReaders; i++)
+		{
+			Readers.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [Subsystem, &Positions, &bStop, &NumQueries, &NumFound, &NewestVersionSeen, Seed = i]()
+			{
+				FRandomStream ReaderRandom(Seed);
+				TArray<FVector> Path;
+				while (!bStop.load())
+				{
+					// Pin once to see which version the query ran against, the query pins again itself.
+					const FNavigationGraphPtr Pinned = Subsystem->PinGraph();
+					uint32 Seen = NewestVersionSeen.load();
+					while (Pinned && Pinned->Version > Seen && !NewestVersionSeen.compare_exchange_weak(Seen, Pinned->Version))
+					{
+					}
+					const FVector& Start = Positions[ReaderRandom.RandRange(0, Positions.Num() - 1)];
+					const FVector& End = Positions[ReaderRandom.RandRange(0, Positions.Num() - 1)];
+					NumFound += Subsystem->GetPathOnAnyThread(Start, End, Path) ? 1 : 0;
+					NumQueries++;
+				}
+			}));
+		}
+
+		// Block and unblock random connections as fast as the game thread can build the new versions, publishing each
+		// edit straight away rather than once a tick.
+		int32 MaxRetired = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumEdits; i++)
+		{
+			const int32 Edge = Random.RandRange(0, NavGraph->NumEdges() - 1);
+			const int32 FromIndex = NavGraph->GetEdgeSource(Edge);
+			const int32 ToIndex = NavGraph->Neighbours[Edge];
+			Subsystem->SetConnectionBlocked(FromIndex, ToIndex, true);
+			Subsystem->ApplyPendingEdgeCosts();
+			Subsystem->SetConnectionBlocked(FromIndex, ToIndex, false);
+			Subsystem->ApplyPendingEdgeCosts();
+			MaxRetired = FMath::Max(MaxRetired, Subsystem->GraphVersions.GetNumRetired());
+		}
+		const double EditSeconds = FPlatformTime::Seconds() - StartTime;
+		bStop = true;
+		UE::Tasks::Wait(Readers);
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+		const uint64 Published = Subsystem->GraphVersions.GetNumPublished() - PublishedBefore;
+		const uint32 NewestVersion = Subsystem->GetGraphSnapshot()->Version;
+		RestoreNodes(Subsystem, MoveTemp(SavedNodes));
+
+		UE_LOG(LogTemp, Display, TEXT("Concurrent reader benchmark, %d nodes, %d readers, %d connections toggled:"), Positions.Num(),
+			NumReaders, NumEdits)
+		UE_LOG(LogTemp, Display, TEXT("  Game thread published %llu versions in %.2f ms (%.1f us each), at most %d retired versions waiting"),
+			Published, EditSeconds * 1000.0, Published > 0 ? EditSeconds * 1e6 / Published : 0.0, MaxRetired)
+		UE_LOG(LogTemp, Display, TEXT("  Readers ran %lld queries (%lld found) in %.2f ms, %.0f queries/s, newest version seen %u of %u"),
+			NumQueries.load(), NumFound.load(), Seconds * 1000.0, Seconds > 0.0 ? NumQueries.load() / Seconds : 0.0,
+			NewestVersionSeen.load(), NewestVersion)
+	}
+
+	/**
+	 * Times the enemy AI run by each enemy's own tick against the same enemies run in batches by the enemy AI manager,
+	 * for each number of enemies. The enemies are spawned on the level's navigation nodes and stay where they are, as
+	 * only the time spent deciding where to go is counted, not the character movement that follows.
+	 * @param NumFrames The number of AI updates to time for each number of enemies.
+	 * @param EnemyCounts The numbers of enemies to time.
+	 */
+	static void RunEnemyAI(UWorld* World, int32 NumFrames, const TArray<int32>& EnemyCounts)
+	{
+		UPathfindingSubsystem* Subsystem = World ? World->GetSubsystem<UPathfindingSubsystem>() : nullptr;
+		UEnemyAIManagerSubsystem* AIManager = World ? World->GetSubsystem<UEnemyAIManagerSubsystem>() : nullptr;
+		if (!Subsystem || !AIManager)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unable to find the PathfindingSubsystem and EnemyAIManagerSubsystem to benchmark."))
+			return;
+		}
+		const TArray<FVector> Positions = Subsystem->GetWaypointPositions();
+		if (Positions.IsEmpty())
+		{
+			UE_LOG(LogTemp, Error, TEXT("The enemy AI benchmark needs a level with navigation nodes to spawn enemies on."))
+			return;
+		}
+
+		// Spawn the enemies with batching off so they set themselves up to tick by themselves first.
+		IConsoleVariable* BatchedVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("AGP.EnemyAI.Batched"));
+		const int32 SavedBatched = BatchedVariable ? BatchedVariable->GetInt() : 0;
+		if (BatchedVariable)
+		{
+			BatchedVariable->Set(0, ECVF_SetByConsole);
+		}
+
+		constexpr float DeltaTime = 1.0f / 60.0f;
+		FRandomStream Random(1234);
+		UE_LOG(LogTemp, Display, TEXT("Enemy AI benchmark, %d navigation nodes, %d frames:"), Positions.Num(), NumFrames)
+		for (const int32 NumEnemies : EnemyCounts)
+		{
+			FActorSpawnParameters SpawnParameters;
+			SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			TArray<AEnemyCharacter*> Enemies;
+			for (int32 i = 0; i < NumEnemies; i++)
+			{
+				const FVector Location = Positions[Random.RandRange(0, Positions.Num() - 1)] + FVector(0.0f, 0.0f, 100.0f);
+				if (AEnemyCharacter* Enemy = World->SpawnActor<AEnemyCharacter>(AEnemyCharacter::StaticClass(), Location,
+					FRotator::ZeroRotator, SpawnParameters))
+				{
+					Enemies.Add(Enemy);
+				}
+			}
+
+			double PerActorSeconds = 0.0;
+			for (int32 Frame = 0; Frame < NumFrames; Frame++)
+			{
+				const double StartTime = FPlatformTime::Seconds();
+				for (AEnemyCharacter* Enemy : Enemies)
+				{
+					Enemy->Tick(DeltaTime);
+				}
+				PerActorSeconds += FPlatformTime::Seconds() - StartTime;
+				for (AEnemyCharacter* Enemy : Enemies)
+				{
+					Enemy->ConsumeMovementInputVector();
+				}
+			}
+
+			// Hand the same enemies over to the manager, which also updates any enemies the level already had.
+			for (AEnemyCharacter* Enemy : Enemies)
+			{
+				AIManager->RegisterEnemy(Enemy);
+			}
+			double BatchedSeconds = 0.0;
+			for (int32 Frame = 0; Frame < NumFrames; Frame++)
+			{
+				const double StartTime = FPlatformTime::Seconds();
+				AIManager->TickEnemies(DeltaTime);
+				BatchedSeconds += FPlatformTime::Seconds() - StartTime;
+				for (AEnemyCharacter* Enemy : Enemies)
+				{
+					Enemy->ConsumeMovementInputVector();
+				}
+			}
+			const int32 NumBatched = AIManager->GetNumEnemies();
+
+			for (AEnemyCharacter* Enemy : Enemies)
+			{
+				Enemy->Destroy();
+			}
+
+			const double PerActorMs = PerActorSeconds * 1000.0 / FMath::Max(1, NumFrames * Enemies.Num());
+			const double BatchedMs = BatchedSeconds * 1000.0 / FMath::Max(1, NumFrames * NumBatched);
+			UE_LOG(LogTemp, Display, TEXT("  %4d enemies: per actor tick %.4f ms per enemy (%.2f ms per frame), batched %.4f ms per enemy (%.2f ms per frame, %.1fx)"),
+				Enemies.Num(), PerActorMs, PerActorSeconds * 1000.0 / NumFrames, BatchedMs, BatchedSeconds * 1000.0 / NumFrames,
+				BatchedMs > 0.0 ? PerActorMs / BatchedMs : 0.0)
+		}
+
+		if (BatchedVariable)
+		{
+			BatchedVariable->Set(SavedBatched, ECVF_SetByConsole);
+		}
+	}
+
+private:
+
+	// How many room types the benchmark dungeons are laid out with. Rooms are never placed next to one of the same type,
+	// so fewer types give sparser dungeons.
+	static constexpr int32 NumDungeonRoomTypes = 4;
+
+	/**
+	 * A graph held as nothing but positions and adjacency lists, to show TNavigationSearch running over a graph that
+	 * was never built into a snapshot. Edges are NodeIndex * MaxNeighbours + the position in the node's list.
+	 */
+	struct FAdjacencyListAdapter
+	{
+		static constexpr int32 MaxNeighbours = 64;
+
+		const TArray<FVector>& Positions;
+		const TArray<TArray<int32>>& Adjacency;
+
+		int32 Num() const { return Positions.Num(); }
+		const FVector& GetPosition(int32 Index) const { return Positions[Index]; }
+		float GetEdgeCost(int32 Edge) const
+		{
+			return FVector::Distance(Positions[Edge / MaxNeighbours], Positions[Adjacency[Edge / MaxNeighbours][Edge % MaxNeighbours]]);
+		}
+
+		template <typename FuncType>
+		void ForEachEdge(int32 Index, FuncType&& Func) const
+		{
+			for (int32 i = 0; i < Adjacency[Index].Num() && i < MaxNeighbours; i++)
+			{
+				Func(Index * MaxNeighbours + i, Adjacency[Index][i]);
+			}
+		}
+	};
+
+	/**
+	 * Runs every query through one instantiation of TNavigationSearch and logs its time, the nodes it expanded and how
+	 * many of its paths were longer than the shortest.
+	 * @param ShortestLengths The shortest path length of each query, or nullptr to skip the check.
+	 * @param OutLengths Set to the length of each path found, -1 where no path was found.
+	 */
+	template <typename SearchType>
+	static void TimeSearchPolicy(const TCHAR* Label, SearchType& Search, const TArray<TPair<int32, int32>>& Queries,
+		const TArray<float>* ShortestLengths, TArray<float>& OutLengths)
+	{
+		TArray<uint8> Found;
+		int32 NumExpanded = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		for (const TPair<int32, int32>& Query : Queries)
+		{
+			Found.Add(Search.Run(Query.Key, Query.Value, NumExpanded));
+		}
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		// Search again to measure the paths, outside of the timing.
+		OutLengths.Reset();
+		int32 NumLonger = 0;
+		TArray<FVector> Path;
+		for (int32 i = 0; i < Queries.Num(); i++)
+		{
+			int32 Unused = 0;
+			OutLengths.Add(Found[i] && Search.Run(Queries[i].Key, Queries[i].Value, Unused) ? 0.0f : -1.0f);
+			if (OutLengths[i] >= 0.0f)
+			{
+				Search.ReconstructPath(Queries[i].Value, Path);
+				OutLengths[i] = GetPathLength(Path);
+			}
+			if (ShortestLengths && OutLengths[i] > (*ShortestLengths)[i] + 1.0f)
+			{
+				NumLonger++;
+			}
+		}
+		UE_LOG(LogTemp, Display, TEXT("  %-38s %7.2f us/query, %7.1f nodes expanded/query, %d paths longer than the shortest"),
+			Label, Seconds * 1e6 / FMath::Max(1, Queries.Num()), static_cast<double>(NumExpanded) / FMath::Max(1, Queries.Num()), NumLonger)
+	}
+
+	/**
+	 * Lays out a dungeon with ADungeonGenerator::MakeLayout and builds a graph with a node on every walkable cell of its
+	 * grid, so searches over the grid and over the graph can be compared.
+	 * @param OutCellNodes Set to the graph node of each cell, INDEX_NONE for cells that can't be walked on.
+	 * @param OutPositions Set to the position of each graph node.
+	 * @param OutAdjacency Set to the connections of each graph node.
+	 * @return The room cells.
+	 */
+	static TArray<FIntPoint> MakeDungeonGrid(int32 GridSize, float RoomSize, FRandomStream& Random, FDungeonNavigationGrid& OutDungeonGrid,
+		TArray<int32>& OutCellNodes, TArray<FVector>& OutPositions, TArray<TArray<int32>>& OutAdjacency)
+	{
+		FDungeonLayout Layout;
+		MakeDungeonLayout(GridSize, RoomSize, Random, Layout);
+		OutDungeonGrid = MoveTemp(Layout.NavigationGrid);
+		OutCellNodes.Init(INDEX_NONE, OutDungeonGrid.GetNumCells());
+		OutPositions.Reset();
+		OutAdjacency.Reset();
+
+		TArray<FIntPoint> Rooms;
+		for (int32 CellIndex = 0; CellIndex < OutDungeonGrid.GetNumCells(); CellIndex++)
+		{
+			const FIntPoint Cell = OutDungeonGrid.GetCell(CellIndex);
+			if (!OutDungeonGrid.IsWalkable(Cell)) continue;
+			OutCellNodes[CellIndex] = OutPositions.Add(OutDungeonGrid.CellToWorld(Cell));
+			if (OutDungeonGrid.IsRoom(Cell))
+			{
+				Rooms.Add(Cell);
+			}
+		}
+
+		// Every open side of a cell is an edge of the graph.
+		const FDungeonGridAdapter Adapter(OutDungeonGrid);
+		OutAdjacency.SetNum(OutPositions.Num());
+		for (int32 CellIndex = 0; CellIndex < OutCellNodes.Num(); CellIndex++)
+		{
+			if (OutCellNodes[CellIndex] == INDEX_NONE) continue;
+			Adapter.ForEachEdge(CellIndex, [&OutCellNodes, &OutAdjacency, CellIndex](int32, int32 NeighbourCellIndex)
+			{
+				OutAdjacency[OutCellNodes[CellIndex]].Add(OutCellNodes[NeighbourCellIndex]);
+			});
+		}
+		return Rooms;
+	}
+
+	// The subsystem's own nodes, while a benchmark has swapped its graph in.
+	struct FSavedNodes
+	{
+		TArray<ANavigationNode*> Nodes;
+		TArray<FNavigationNodeData> NodeData;
+		bool bGeneratedNodes = false;
+		float DungeonRoomSize = 0.0f;
+	};
+
+	/**
+	 * Replaces the subsystem's nodes with a generated dungeon as node data and builds its snapshot.
+	 * @param OutSavedNodes Set to the subsystem's own nodes, for RestoreNodes to put back.
+	 * @return The positions of the dungeon's nodes.
+	 */
+	static TArray<FVector> SwapInDungeon(UPathfindingSubsystem* Subsystem, int32 GridSize, FRandomStream& Random, FSavedNodes& OutSavedNodes)
+	{
+		constexpr float RoomSize = 500.0f;
+		TArray<FVector> Positions;
+		TArray<ENavigationNodeKind> Kinds;
+		TArray<TArray<int32>> Adjacency;
+		MakeDungeonLayout(GridSize, RoomSize, Random, Positions, Kinds);
+		UPathfindingSubsystem::ConnectDungeonNodes(Positions, Kinds, RoomSize, Adjacency);
+
+		OutSavedNodes.Nodes = MoveTemp(Subsystem->Nodes);
+		OutSavedNodes.NodeData = MoveTemp(Subsystem->NodeData);
+		OutSavedNodes.bGeneratedNodes = Subsystem->bGeneratedNodes;
+		OutSavedNodes.DungeonRoomSize = Subsystem->DungeonRoomSize;
+		Subsystem->Nodes.Reset();
+		Subsystem->NodeData.SetNum(Positions.Num());
+		for (int32 i = 0; i < Positions.Num(); i++)
+		{
+			Subsystem->NodeData[i].Location = Positions[i];
+			Subsystem->NodeData[i].Kind = Kinds[i];
+			Subsystem->NodeData[i].ConnectedNodes = MoveTemp(Adjacency[i]);
+		}
+		Subsystem->bGeneratedNodes = true;
+		Subsystem->DungeonRoomSize = RoomSize;
+		Subsystem->MarkGraphDirty();
+		Subsystem->GetGraphSnapshot();
+		return Positions;
+	}
+
+	static void RestoreNodes(UPathfindingSubsystem* Subsystem, FSavedNodes&& SavedNodes)
+	{
+		Subsystem->Nodes = MoveTemp(SavedNodes.Nodes);
+		Subsystem->NodeData = MoveTemp(SavedNodes.NodeData);
+		Subsystem->bGeneratedNodes = SavedNodes.bGeneratedNodes;
+		Subsystem->DungeonRoomSize = SavedNodes.DungeonRoomSize;
+		Subsystem->RebuildNodeIndices();
+		Subsystem->MarkGraphDirty();
+	}
+
+	/**
+	 * Spawns a 4-connected grid of navigation nodes with a fraction of the cells left out to act as walls.
+	 */
+	static TArray<ANavigationNode*> SpawnGridGraph(UWorld* World, int32 GridSize, float BlockedFraction, FRandomStream& Random)
+	{
+		constexpr float Spacing = 100.0f;
+		// Place the graph well away from the level so it can't be confused with the real nodes.
+		const FVector Origin(0.0f, 0.0f, -100000.0f);
+
+		TArray<ANavigationNode*> Grid;
+		Grid.SetNumZeroed(GridSize * GridSize);
+		for (int32 Y = 0; Y < GridSize; Y++)
+		{
+			for (int32 X = 0; X < GridSize; X++)
+			{
+				if (Random.FRand() < BlockedFraction) continue;
+				if (ANavigationNode* Node = World->SpawnActor<ANavigationNode>(Origin + FVector(X * Spacing, Y * Spacing, 0.0f), FRotator::ZeroRotator))
+				{
+					Grid[Y * GridSize + X] = Node;
+				}
+			}
+		}
+
+		TArray<ANavigationNode*> GraphNodes;
+		for (int32 Y = 0; Y < GridSize; Y++)
+		{
+			for (int32 X = 0; X < GridSize; X++)
+			{
+				ANavigationNode* Node = Grid[Y * GridSize + X];
+				if (!Node) continue;
+				if (X > 0 && Grid[Y * GridSize + X - 1]) Node->ConnectedNodes.Add(Grid[Y * GridSize + X - 1]);
+				if (X < GridSize - 1 && Grid[Y * GridSize + X + 1]) Node->ConnectedNodes.Add(Grid[Y * GridSize + X + 1]);
+				if (Y > 0 && Grid[(Y - 1) * GridSize + X]) Node->ConnectedNodes.Add(Grid[(Y - 1) * GridSize + X]);
+				if (Y < GridSize - 1 && Grid[(Y + 1) * GridSize + X]) Node->ConnectedNodes.Add(Grid[(Y + 1) * GridSize + X]);
+				GraphNodes.Add(Node);
+			}
+		}
+		return GraphNodes;
+	}
+
+	/**
+	 * Builds the positions and adjacency of a 4-connected grid with a fraction of the cells left out to act as walls,
+	 * without spawning any actors.
+	 */
+	static void MakeGridGraph(int32 GridSize, float Spacing, float BlockedFraction, FRandomStream& Random,
+		TArray<FVector>& OutPositions, TArray<TArray<int32>>& OutAdjacency)
+	{
+		TArray<int32> CellNodes;
+		CellNodes.Init(INDEX_NONE, GridSize * GridSize);
+		for (int32 Y = 0; Y < GridSize; Y++)
+		{
+			for (int32 X = 0; X < GridSize; X++)
+			{
+				if (Random.FRand() < BlockedFraction) continue;
+				CellNodes[Y * GridSize + X] = OutPositions.Add(FVector(X * Spacing, Y * Spacing, 0.0f));
+			}
+		}
+
+		OutAdjacency.SetNum(OutPositions.Num());
+		for (int32 Y = 0; Y < GridSize; Y++)
+		{
+			for (int32 X = 0; X < GridSize; X++)
+			{
+				const int32 Node = CellNodes[Y * GridSize + X];
+				if (Node == INDEX_NONE) continue;
+				if (X > 0 && CellNodes[Y * GridSize + X - 1] != INDEX_NONE) OutAdjacency[Node].Add(CellNodes[Y * GridSize + X - 1]);
+				if (X < GridSize - 1 && CellNodes[Y * GridSize + X + 1] != INDEX_NONE) OutAdjacency[Node].Add(CellNodes[Y * GridSize + X + 1]);
+				if (Y > 0 && CellNodes[(Y - 1) * GridSize + X] != INDEX_NONE) OutAdjacency[Node].Add(CellNodes[(Y - 1) * GridSize + X]);
+				if (Y < GridSize - 1 && CellNodes[(Y + 1) * GridSize + X] != INDEX_NONE) OutAdjacency[Node].Add(CellNodes[(Y + 1) * GridSize + X]);
+			}
+		}
+	}
+
+	/**
+	 * Scatters nodes uniformly over a square, about one per Spacing squared, and connects every pair within one and a
+	 * half Spacing of each other, which gives each node around seven neighbours.
+	 */
+	static void MakeGeometricGraph(int32 NumNodes, float Spacing, FRandomStream& Random, TArray<FVector>& OutPositions,
+		TArray<TArray<int32>>& OutAdjacency)
+	{
+		const float Width = FMath::Sqrt(static_cast<float>(NumNodes)) * Spacing;
+		OutPositions.Reserve(NumNodes);
+		for (int32 i = 0; i < NumNodes; i++)
+		{
+			OutPositions.Add(FVector(Random.FRand() * Width, Random.FRand() * Width, 0.0f));
+		}
+
+		const float Radius = Spacing * 1.5f;
+		FNavigationSpatialHash SpatialHash;
+		SpatialHash.Build(OutPositions, Radius);
+		OutAdjacency.SetNum(NumNodes);
+		for (int32 i = 0; i < NumNodes; i++)
+		{
+			SpatialHash.ForEachInRadius(OutPositions, OutPositions[i], Radius, [&OutAdjacency, i](int32 Index)
+			{
+				if (Index != i)
+				{
+					OutAdjacency[i].Add(Index);
+				}
+			});
+		}
+	}
+
+	/**
+	 * Lays out a dungeon with ADungeonGenerator::MakeLayout, so the benchmarks search the same dungeons the game does.
+	 * The layout is seeded from Random, so each stream gives the same dungeon every run.
+	 */
+	static void MakeDungeonLayout(int32 GridSize, float RoomSize, FRandomStream& Random, FDungeonLayout& OutLayout)
+	{
+		// The layout only checks that each room type is set, so any class will do.
+		TArray<TSubclassOf<AActor>> RoomTypes;
+		RoomTypes.Init(AActor::StaticClass(), NumDungeonRoomTypes);
+		ADungeonGenerator::MakeLayout(GridSize, GridSize, RoomSize, RoomTypes, Random.RandHelper(MAX_int32), OutLayout);
+	}
+
+	static void MakeDungeonLayout(int32 GridSize, float RoomSize, FRandomStream& Random, TArray<FVector>& OutPositions,
+		TArray<ENavigationNodeKind>& OutKinds)
+	{
+		FDungeonLayout Layout;
+		MakeDungeonLayout(GridSize, RoomSize, Random, Layout);
+		OutPositions = MoveTemp(Layout.NodeLocations);
+		OutKinds = MoveTemp(Layout.NodeKinds);
+	}
+
+	/**
+	 * @return The settings UPathfindingSubsystem::RebuildGraph would build a graph with, given its current console
+	 * variables.
+	 */
+	static FNavigationGraphBuildSettings GetSubsystemBuildSettings(int32 NumNodes, float RoomSize)
+	{
+		auto GetInt = [](const TCHAR* Name)
+		{
+			const IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(Name);
+			return Variable ? Variable->GetInt() : 0;
+		};
+
+		FNavigationGraphBuildSettings Settings;
+		Settings.RoutingTableMaxNodes = GetInt(TEXT("AGP.Pathfinding.RoutingTableMaxNodes"));
+		Settings.NumLandmarks = GetInt(TEXT("AGP.Pathfinding.Landmarks"));
+		if (NumNodes >= GetInt(TEXT("AGP.Pathfinding.HierarchyMinNodes")))
+		{
+			Settings.HierarchyClusterSize = RoomSize * GetInt(TEXT("AGP.Pathfinding.HierarchyClusterRooms"));
+		}
+		return Settings;
+	}
+
+	/**
+	 * The reference the suite checks paths against: Dijkstra with no heuristic and none of the graph's acceleration
+	 * structures, stopping once the end node is settled.
+	 * @return The length of the shortest path, or UE_MAX_FLT if there is none.
+	 */
+	static float GetShortestDistance(const FNavigationGraph& Graph, int32 StartIndex, int32 EndIndex, TArray<float>& Distances,
+		FIndexedMinHeap& OpenSet)
+	{
+		Distances.Init(UE_MAX_FLT, Graph.Num());
+		OpenSet.Reset(Graph.Num());
+		Distances[StartIndex] = 0.0f;
+		OpenSet.PushOrDecrease(StartIndex, 0.0f);
+		while (!OpenSet.IsEmpty())
+		{
+			const int32 CurrentIndex = OpenSet.Pop();
+			if (CurrentIndex == EndIndex) break;
+
+			for (int32 Edge = Graph.GetNeighbourBegin(CurrentIndex); Edge < Graph.GetNeighbourEnd(CurrentIndex); Edge++)
+			{
+				if (Graph.IsEdgeBlocked(Edge)) continue;
+				const int32 ConnectedIndex = Graph.Neighbours[Edge];
+				const float TentativeDistance = Distances[CurrentIndex] + Graph.EdgeCosts[Edge];
+				if (TentativeDistance < Distances[ConnectedIndex])
+				{
+					Distances[ConnectedIndex] = TentativeDistance;
+					OpenSet.PushOrDecrease(ConnectedIndex, TentativeDistance);
+				}
+			}
+		}
+		return Distances[EndIndex];
+	}
+
+	/**
+	 * @return The value below which the given fraction of the sorted values fall.
+	 */
+	static double GetPercentile(const TArray<double>& SortedValues, double Fraction)
+	{
+		return SortedValues[FMath::Clamp(FMath::CeilToInt32(Fraction * SortedValues.Num()) - 1, 0, SortedValues.Num() - 1)];
+	}
+
+	/**
+	 * Counts heap allocations by sitting in front of GMalloc and passing every call on to it, for as long as it exists.
+	 * Unless it is given a thread to watch, allocations made by every thread are counted, so nothing else should be
+	 * running meanwhile.
+	 */
+	class FAllocationCounter : public FMalloc
+	{
+	public:
+
+		explicit FAllocationCounter(uint32 InThreadId = 0) : Inner(GMalloc), ThreadId(InThreadId) { GMalloc = this; }
+		virtual ~FAllocationCounter() override { GMalloc = Inner; }
+
+		void Pause() { bCounting = false; }
+		void Resume() { bCounting = true; }
+		uint64 GetNumAllocations() const { return NumAllocations.load(); }
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override { CountAllocation(); return Inner->Malloc(Count, Alignment); }
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override { CountAllocation(); return Inner->TryMalloc(Count, Alignment); }
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override { CountAllocation(); return Inner->Realloc(Original, Count, Alignment); }
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override { CountAllocation(); return Inner->TryRealloc(Original, Count, Alignment); }
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+	private:
+
+		void CountAllocation()
+		{
+			if (bCounting && (ThreadId == 0 || FPlatformTLS::GetCurrentThreadId() == ThreadId))
+			{
+				NumAllocations++;
+			}
+		}
+
+		FMalloc* Inner;
+		uint32 ThreadId;
+		std::atomic<uint64> NumAllocations = 0;
+		std::atomic<bool> bCounting = true;
+	};
+
+	/**
+	 * The nested loops UPathfindingSubsystem::UpdatePathfindingNodes used to connect dungeon nodes with before the
+	 * spatial hash, minus the duplicate connections they could add.
+	 */
+	static void ConnectDungeonNodesAllPairs(const TArray<FVector>& Positions, const TArray<ENavigationNodeKind>& Kinds, float RoomSize,
+		TArray<TArray<int32>>& OutAdjacency)
+	{
+		OutAdjacency.SetNum(Positions.Num());
+		for (int32 i = 0; i < Positions.Num(); i++)
+		{
+			for (int32 j = 0; j < Positions.Num(); j++)
+			{
+				if (i == j) continue;
+				const float Distance = FVector::Dist(Positions[i], Positions[j]);
+				if (Distance > RoomSize) continue;
+				if (Kinds[i] == ENavigationNodeKind::Corridor && Kinds[j] == ENavigationNodeKind::Corridor && Distance <= RoomSize * 0.5f) continue;
+				OutAdjacency[i].Add(j);
+			}
+		}
+	}
+
+	static void DestroyGraph(UWorld* World, const TArray<ANavigationNode*>& GraphNodes)
+	{
+		for (ANavigationNode* Node : GraphNodes)
+		{
+			World->DestroyActor(Node);
+		}
+	}
+
+	static float GetPathLength(const TArray<FVector>& Path)
+	{
+		float Length = 0.0f;
+		for (int32 i = 1; i < Path.Num(); i++)
+		{
+			Length += FVector::Distance(Path[i - 1], Path[i]);
+		}
+		return Length;
+	}
+
+	static bool PathLengthsMatch(const TArray<FVector>& PathA, const TArray<FVector>& PathB)
+	{
+		return PathA.IsEmpty() == PathB.IsEmpty() && FMath::IsNearlyEqual(GetPathLength(PathA), GetPathLength(PathB), 1.0f);
+	}
+
+	struct FActorWalkScratch
+	{
+		TArray<float> GScores;
+		TArray<int32> CameFrom;
+		FIndexedMinHeap OpenSet;
+	};
+
+	/**
+	 * The heap based A* following ANavigationNode::ConnectedNodes and reading actor locations, as it was before the
+	 * CSR graph snapshot was introduced.
+	 */
+	static TArray<FVector> GetPathActorWalk(FActorWalkScratch& Scratch, const TArray<ANavigationNode*>& GraphNodes,
+		const ANavigationNode* StartNode, const ANavigationNode* EndNode)
+	{
+		const int32 NumNodes = GraphNodes.Num();
+		Scratch.GScores.Init(UE_MAX_FLT, NumNodes);
+		Scratch.CameFrom.Init(INDEX_NONE, NumNodes);
+		Scratch.OpenSet.Reset(NumNodes);
+
+		const FVector EndLocation = EndNode->GetActorLocation();
+		Scratch.GScores[StartNode->NodeIndex] = 0.0f;
+		Scratch.OpenSet.PushOrDecrease(StartNode->NodeIndex, FVector::Distance(StartNode->GetActorLocation(), EndLocation));
+
+		while (!Scratch.OpenSet.IsEmpty())
+		{
+			const int32 CurrentIndex = Scratch.OpenSet.Pop();
+			const ANavigationNode* CurrentNode = GraphNodes[CurrentIndex];
+			if (CurrentNode == EndNode)
+			{
+				TArray<FVector> NodeLocations;
+				for (int32 NextIndex = CurrentIndex; NextIndex != INDEX_NONE; NextIndex = Scratch.CameFrom[NextIndex])
+				{
+					NodeLocations.Push(GraphNodes[NextIndex]->GetActorLocation());
+				}
+				return NodeLocations;
+			}
+
+			for (const ANavigationNode* ConnectedNode : CurrentNode->ConnectedNodes)
+			{
+				if (!ConnectedNode) continue;
+				const int32 ConnectedIndex = ConnectedNode->NodeIndex;
+				const float TentativeGScore = Scratch.GScores[CurrentIndex] + FVector::Distance(CurrentNode->GetActorLocation(), ConnectedNode->GetActorLocation());
+				if (TentativeGScore < Scratch.GScores[ConnectedIndex])
+				{
+					Scratch.CameFrom[ConnectedIndex] = CurrentIndex;
+					Scratch.GScores[ConnectedIndex] = TentativeGScore;
+					Scratch.OpenSet.PushOrDecrease(ConnectedIndex, TentativeGScore + FVector::Distance(ConnectedNode->GetActorLocation(), EndLocation));
+				}
+			}
+		}
+
+		return TArray<FVector>();
+	}
+
+	/**
+	 * The original A* implementation with a linear scan open set and hash map scores, kept as the baseline to measure
+	 * against.
+	 */
+	static TArray<FVector> GetPathLinearScan(ANavigationNode* StartNode, ANavigationNode* EndNode)
+	{
+		TArray<ANavigationNode*> OpenSet;
+		OpenSet.Add(StartNode);
+
+		TMap<ANavigationNode*, float> GScores, HScores;
+		TMap<ANavigationNode*, ANavigationNode*> CameFrom;
+		GScores.Add(StartNode, 0);
+		HScores.Add(StartNode, FVector::Distance(StartNode->GetActorLocation(), EndNode->GetActorLocation()));
+		CameFrom.Add(StartNode, nullptr);
+
+		while (!OpenSet.IsEmpty())
+		{
+			ANavigationNode* CurrentNode = OpenSet[0];
+			for (int32 i = 1; i < OpenSet.Num(); i++)
+			{
+				if (GScores[OpenSet[i]] + HScores[OpenSet[i]] < GScores[CurrentNode] + HScores[CurrentNode])
+				{
+					CurrentNode = OpenSet[i];
+				}
+			}
+			OpenSet.Remove(CurrentNode);
+
+			if (CurrentNode == EndNode)
+			{
+				TArray<FVector> NodeLocations;
+				const ANavigationNode* NextNode = EndNode;
+				while (NextNode)
+				{
+					NodeLocations.Push(NextNode->GetActorLocation());
+					NextNode = CameFrom[NextNode];
+				}
+				return NodeLocations;
+			}
+
+			for (ANavigationNode* ConnectedNode : CurrentNode->ConnectedNodes)
+			{
+				if (!ConnectedNode) continue;
+				const float TentativeGScore = GScores[CurrentNode] + FVector::Distance(CurrentNode->GetActorLocation(), ConnectedNode->GetActorLocation());
+				if (!GScores.Contains(ConnectedNode))
+				{
+					GScores.Add(ConnectedNode, UE_MAX_FLT);
+					HScores.Add(ConnectedNode, FVector::Distance(ConnectedNode->GetActorLocation(), EndNode->GetActorLocation()));
+					CameFrom.Add(ConnectedNode, nullptr);
+				}
+				if (TentativeGScore < GScores[ConnectedNode])
+				{
+					CameFrom[ConnectedNode] = CurrentNode;
+					GScores[ConnectedNode] = TentativeGScore;
+					if (!OpenSet.Contains(ConnectedNode))
+					{
+						OpenSet.Add(ConnectedNode);
+					}
+				}
+			}
+		}
+
+		return TArray<FVector>();
+	}
+};
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkAStarCommand(
+	TEXT("AGP.Pathfinding.BenchmarkAStar"),
+	TEXT("Compares A* on the graph snapshot with the actor walking and linear scan versions on a synthetic grid. Usage: AGP.Pathfinding.BenchmarkAStar [GridSize=50] [NumQueries=100]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 GridSize = Args.Num() > 0 ? FMath::Max(2, FCString::Atoi(*Args[0])) : 50;
+		const int32 NumQueries = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 100;
+		FPathfindingBenchmark::RunAStar(World, GridSize, NumQueries);
+	}));
+
+static FAutoConsoleCommand BenchmarkSpatialIndexCommand(
+	TEXT("AGP.Pathfinding.BenchmarkSpatialIndex"),
+	TEXT("Compares the k-d tree nearest/furthest node lookups with linear scans. Usage: AGP.Pathfinding.BenchmarkSpatialIndex [NumNodes=10000] [NumQueries=1000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumNodes = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10000;
+		const int32 NumQueries = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 1000;
+		FPathfindingBenchmark::RunSpatialIndex(NumNodes, NumQueries);
+	}));
+
+static FAutoConsoleCommand BenchmarkHierarchyCommand(
+	TEXT("AGP.Pathfinding.BenchmarkHierarchy"),
+	TEXT("Compares hierarchical pathfinding with flat A* on grids from 32x32 up to MaxGridSize. Usage: AGP.Pathfinding.BenchmarkHierarchy [MaxGridSize=256] [NumQueries=200]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 MaxGridSize = Args.Num() > 0 ? FMath::Max(32, FCString::Atoi(*Args[0])) : 256;
+		const int32 NumQueries = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 200;
+		FPathfindingBenchmark::RunHierarchy(MaxGridSize, NumQueries);
+	}));
+
+static FAutoConsoleCommand BenchmarkDungeonGridCommand(
+	TEXT("AGP.Pathfinding.BenchmarkDungeonGrid"),
+	TEXT("Compares routes on a dungeon occupancy grid with A* on the equivalent node graph. Usage: AGP.Pathfinding.BenchmarkDungeonGrid [GridSize=100] [NumQueries=1000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 GridSize = Args.Num() > 0 ? FMath::Max(3, FCString::Atoi(*Args[0])) : 100;
+		const int32 NumQueries = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 1000;
+		FPathfindingBenchmark::RunDungeonGrid(GridSize, NumQueries);
+	}));
+
+static FAutoConsoleCommand BenchmarkIncrementalCommand(
+	TEXT("AGP.Pathfinding.BenchmarkIncremental"),
+	TEXT("Compares D* Lite path repair with A* from scratch as nodes on the path are blocked. Usage: AGP.Pathfinding.BenchmarkIncremental [GridSize=100] [NumQueries=100] [BlocksPerQuery=5]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 GridSize = Args.Num() > 0 ? FMath::Max(3, FCString::Atoi(*Args[0])) : 100;
+		const int32 NumQueries = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 100;
+		const int32 BlocksPerQuery = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : 5;
+		FPathfindingBenchmark::RunIncremental(GridSize, NumQueries, BlocksPerQuery);
+	}));
+
+static FAutoConsoleCommand BenchmarkFlowFieldCommand(
+	TEXT("AGP.Pathfinding.BenchmarkFlowField"),
+	TEXT("Compares a crowd chasing a moving target with one A* per agent against a shared flow field. Usage: AGP.Pathfinding.BenchmarkFlowField [NumAgents=500] [GridSize=100] [NumSteps=50]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumAgents = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 500;
+		const int32 GridSize = Args.Num() > 1 ? FMath::Max(3, FCString::Atoi(*Args[1])) : 100;
+		const int32 NumSteps = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : 50;
+		FPathfindingBenchmark::RunFlowField(NumAgents, GridSize, NumSteps);
+	}));
+
+static FAutoConsoleCommand BenchmarkGraphConstructionCommand(
+	TEXT("AGP.Pathfinding.BenchmarkGraphConstruction"),
+	TEXT("Times connecting dungeon nodes with the spatial hash against all pairs, on dungeons from 25x25 rooms up to MaxGridSize. Usage: AGP.Pathfinding.BenchmarkGraphConstruction [MaxGridSize=200]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 MaxGridSize = Args.Num() > 0 ? FMath::Max(25, FCString::Atoi(*Args[0])) : 200;
+		FPathfindingBenchmark::RunGraphConstruction(MaxGridSize);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkNodePlacementCommand(
+	TEXT("AGP.Pathfinding.BenchmarkNodePlacement"),
+	TEXT("Compares spawning navigation node actors with placing node data. Usage: AGP.Pathfinding.BenchmarkNodePlacement [NumNodes=10000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumNodes = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10000;
+		FPathfindingBenchmark::RunNodePlacement(World, NumNodes);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkStartupCommand(
+	TEXT("AGP.Pathfinding.BenchmarkStartup"),
+	TEXT("Compares gathering the node actors, connecting generated nodes and regenerating the dungeon with loading the level's baked graph. Usage: AGP.Pathfinding.BenchmarkStartup [NumIterations=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumIterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10;
+		FPathfindingBenchmark::RunStartup(World, NumIterations);
+	}));
+
+static FAutoConsoleCommand BenchmarkSuiteCommand(
+	TEXT("AGP.Pathfinding.BenchmarkSuite"),
+	TEXT("Checks and times path queries on synthetic grids, random geometric graphs and dungeon layouts from 100 nodes up to MaxNodes and writes the results to a CSV file in the profiling folder. Usage: AGP.Pathfinding.BenchmarkSuite [MaxNodes=1000000] [NumQueries=200] [Label]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 MaxNodes = Args.Num() > 0 ? FMath::Max(100, FCString::Atoi(*Args[0])) : 1000000;
+		const int32 NumQueries = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 200;
+		const FString Label = Args.Num() > 2 ? Args[2] : FString();
+		FPathfindingBenchmark::RunSuite(MaxNodes, NumQueries, Label);
+	}));
+
+static FAutoConsoleCommand BenchmarkLandmarksCommand(
+	TEXT("AGP.Pathfinding.BenchmarkLandmarks"),
+	TEXT("Compares the nodes A* expands on a generated dungeon with the straight line heuristic and with 1 up to MaxLandmarks landmarks. Usage: AGP.Pathfinding.BenchmarkLandmarks [GridSize=150] [NumQueries=500] [MaxLandmarks=16]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 GridSize = Args.Num() > 0 ? FMath::Max(3, FCString::Atoi(*Args[0])) : 150;
+		const int32 NumQueries = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 500;
+		const int32 MaxLandmarks = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : 16;
+		FPathfindingBenchmark::RunLandmarks(GridSize, NumQueries, MaxLandmarks);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkGroundProbesCommand(
+	TEXT("AGP.Pathfinding.BenchmarkGroundProbes"),
+	TEXT("Compares tracing for solid ground one location at a time with the batched serial and parallel probes used to place procedural nodes. Usage: AGP.Pathfinding.BenchmarkGroundProbes [GridSize=256]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 GridSize = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 256;
+		FPathfindingBenchmark::RunGroundProbes(World, GridSize);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkPathAllocationsCommand(
+	TEXT("AGP.Pathfinding.BenchmarkPathAllocations"),
+	TEXT("Counts the heap allocations per path query once repathing has warmed up, and logs an error if queries into a reused path allocate. Usage: AGP.Pathfinding.BenchmarkPathAllocations [GridSize=60] [NumQueries=500]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 GridSize = Args.Num() > 0 ? FMath::Max(3, FCString::Atoi(*Args[0])) : 60;
+		const int32 NumQueries = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 500;
+		FPathfindingBenchmark::RunPathAllocations(World, GridSize, NumQueries);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkPathAwayCommand(
+	TEXT("AGP.Pathfinding.BenchmarkPathAway"),
+	TEXT("Compares fleeing a threat to the node furthest in a straight line with fleeing along a shared escape field, for time and for distance from the threat. Usage: AGP.Pathfinding.BenchmarkPathAway [GridSize=60] [NumAgents=200]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 GridSize = Args.Num() > 0 ? FMath::Max(3, FCString::Atoi(*Args[0])) : 60;
+		const int32 NumAgents = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 200;
+		FPathfindingBenchmark::RunPathAway(World, GridSize, NumAgents);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkPatrolCommand(
+	TEXT("AGP.Pathfinding.BenchmarkPatrol"),
+	TEXT("Compares patrolling along random paths with patrolling along the precomputed circuits, for time and for how evenly the dungeon is covered. Usage: AGP.Pathfinding.BenchmarkPatrol [GridSize=60] [NumAgents=100] [NumSteps=500]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 GridSize = Args.Num() > 0 ? FMath::Max(3, FCString::Atoi(*Args[0])) : 60;
+		const int32 NumAgents = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 100;
+		const int32 NumSteps = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : 500;
+		FPathfindingBenchmark::RunPatrol(World, GridSize, NumAgents, NumSteps);
+	}));
+
+static FAutoConsoleCommand BenchmarkSearchPoliciesCommand(
+	TEXT("AGP.Pathfinding.BenchmarkSearchPolicies"),
+	TEXT("Times every instantiation of the templated A* core over the node graph, the dungeon grid and plain adjacency lists. Usage: AGP.Pathfinding.BenchmarkSearchPolicies [GridSize=60] [NumQueries=1000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 GridSize = Args.Num() > 0 ? FMath::Max(3, FCString::Atoi(*Args[0])) : 60;
+		const int32 NumQueries = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 1000;
+		FPathfindingBenchmark::RunSearchPolicies(GridSize, NumQueries);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkConcurrentReadersCommand(
+	TEXT("AGP.Pathfinding.BenchmarkConcurrentReaders"),
+	TEXT("Runs path queries on worker threads against the published graph versions while the game thread blocks and unblocks connections. Usage: AGP.Pathfinding.BenchmarkConcurrentReaders [GridSize=60] [NumReaders=4] [NumEdits=200]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 GridSize = Args.Num() > 0 ? FMath::Max(3, FCString::Atoi(*Args[0])) : 60;
+		const int32 NumReaders = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 4;
+		const int32 NumEdits = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : 200;
+		FPathfindingBenchmark::RunConcurrentReaders(World, GridSize, NumReaders, NumEdits);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkEnemyAICommand(
+	TEXT("AGP.Pathfinding.BenchmarkEnemyAI"),
+	TEXT("Compares enemies running their own AI in their ticks with the enemy AI manager running it for all of them in batches, in ms per enemy. Usage: AGP.Pathfinding.BenchmarkEnemyAI [NumFrames=30] [EnemyCounts=100 500 1000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumFrames = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 30;
+		TArray<int32> EnemyCounts;
+		for (int32 i = 1; i < Args.Num(); i++)
+		{
+			EnemyCounts.Add(FMath::Max(1, FCString::Atoi(*Args[i])));
+		}
+		if (EnemyCounts.IsEmpty())
+		{
+			EnemyCounts = { 100, 500, 1000 };
+		}
+		FPathfindingBenchmark::RunEnemyAI(World, NumFrames, EnemyCounts);
+	}));
+
+#endif
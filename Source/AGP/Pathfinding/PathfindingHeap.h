@@ -0,0 +1,178 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * A binary min-heap of dense integer ids keyed by a priority. The heap position of every id is tracked so that
+ * Contains is O(1) and DecreaseKey is O(log n), which is what the A* open set needs. Keys only need operator<.
+ */
+template <typename KeyType>
+class TIndexedMinHeap
+{
+public:
+
+	/**
+	 * Empties the heap and makes sure that ids in the range [0, NumIds) can be pushed. Only the entries that are still
+	 * in the heap are cleared so this does not touch the whole position table when it is already big enough.
+	 * @param NumIds The number of ids that the heap will need to be able to hold.
+	 */
+	void Reset(int32 NumIds)
+	{
+		for (const FEntry& Entry : Entries)
+		{
+			Positions[Entry.Id] = INDEX_NONE;
+		}
+		Entries.Reset();
+
+		if (Positions.Num() < NumIds)
+		{
+			const int32 OldNum = Positions.Num();
+			Positions.SetNumUninitialized(NumIds);
+			for (int32 i = OldNum; i < NumIds; i++)
+			{
+				Positions[i] = INDEX_NONE;
+			}
+		}
+	}
+
+	bool IsEmpty() const { return Entries.IsEmpty(); }
+	int32 Num() const { return Entries.Num(); }
+	bool Contains(int32 Id) const { return Positions[Id] != INDEX_NONE; }
+	const KeyType& TopKey() const { return Entries[0].Key; }
+	int32 Top() const { return Entries[0].Id; }
+
+	/**
+	 * Adds the id to the heap, or lowers its key if it is already in there with a higher key.
+	 * @param Id The id to add or update.
+	 * @param Key The priority of the id. Lower keys are popped first.
+	 */
+	void PushOrDecrease(int32 Id, const KeyType& Key)
+	{
+		int32 Pos = Positions[Id];
+		if (Pos == INDEX_NONE)
+		{
+			Pos = Entries.Add({Key, Id});
+			Positions[Id] = Pos;
+		}
+		else if (Key < Entries[Pos].Key)
+		{
+			Entries[Pos].Key = Key;
+		}
+		else
+		{
+			return;
+		}
+		SiftUp(Pos);
+	}
+
+	/**
+	 * Adds the id to the heap, or changes its key in either direction if it is already in there.
+	 */
+	void PushOrUpdate(int32 Id, const KeyType& Key)
+	{
+		const int32 Pos = Positions[Id];
+		if (Pos == INDEX_NONE || Key < Entries[Pos].Key)
+		{
+			PushOrDecrease(Id, Key);
+		}
+		else
+		{
+			Entries[Pos].Key = Key;
+			SiftDown(Pos);
+		}
+	}
+
+	/**
+	 * Removes the id from the heap if it is in there.
+	 */
+	void Remove(int32 Id)
+	{
+		const int32 Pos = Positions[Id];
+		if (Pos == INDEX_NONE)
+		{
+			return;
+		}
+		Positions[Id] = INDEX_NONE;
+
+		const FEntry Last = Entries.Pop(false);
+		if (Pos < Entries.Num())
+		{
+			// Put the last entry in the hole, it may need to move either way.
+			Entries[Pos] = Last;
+			Positions[Last.Id] = Pos;
+			SiftDown(Pos);
+			SiftUp(Positions[Last.Id]);
+		}
+	}
+
+	/**
+	 * Removes the id with the lowest key from the heap.
+	 * @return The id that was removed.
+	 */
+	int32 Pop()
+	{
+		const int32 TopId = Entries[0].Id;
+		Positions[TopId] = INDEX_NONE;
+
+		const FEntry Last = Entries.Pop(false);
+		if (!Entries.IsEmpty())
+		{
+			Entries[0] = Last;
+			Positions[Last.Id] = 0;
+			SiftDown(0);
+		}
+		return TopId;
+	}
+
+private:
+
+	struct FEntry
+	{
+		KeyType Key;
+		int32 Id;
+	};
+
+	void SiftUp(int32 Pos)
+	{
+		const FEntry Moving = Entries[Pos];
+		while (Pos > 0)
+		{
+			const int32 Parent = (Pos - 1) / 2;
+			if (!(Moving.Key < Entries[Parent].Key)) break;
+			Entries[Pos] = Entries[Parent];
+			Positions[Entries[Pos].Id] = Pos;
+			Pos = Parent;
+		}
+		Entries[Pos] = Moving;
+		Positions[Moving.Id] = Pos;
+	}
+
+	void SiftDown(int32 Pos)
+	{
+		const FEntry Moving = Entries[Pos];
+		const int32 Count = Entries.Num();
+		while (true)
+		{
+			int32 Child = Pos * 2 + 1;
+			if (Child >= Count) break;
+			if (Child + 1 < Count && Entries[Child + 1].Key < Entries[Child].Key)
+			{
+				Child++;
+			}
+			if (!(Entries[Child].Key < Moving.Key)) break;
+			Entries[Pos] = Entries[Child];
+			Positions[Entries[Pos].Id] = Pos;
+			Pos = Child;
+		}
+		Entries[Pos] = Moving;
+		Positions[Moving.Id] = Pos;
+	}
+
+	TArray<FEntry> Entries;
+	// Heap position of each id, or INDEX_NONE if the id is not in the heap.
+	TArray<int32> Positions;
+};
+
+using FIndexedMinHeap = TIndexedMinHeap<float>;
@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PathfindingStats.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_STAT(STAT_AGPPathfinding_GetPath);
+DEFINE_STAT(STAT_AGPPathfinding_FindNearestNode);
+DEFINE_STAT(STAT_AGPPathfinding_FindFurthestNode);
+DEFINE_STAT(STAT_AGPPathfinding_BatchedPath);
+DEFINE_STAT(STAT_AGPPathfinding_UpdatePathfindingNodes);
+DEFINE_STAT(STAT_AGPPathfinding_PlaceProceduralNodes);
+DEFINE_STAT(STAT_AGPPathfinding_RebuildGraph);
+DEFINE_STAT(STAT_AGPPathfinding_TimeSlicedSearches);
+DEFINE_STAT(STAT_AGPPathfinding_RepairTrackedPaths);
+DEFINE_STAT(STAT_AGPPathfinding_UpdateFlowFields);
+DEFINE_STAT(STAT_AGPPathfinding_BuildEscapeField);
+DEFINE_STAT(STAT_AGPPathfinding_BuildPatrolCircuits);
+DEFINE_STAT(STAT_AGPPathfinding_NumPathQueries);
+DEFINE_STAT(STAT_AGPPathfinding_NodesExpanded);
+
+UE_TRACE_CHANNEL_DEFINE(AGPPathfindingChannel);
+
+static TAutoConsoleVariable<int32> CVarPathfindingRecordHistograms(
+	TEXT("AGP.Pathfinding.RecordHistograms"),
+	UE_BUILD_SHIPPING ? 0 : 1,
+	TEXT("Records the latency and search counters of every pathfinding query for AGP.Pathfinding.Histograms. Off by default in shipping builds."));
+
+static FAutoConsoleCommand PathfindingHistogramsCommand(
+	TEXT("AGP.Pathfinding.Histograms"),
+	TEXT("Logs latency histograms and search counters over the latest pathfinding queries of each kind. Usage: AGP.Pathfinding.Histograms [Reset]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FPathfindingQueryHistograms::Get().Dump();
+		if (Args.Num() > 0 && Args[0] == TEXT("Reset"))
+		{
+			FPathfindingQueryHistograms::Get().Reset();
+		}
+	}));
+
+namespace
+{
+	const TCHAR* GetQueryName(EPathfindingQuery Query)
+	{
+		switch (Query)
+		{
+		case EPathfindingQuery::GetPath: return TEXT("GetPath");
+		case EPathfindingQuery::FindNearestNode: return TEXT("FindNearestNode");
+		case EPathfindingQuery::FindFurthestNode: return TEXT("FindFurthestNode");
+		case EPathfindingQuery::BatchedPath: return TEXT("BatchedPath");
+		case EPathfindingQuery::UpdatePathfindingNodes: return TEXT("UpdatePathfindingNodes");
+		case EPathfindingQuery::PlaceProceduralNodes: return TEXT("PlaceProceduralNodes");
+		case EPathfindingQuery::RebuildGraph: return TEXT("RebuildGraph");
+		default: return TEXT("Unknown");
+		}
+	}
+
+	template <typename ValueType>
+	ValueType GetPercentile(const TArray<ValueType>& SortedValues, double Fraction)
+	{
+		return SortedValues[FMath::Clamp(FMath::CeilToInt32(Fraction * SortedValues.Num()) - 1, 0, SortedValues.Num() - 1)];
+	}
+}
+
+FPathfindingQueryHistograms& FPathfindingQueryHistograms::Get()
+{
+	static FPathfindingQueryHistograms Histograms;
+	return Histograms;
+}
+
+bool FPathfindingQueryHistograms::IsEnabled()
+{
+	return CVarPathfindingRecordHistograms.GetValueOnAnyThread() != 0;
+}
+
+FPathfindingQueryHistograms::FThreadWindows& FPathfindingQueryHistograms::GetThreadWindows()
+{
+	static thread_local FThreadWindows* Windows = nullptr;
+	if (!Windows)
+	{
+		FScopeLock ScopeLock(&ThreadWindowsLock);
+		Windows = ThreadWindows.Add_GetRef(MakeUnique<FThreadWindows>()).Get();
+	}
+	return *Windows;
+}
+
+void FPathfindingQueryHistograms::Record(EPathfindingQuery Query, float Microseconds, int32 NumExpanded, int32 PeakOpenSetSize, int32 PathLength)
+{
+	const FSample Sample = { Microseconds, NumExpanded, PeakOpenSetSize, PathLength };
+	FThreadWindows& Thread = GetThreadWindows();
+	FScopeLock ScopeLock(&Thread.Lock);
+	FWindow& Window = Thread.Windows[static_cast<int32>(Query)];
+	if (Window.Samples.Max() == 0)
+	{
+		// Allocate the whole window up front so that recording never allocates again.
+		Window.Samples.Reserve(WindowSize);
+	}
+	if (Window.Samples.Num() < WindowSize)
+	{
+		Window.Samples.Add(Sample);
+	}
+	else
+	{
+		Window.Samples[Window.Next] = Sample;
+		Window.Next = (Window.Next + 1) % WindowSize;
+	}
+	Window.TotalRecorded++;
+}
+
+void FPathfindingQueryHistograms::Dump() const
+{
+	// Merge every thread's samples into one window per kind, so no lock is held while logging. Each thread is only
+	// locked for as long as it takes to copy its samples out.
+	TArray<FWindow> Copies;
+	Copies.SetNum(static_cast<int32>(EPathfindingQuery::Num));
+	int32 NumThreads = 0;
+	{
+		FScopeLock ScopeLock(&ThreadWindowsLock);
+		NumThreads = ThreadWindows.Num();
+		for (const TUniquePtr<FThreadWindows>& Thread : ThreadWindows)
+		{
+			FScopeLock ThreadScopeLock(&Thread->Lock);
+			for (int32 QueryIndex = 0; QueryIndex < Copies.Num(); QueryIndex++)
+			{
+				Copies[QueryIndex].Samples.Append(Thread->Windows[QueryIndex].Samples);
+				Copies[QueryIndex].TotalRecorded += Thread->Windows[QueryIndex].TotalRecorded;
+			}
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Pathfinding query histograms over the latest %d queries of each kind on each of %d threads:"),
+		WindowSize, NumThreads)
+	for (int32 QueryIndex = 0; QueryIndex < Copies.Num(); QueryIndex++)
+	{
+		const TArray<FSample>& Samples = Copies[QueryIndex].Samples;
+		if (Samples.IsEmpty()) continue;
+
+		TArray<float> Latencies;
+		TArray<int32> Expanded;
+		TArray<int32> OpenSetPeaks;
+		TArray<int32> PathLengths;
+		double TotalMicroseconds = 0.0;
+		for (const FSample& Sample : Samples)
+		{
+			Latencies.Add(Sample.Microseconds);
+			Expanded.Add(Sample.NumExpanded);
+			OpenSetPeaks.Add(Sample.PeakOpenSetSize);
+			PathLengths.Add(Sample.PathLength);
+			TotalMicroseconds += Sample.Microseconds;
+		}
+		Latencies.Sort();
+		Expanded.Sort();
+		OpenSetPeaks.Sort();
+		PathLengths.Sort();
+
+		UE_LOG(LogTemp, Display, TEXT("%s: %d samples (%llu in total), mean %.1f us, p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us"),
+			GetQueryName(static_cast<EPathfindingQuery>(QueryIndex)), Samples.Num(), Copies[QueryIndex].TotalRecorded,
+			TotalMicroseconds / Samples.Num(), GetPercentile(Latencies, 0.5), GetPercentile(Latencies, 0.9),
+			GetPercentile(Latencies, 0.99), Latencies.Last())
+		if (Expanded.Last() > 0 || PathLengths.Last() > 0)
+		{
+			UE_LOG(LogTemp, Display, TEXT("  Nodes expanded p50 %d p99 %d max %d, open set peak p50 %d p99 %d max %d, path nodes p50 %d p99 %d max %d"),
+				GetPercentile(Expanded, 0.5), GetPercentile(Expanded, 0.99), Expanded.Last(),
+				GetPercentile(OpenSetPeaks, 0.5), GetPercentile(OpenSetPeaks, 0.99), OpenSetPeaks.Last(),
+				GetPercentile(PathLengths, 0.5), GetPercentile(PathLengths, 0.99), PathLengths.Last())
+		}
+
+		// Power of two buckets from under 1us upwards, drawn as bars scaled to the fullest bucket.
+		TArray<int32> Buckets;
+		for (const float Latency : Latencies)
+		{
+			const int32 Bucket = Latency < 1.0f ? 0 : 1 + FMath::FloorLog2(static_cast<uint32>(FMath::Min(Latency, static_cast<float>(MAX_int32))));
+			if (Buckets.Num() <= Bucket)
+			{
+				Buckets.SetNumZeroed(Bucket + 1);
+			}
+			Buckets[Bucket]++;
+		}
+		const int32 FullestBucket = FMath::Max(Buckets);
+		for (int32 Bucket = 0; Bucket < Buckets.Num(); Bucket++)
+		{
+			const uint32 Low = Bucket == 0 ? 0 : 1u << (Bucket - 1);
+			UE_LOG(LogTemp, Display, TEXT("  %8u - %8u us %6d %s"), Low, 1u << Bucket, Buckets[Bucket],
+				*FString::ChrN(FMath::DivideAndRoundUp(Buckets[Bucket] * 40, FullestBucket), TEXT('#')))
+		}
+	}
+}
+
+void FPathfindingQueryHistograms::Reset()
+{
+	FScopeLock ScopeLock(&ThreadWindowsLock);
+	for (const TUniquePtr<FThreadWindows>& Thread : ThreadWindows)
+	{
+		FScopeLock ThreadScopeLock(&Thread->Lock);
+		for (FWindow& Window : Thread->Windows)
+		{
+			Window = FWindow();
+		}
+	}
+}
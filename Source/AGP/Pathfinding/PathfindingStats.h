@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+DECLARE_STATS_GROUP(TEXT("AGP Pathfinding"), STATGROUP_AGPPathfinding, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("GetPath"), STAT_AGPPathfinding_GetPath, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FindNearestNode"), STAT_AGPPathfinding_FindNearestNode, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FindFurthestNode"), STAT_AGPPathfinding_FindFurthestNode, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("BatchedPath"), STAT_AGPPathfinding_BatchedPath, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdatePathfindingNodes"), STAT_AGPPathfinding_UpdatePathfindingNodes, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PlaceProceduralNodes"), STAT_AGPPathfinding_PlaceProceduralNodes, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("RebuildGraph"), STAT_AGPPathfinding_RebuildGraph, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TimeSlicedSearches"), STAT_AGPPathfinding_TimeSlicedSearches, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("RepairTrackedPaths"), STAT_AGPPathfinding_RepairTrackedPaths, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateFlowFields"), STAT_AGPPathfinding_UpdateFlowFields, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("BuildEscapeField"), STAT_AGPPathfinding_BuildEscapeField, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("BuildPatrolCircuits"), STAT_AGPPathfinding_BuildPatrolCircuits, STATGROUP_AGPPathfinding, AGP_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Path queries"), STAT_AGPPathfinding_NumPathQueries, STATGROUP_AGPPathfinding, AGP_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Nodes expanded"), STAT_AGPPathfinding_NodesExpanded, STATGROUP_AGPPathfinding, AGP_API);
+
+// Every pathfinding scope in Unreal Insights is on this channel, so it can be turned on by itself with
+// -trace=cpu,AGPPathfinding or Trace.Enable AGPPathfinding.
+UE_TRACE_CHANNEL_EXTERN(AGPPathfindingChannel, AGP_API);
+
+/**
+ * The kinds of query that FPathfindingQueryHistograms keeps samples of.
+ */
+enum class EPathfindingQuery : uint8
+{
+	GetPath,
+	FindNearestNode,
+	FindFurthestNode,
+	BatchedPath,
+	UpdatePathfindingNodes,
+	PlaceProceduralNodes,
+	RebuildGraph,
+	Num
+};
+
+/**
+ * The latest few thousand samples of every kind of query on every thread, for AGP.Pathfinding.Histograms to summarise.
+ * Samples can be recorded from any thread. Each thread records into its own windows so that worker threads running
+ * queries at the same time don't wait on each other, and the windows are only merged when they are dumped.
+ */
+class AGP_API FPathfindingQueryHistograms
+{
+public:
+
+	static FPathfindingQueryHistograms& Get();
+
+	/**
+	 * @return Whether queries are being recorded, which AGP.Pathfinding.RecordHistograms controls.
+	 */
+	static bool IsEnabled();
+
+	/**
+	 * Adds a sample to the calling thread's window, replacing the oldest one of its kind there once the window is full.
+	 * @param Query The kind of query.
+	 * @param Microseconds How long the query took.
+	 * @param NumExpanded How many nodes the search expanded, for queries that search.
+	 * @param PeakOpenSetSize The most nodes that were in the search's open set at once.
+	 * @param PathLength The number of nodes on the path that was found.
+	 */
+	void Record(EPathfindingQuery Query, float Microseconds, int32 NumExpanded = 0, int32 PeakOpenSetSize = 0, int32 PathLength = 0);
+
+	/**
+	 * Logs the latency percentiles and a histogram for every kind of query, and the search counters for the ones that
+	 * search.
+	 */
+	void Dump() const;
+	void Reset();
+
+private:
+
+	// How many of the latest samples of each kind are kept for each thread.
+	static constexpr int32 WindowSize = 4096;
+
+	struct FSample
+	{
+		float Microseconds;
+		int32 NumExpanded;
+		int32 PeakOpenSetSize;
+		int32 PathLength;
+	};
+
+	struct FWindow
+	{
+		TArray<FSample> Samples;
+		// Where the next sample goes once the window is full.
+		int32 Next = 0;
+		uint64 TotalRecorded = 0;
+	};
+
+	struct FThreadWindows
+	{
+		FWindow Windows[static_cast<int32>(EPathfindingQuery::Num)];
+		// Only the owning thread records, so this is only ever contended while the windows are dumped or reset.
+		FCriticalSection Lock;
+	};
+
+	/**
+	 * @return The calling thread's windows, made the first time the thread records a sample.
+	 */
+	FThreadWindows& GetThreadWindows();
+
+	// Kept until the histograms are destroyed, even after their thread exits, so their samples still get dumped.
+	TArray<TUniquePtr<FThreadWindows>> ThreadWindows;
+	// Guards the list of threads, taken once per thread to add to it and by Dump and Reset.
+	mutable FCriticalSection ThreadWindowsLock;
+};
+
+/**
+ * Times a query for the histograms. The search counters can be filled in before the scope ends.
+ */
+class FPathfindingQueryScope
+{
+public:
+
+	explicit FPathfindingQueryScope(EPathfindingQuery InQuery)
+		: Query(InQuery), bEnabled(FPathfindingQueryHistograms::IsEnabled()), StartCycles(bEnabled ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FPathfindingQueryScope()
+	{
+		if (bEnabled)
+		{
+			FPathfindingQueryHistograms::Get().Record(Query, FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles) * 1e6,
+				NumExpanded, PeakOpenSetSize, PathLength);
+		}
+	}
+
+	void SetSearchCounters(int32 InNumExpanded, int32 InPeakOpenSetSize, int32 InPathLength)
+	{
+		NumExpanded = InNumExpanded;
+		PeakOpenSetSize = InPeakOpenSetSize;
+		PathLength = InPathLength;
+	}
+
+private:
+
+	EPathfindingQuery Query;
+	bool bEnabled;
+	uint64 StartCycles;
+	int32 NumExpanded = 0;
+	int32 PeakOpenSetSize = 0;
+	int32 PathLength = 0;
+};
+
+// Puts the enclosing scope in the stat group and on the trace channel.
+#define AGP_PATHFINDING_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_AGPPathfinding_##Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR("AGPPathfinding::" #Name, AGPPathfindingChannel)
+
+// The same as AGP_PATHFINDING_SCOPE, and also records the scope in the histograms through a local named
+// PathfindingQueryScope.
+#define AGP_PATHFINDING_QUERY_SCOPE(Name) \
+	AGP_PATHFINDING_SCOPE(Name); \
+	FPathfindingQueryScope PathfindingQueryScope(EPathfindingQuery::Name)
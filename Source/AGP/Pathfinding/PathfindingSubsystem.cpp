@@ -5,358 +5,1688 @@
 #include "AGP/Characters/EnemyCharacter.h"
 #include "EngineUtils.h"
 #include "NavigationNode.h"
+#include "NavigationSpatialHash.h"
+#include "PathfindingStats.h"
 #include "Components/BoxComponent.h"
+#include "DrawDebugHelpers.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Unique.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#if WITH_EDITOR
+#include "UObject/ObjectSaveContext.h"
+#endif
+
+static TAutoConsoleVariable<int32> CVarPathfindingTimeSliceBudget(
+	TEXT("AGP.Pathfinding.TimeSliceBudgetUs"),
+	0,
+	TEXT("Microseconds per frame the game thread spends on asynchronous path requests, shared across all of them. ")
+	TEXT("0 solves the requests in batches on worker threads instead."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingMaxActiveSearches(
+	TEXT("AGP.Pathfinding.MaxActiveSearches"),
+	32,
+	TEXT("The most time sliced path searches that can be in progress at once. Each one holds its own search memory."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingPathCacheSize(
+	TEXT("AGP.Pathfinding.PathCacheSize"),
+	256,
+	TEXT("The most node to node paths kept in the path cache. 0 turns the cache off."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingRoutingTableMaxNodes(
+	TEXT("AGP.Pathfinding.RoutingTableMaxNodes"),
+	512,
+	TEXT("Graphs with at most this many nodes get an all pairs next hop table so paths are looked up instead of searched. ")
+	TEXT("The table takes 2 bytes per pair of nodes and is never built for more than 16384 nodes. 0 never builds one."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingHierarchyClusterRooms(
+	TEXT("AGP.Pathfinding.HierarchyClusterRooms"),
+	8,
+	TEXT("Width in dungeon rooms of the clusters used for hierarchical pathfinding on generated dungeons. 0 turns it off."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingHierarchyMinNodes(
+	TEXT("AGP.Pathfinding.HierarchyMinNodes"),
+	2048,
+	TEXT("Graphs need at least this many nodes, and no routing table, before long paths are found hierarchically."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingLandmarks(
+	TEXT("AGP.Pathfinding.Landmarks"),
+	8,
+	TEXT("How many landmarks to precompute distances for, to tighten the A* heuristic on graphs without a routing table. ")
+	TEXT("Each one takes 8 bytes per node and two Dijkstra searches per rebuild. 0 turns them off."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingEscapeFields(
+	TEXT("AGP.Pathfinding.EscapeFields"),
+	1,
+	TEXT("Paths away from a location lead to the node furthest from it by path, found with one Dijkstra field shared by ")
+	TEXT("every query fleeing the same node. 0 goes back to the node furthest in a straight line and a search per query."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingPatrolCircuits(
+	TEXT("AGP.Pathfinding.PatrolCircuits"),
+	1,
+	TEXT("Patrolling agents follow loops precomputed over the graph a node at a time. 0 searches for a path to a random ")
+	TEXT("node every time an agent arrives at the end of its last one."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingPatrolCircuitVariants(
+	TEXT("AGP.Pathfinding.PatrolCircuitVariants"),
+	4,
+	TEXT("How many differently shuffled patrol loops to build through each part of the graph. Each one costs 8 bytes per ")
+	TEXT("node and about two steps per node."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingDungeonGridPaths(
+	TEXT("AGP.Pathfinding.DungeonGridPaths"),
+	1,
+	TEXT("Paths between two rooms of a generated dungeon are walked over its room and corridor grid instead of searched ")
+	TEXT("for on the node graph, while nothing is blocked. 0 always searches the node graph."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingLoadBakedGraph(
+	TEXT("AGP.Pathfinding.LoadBakedGraph"),
+	1,
+	TEXT("Loads the level's first navigation graph from its baked graph file instead of building it, if the file was ")
+	TEXT("baked from the same nodes. 0 always builds it."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingParallelGroundProbes(
+	TEXT("AGP.Pathfinding.ParallelGroundProbes"),
+	1,
+	TEXT("Spreads the ground traces for procedurally placed nodes over the task graph workers. 0 traces them one at a ")
+	TEXT("time on the game thread."));
+
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<int32> CVarPathfindingDrawGroundProbes(
+	TEXT("AGP.Pathfinding.DrawGroundProbes"),
+	0,
+	TEXT("Draws every ground trace made when placing procedural nodes, green where they hit and red where they missed."));
+
+static TAutoConsoleVariable<int32> CVarPathfindingDrawGraph(
+	TEXT("AGP.Pathfinding.DrawGraph"),
+	0,
+	TEXT("Draws the navigation graph, in editor viewports as well as in game. Blue points are nodes, green lines two way ")
+	TEXT("connections, red lines one way connections and orange lines blocked connections."));
+#endif
+
+// How far above and below a location the ground traces start and end.
+static constexpr float GroundProbeHeight = 100.0f;
+static constexpr float GroundProbeDepth = 1000.0f;
+
+// How many ground traces each worker takes at a time. Traces are cheap, so small batches spend more on scheduling
+// than tracing.
+static constexpr int32 GroundProbesPerBatch = 256;
+
+// How many nodes a time sliced search expands before the next search gets a turn.
+static constexpr int32 ExpansionsPerSlice = 16;
+
+// How many frames a flow field is kept after its last use.
+static constexpr uint64 FlowFieldIdleFrames = 120;
+
+// Written at the start of every baked graph file, "AGPN".
+static constexpr uint32 BakedGraphMagic = 0x4E504741;
+// Bumped whenever the layout of the baked graph file changes. Files with any other version are ignored until the level
+// is baked again.
+static constexpr uint32 BakedGraphFileVersion = 4;
+
+static FAutoConsoleCommandWithWorld PathRequestStatsCommand(
+	TEXT("AGP.Pathfinding.RequestStats"),
+	TEXT("Logs the asynchronous path request statistics."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UPathfindingSubsystem* PathfindingSubsystem = World ? World->GetSubsystem<UPathfindingSubsystem>() : nullptr)
+		{
+			const UPathfindingSubsystem::FPathRequestStats Stats = PathfindingSubsystem->GetPathRequestStats();
+			UE_LOG(LogTemp, Display, TEXT("Path requests: %d queued, %d active, %d expansions last frame, %llu completed, %.2f frames average latency."),
+				Stats.QueuedRequests, Stats.ActiveRequests, Stats.ExpansionsLastFrame, Stats.CompletedRequests, Stats.AverageLatencyFrames)
+			UE_LOG(LogTemp, Display, TEXT("Path cache: %llu hits, %llu misses."), Stats.PathCacheHits, Stats.PathCacheMisses)
+		}
+	}));
+
+#if WITH_EDITOR
+static FAutoConsoleCommandWithWorld BakeGraphCommand(
+	TEXT("AGP.Pathfinding.BakeGraph"),
+	TEXT("Writes the current navigation graph to the level's baked graph file. Levels are also baked whenever they are saved in the editor."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UPathfindingSubsystem* PathfindingSubsystem = World ? World->GetSubsystem<UPathfindingSubsystem>() : nullptr)
+		{
+			PathfindingSubsystem->SaveBakedGraph();
+		}
+	}));
+#endif
+
+void UPathfindingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+#if WITH_EDITOR
+	if (GetWorld()->WorldType == EWorldType::Editor)
+	{
+		FCoreUObjectDelegates::OnObjectPreSave.AddUObject(this, &UPathfindingSubsystem::OnObjectPreSave);
+	}
+#endif
+}
 
 void UPathfindingSubsystem::OnWorldBeginPlay(UWorld& InWorld)
 {
-	UE_LOG(LogTemp, Warning, TEXT("Creating the UPathfindingSubsystem."))
-	PopulateNodes();
+	UE_LOG(LogTemp, Warning, TEXT("Creating the UPathfindingSubsystem."))
+	const double StartTime = FPlatformTime::Seconds();
+	// The first graph built from the level's nodes is loaded from the bake instead if the bake was made from the same
+	// nodes. Generated dungeons only hand their nodes over in their own BeginPlay, so for them that is a later rebuild.
+	bLoadBakedGraph = CVarPathfindingLoadBakedGraph.GetValueOnGameThread() != 0;
+	PopulateNodes();
+	// Build the snapshot now rather than on the first query, so the first enemy to ask for a path doesn't pay for it.
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+	UE_LOG(LogTemp, Log, TEXT("Navigation graph with %d nodes ready in %.2f ms"), NavGraph->Num(),
+		(FPlatformTime::Seconds() - StartTime) * 1000.0)
+
+	TArray<AActor*> HidingSpots;
+	for(TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		AActor* CheckActor = *It;
+
+		//check if actor has hideableobject tag
+		if(CheckActor->ActorHasTag("HideableObject"))
+		{
+			HidingSpots.Add(CheckActor);
+			UE_LOG(LogTemp, Error, TEXT("hiding spots: %d"), HidingSpots.Num());
+		}
+	}
+
+	AddHidingSpotNode(HidingSpots);
+}
+
+void UPathfindingSubsystem::Deinitialize()
+{
+	// The batch task only holds its own copy of the graph snapshot and endpoints, but wait for it so that nothing is
+	// still running once the world is gone.
+	if (InFlightBatch.IsValid())
+	{
+		InFlightBatch.Wait();
+	}
+	for (TPair<TWeakObjectPtr<const AActor>, FFlowFieldEntry>& Pair : FlowFields)
+	{
+		if (Pair.Value.Pending.IsValid())
+		{
+			Pair.Value.Pending.Wait();
+		}
+	}
+	FlowFields.Empty();
+	EscapeFields.Empty();
+	GraphVersions.Reset();
+	QueuedRequests.Empty();
+	InFlightRequests.Empty();
+	PathBatch = FPathBatch();
+	ActiveSearches.Empty();
+	FreeQueries.Empty();
+	TrackedPaths.Empty();
+#if WITH_EDITOR
+	FCoreUObjectDelegates::OnObjectPreSave.RemoveAll(this);
+#endif
+
+	Super::Deinitialize();
+}
+
+#if WITH_EDITOR
+void UPathfindingSubsystem::OnObjectPreSave(UObject* Object, FObjectPreSaveContext SaveContext)
+{
+	// Bake whenever the level is saved so the bake is made from the nodes it was saved with. Autosaves and cooks don't
+	// change the level, and cooked builds ship the bake written when it was last saved.
+	if (Object != GetWorld() || SaveContext.IsProceduralSave())
+	{
+		return;
+	}
+
+	// Node actors aren't registered in editor worlds, so gather them now. Generated nodes are only here if they were
+	// generated since the level was opened, otherwise they haven't changed and neither does the bake.
+	if (!bGeneratedNodes)
+	{
+		PopulateNodes();
+		if (Nodes.IsEmpty())
+		{
+			return;
+		}
+	}
+	SaveBakedGraph();
+}
+#endif
+
+void UPathfindingSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Editor worlds only tick so the graph can be drawn in the level viewport, nothing makes requests in them.
+	if (!GetWorld()->IsGameWorld())
+	{
+#if !UE_BUILD_SHIPPING
+		DrawGraph();
+#endif
+		return;
+	}
+
+	// Rebuild the snapshot as soon as the graph has been edited, rather than waiting for the next query, so that worker
+	// thread queries see the edit this frame.
+	if (bGraphDirty)
+	{
+		GetGraphSnapshot();
+	}
+	// Every block and unblock since the last tick goes into one new snapshot, however many nodes they touched.
+	ApplyPendingEdgeCosts();
+	GraphVersions.Reclaim();
+
+	RepairTrackedPaths();
+	UpdateFlowFields();
+	for (auto It = EscapeFields.CreateIterator(); It; ++It)
+	{
+		if (GFrameCounter - It.Value().LastUsedFrame > FlowFieldIdleFrames)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	if (InFlightBatch.IsValid() && InFlightBatch.IsCompleted())
+	{
+		DeliverPathResults();
+	}
+
+	const int32 BudgetMicroseconds = CVarPathfindingTimeSliceBudget.GetValueOnGameThread();
+	if (BudgetMicroseconds > 0)
+	{
+		TickTimeSlicedSearches(BudgetMicroseconds / 1'000'000.0);
+	}
+	else
+	{
+		// Time slicing has been turned off so finish off any searches that were left over, then go back to batches.
+		ExpansionsLastFrame = 0;
+		if (!ActiveSearches.IsEmpty())
+		{
+			TickTimeSlicedSearches(TNumericLimits<double>::Max());
+		}
+		DispatchPathRequests();
+	}
+
+#if !UE_BUILD_SHIPPING
+	DrawGraph();
+#endif
+}
+
+bool UPathfindingSubsystem::IsTickableInEditor() const
+{
+	// Generated nodes have no actors to draw themselves while the level is being edited, so the subsystem draws them.
+	return true;
+}
+
+TStatId UPathfindingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPathfindingSubsystem, STATGROUP_Tickables);
+}
+
+TArray<FVector> UPathfindingSubsystem::GetWaypointPositions() const
+{
+	TArray<FVector> NodePositions;
+	if (bGeneratedNodes)
+	{
+		NodePositions.Reserve(NodeData.Num());
+		for (const FNavigationNodeData& Node : NodeData)
+		{
+			NodePositions.Add(Node.Location);
+		}
+		return NodePositions;
+	}
+
+	for (ANavigationNode* Node : Nodes)
+	{
+		if (Node)
+		{
+			NodePositions.Add(Node->GetActorLocation());
+		}
+	}
+	return NodePositions;
+}
+
+TArray<FVector> UPathfindingSubsystem::GetRandomPath(const FVector& StartLocation)
+{
+	TArray<FVector> Path;
+	GetRandomPath(StartLocation, Path);
+	return Path;
+}
+
+TArray<FVector> UPathfindingSubsystem::GetPath(const FVector& StartLocation, const FVector& TargetLocation)
+{
+	TArray<FVector> Path;
+	GetPath(StartLocation, TargetLocation, Path);
+	return Path;
+}
+
+TArray<FVector> UPathfindingSubsystem::GetPathAway(const FVector& StartLocation, const FVector& TargetLocation)
+{
+	TArray<FVector> Path;
+	GetPathAway(StartLocation, TargetLocation, Path);
+	return Path;
+}
+
+bool UPathfindingSubsystem::GetRandomPath(const FVector& StartLocation, TArray<FVector>& OutPath)
+{
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+	return GetPath(*NavGraph, FindNearestNode(*NavGraph, StartLocation), GetRandomNode(*NavGraph), OutPath);
+}
+
+bool UPathfindingSubsystem::GetPath(const FVector& StartLocation, const FVector& TargetLocation, TArray<FVector>& OutPath)
+{
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+	return GetPath(*NavGraph, FindNearestNode(*NavGraph, StartLocation), FindNearestNode(*NavGraph, TargetLocation), OutPath);
+}
+
+bool UPathfindingSubsystem::GetPathAway(const FVector& StartLocation, const FVector& TargetLocation, TArray<FVector>& OutPath)
+{
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+	const int32 StartIndex = FindNearestNode(*NavGraph, StartLocation);
+	if (const FEscapeField* EscapeField = GetEscapeField(NavGraph, FindNearestNode(*NavGraph, TargetLocation)))
+	{
+		if (EscapeField->Field->GetPath(StartIndex, OutPath))
+		{
+			return true;
+		}
+	}
+	// Either the fields are off or the escape node is in another part of the graph, so flee in a straight line.
+	return GetPath(*NavGraph, StartIndex, FindFurthestNode(*NavGraph, TargetLocation), OutPath);
+}
+
+const UPathfindingSubsystem::FEscapeField* UPathfindingSubsystem::GetEscapeField(const FNavigationGraphPtr& NavGraph, int32 ThreatIndex)
+{
+	if (!CVarPathfindingEscapeFields.GetValueOnGameThread() || !NavGraph.IsValid() || !NavGraph->IsValidNode(ThreatIndex))
+	{
+		return nullptr;
+	}
+
+	// Blocking or unblocking anything makes a new snapshot, and with it new distances, so every field is dropped.
+	if (EscapeFieldsVersion != NavGraph->Version)
+	{
+		EscapeFields.Reset();
+		EscapeFieldsVersion = NavGraph->Version;
+	}
+
+	FEscapeField& EscapeField = EscapeFields.FindOrAdd(ThreatIndex);
+	EscapeField.LastUsedFrame = GFrameCounter;
+	if (!EscapeField.Field.IsValid())
+	{
+		AGP_PATHFINDING_SCOPE(BuildEscapeField);
+		FNavigationFlowField ThreatField;
+		ThreatField.Build(NavGraph, ThreatIndex);
+		EscapeField.EscapeIndex = ThreatField.FindFurthestNode();
+
+		const TSharedRef<FNavigationFlowField, ESPMode::ThreadSafe> Field = MakeShared<FNavigationFlowField, ESPMode::ThreadSafe>();
+		Field->Build(NavGraph, EscapeField.EscapeIndex);
+		EscapeField.Field = Field;
+	}
+	return &EscapeField;
+}
+
+void UPathfindingSubsystem::SetDungeonGrid(const FDungeonNavigationGrid& InDungeonGrid)
+{
+	DungeonGrid = InDungeonGrid;
+}
+
+uint32 UPathfindingSubsystem::RequestRandomPath(const FVector& StartLocation, FOnPathRequestComplete OnComplete)
+{
+	return QueuePathRequest(EPathRequestType::Random, StartLocation, FVector::ZeroVector, MoveTemp(OnComplete));
+}
+
+uint32 UPathfindingSubsystem::RequestPath(const FVector& StartLocation, const FVector& TargetLocation, FOnPathRequestComplete OnComplete)
+{
+	return QueuePathRequest(EPathRequestType::Path, StartLocation, TargetLocation, MoveTemp(OnComplete));
+}
+
+uint32 UPathfindingSubsystem::RequestPathAway(const FVector& StartLocation, const FVector& TargetLocation, FOnPathRequestComplete OnComplete)
+{
+	return QueuePathRequest(EPathRequestType::Away, StartLocation, TargetLocation, MoveTemp(OnComplete));
+}
+
+void UPathfindingSubsystem::CancelPathRequest(uint32 RequestId)
+{
+	QueuedRequests.RemoveAll([RequestId](const FPathRequest& Request) { return Request.Id == RequestId; });
+	for (int32 i = 0; i < ActiveSearches.Num(); i++)
+	{
+		if (ActiveSearches[i].Request.Id == RequestId)
+		{
+			ActiveSearches[i].Query->Reset();
+			FreeQueries.Add(MoveTemp(ActiveSearches[i].Query));
+			ActiveSearches.RemoveAt(i);
+			if (NextSliceIndex > i)
+			{
+				NextSliceIndex--;
+			}
+			break;
+		}
+	}
+	for (FPathRequest& Request : InFlightRequests)
+	{
+		if (Request.Id == RequestId)
+		{
+			// The batch is already running so just make sure nothing gets called when it finishes.
+			Request.OnComplete.Unbind();
+		}
+	}
+}
+
+uint32 UPathfindingSubsystem::QueuePathRequest(EPathRequestType Type, const FVector& StartLocation, const FVector& TargetLocation, FOnPathRequestComplete&& OnComplete)
+{
+	const uint32 RequestId = NextRequestId++;
+	if (NextRequestId == 0)
+	{
+		// Zero is never handed out so callers can use it to mean no request.
+		NextRequestId = 1;
+	}
+	FPathRequest& Request = QueuedRequests.AddDefaulted_GetRef();
+	Request.Id = RequestId;
+	Request.Type = Type;
+	Request.StartLocation = StartLocation;
+	Request.TargetLocation = TargetLocation;
+	Request.OnComplete = MoveTemp(OnComplete);
+	Request.RequestFrame = GFrameCounter;
+	return RequestId;
+}
+
+void UPathfindingSubsystem::DispatchPathRequests()
+{
+	// Only one batch runs at a time, anything requested in the meantime goes in the next one.
+	if (QueuedRequests.IsEmpty() || InFlightBatch.IsValid())
+	{
+		return;
+	}
+
+	PathCache.SetCapacity(CVarPathfindingPathCacheSize.GetValueOnGameThread());
+
+	// The endpoints are resolved here rather than when the request was made so that they always match the snapshot
+	// the batch is solved against, even if the graph was rebuilt in between. Requests that are already in the path
+	// cache, that flee along an escape field or that walk the dungeon grid don't need to go to the workers at all.
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+	FPathBatch Batch = MoveTemp(PathBatch);
+	Batch.Endpoints.Reset();
+	for (FPathRequest& Request : QueuedRequests)
+	{
+		ResolveRequestEndpoints(*NavGraph, Request);
+		if (TryFinishRequestWithoutSearch(NavGraph, Request))
+		{
+			continue;
+		}
+		Batch.Endpoints.Emplace(Request.StartIndex, Request.EndIndex);
+		InFlightRequests.Add(MoveTemp(Request));
+	}
+	QueuedRequests.Reset();
+
+	if (Batch.Endpoints.IsEmpty())
+	{
+		PathBatch = MoveTemp(Batch);
+	}
+	else
+	{
+		InFlightBatch = UE::Tasks::Launch(UE_SOURCE_LOCATION, [NavGraph, Batch = MoveTemp(Batch)]() mutable
+		{
+			if (Batch.Paths.Num() < Batch.Endpoints.Num())
+			{
+				Batch.Paths.SetNum(Batch.Endpoints.Num());
+			}
+			ParallelFor(Batch.Endpoints.Num(), [&NavGraph, &Batch](int32 i)
+			{
+				// Each worker thread keeps its own scratch so searches never share working memory.
+				static thread_local FNavigationSearchScratch WorkerScratch;
+				AGP_PATHFINDING_QUERY_SCOPE(BatchedPath);
+				TArray<FVector>& Path = Batch.Paths[i];
+				FNavigationSearch::FindPath(*NavGraph, Batch.Endpoints[i].Key, Batch.Endpoints[i].Value, WorkerScratch, Path);
+				PathfindingQueryScope.SetSearchCounters(WorkerScratch.NumExpanded, WorkerScratch.PeakOpenSetSize, Path.Num());
+				INC_DWORD_STAT(STAT_AGPPathfinding_NumPathQueries);
+				INC_DWORD_STAT_BY(STAT_AGPPathfinding_NodesExpanded, WorkerScratch.NumExpanded);
+			});
+			return MoveTemp(Batch);
+		});
+	}
+
+	CompleteFinishedRequests();
+}
+
+void UPathfindingSubsystem::DeliverPathResults()
+{
+	// Take ownership of the batch first, the callbacks are allowed to make new requests.
+	FPathBatch Batch = MoveTemp(InFlightBatch.GetResult());
+	InFlightBatch = UE::Tasks::TTask<FPathBatch>();
+	Swap(DeliveringRequests, InFlightRequests);
+
+	for (int32 i = 0; i < DeliveringRequests.Num(); i++)
+	{
+		const FPathRequest& Request = DeliveringRequests[i];
+		PathCache.Add(Request.GraphVersion, Request.StartIndex, Request.EndIndex, Batch.Paths[i]);
+		CompleteRequest(Request, Batch.Paths[i]);
+	}
+	DeliveringRequests.Reset();
+	PathBatch = MoveTemp(Batch);
+}
+
+void UPathfindingSubsystem::TickTimeSlicedSearches(double BudgetSeconds)
+{
+	AGP_PATHFINDING_SCOPE(TimeSlicedSearches);
+	ExpansionsLastFrame = 0;
+
+	PathCache.SetCapacity(CVarPathfindingPathCacheSize.GetValueOnGameThread());
+
+	// Start searches for as many of the queued requests as there is room for. Requests that are already in the path
+	// cache, or that flee along an escape field, finish straight away without taking up a search. The callbacks are
+	// run at the end because they are allowed to make or cancel requests.
+	const int32 MaxActiveSearches = FMath::Max(1, CVarPathfindingMaxActiveSearches.GetValueOnGameThread());
+	int32 NumTaken = 0;
+	if (!QueuedRequests.IsEmpty())
+	{
+		const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+		while (NumTaken < QueuedRequests.Num() && ActiveSearches.Num() < MaxActiveSearches)
+		{
+			FPathRequest& Request = QueuedRequests[NumTaken++];
+			ResolveRequestEndpoints(*NavGraph, Request);
+			if (TryFinishRequestWithoutSearch(NavGraph, Request))
+			{
+				continue;
+			}
+
+			FActiveSearch& Search = ActiveSearches.AddDefaulted_GetRef();
+			Search.Request = MoveTemp(Request);
+			Search.Query = FreeQueries.IsEmpty() ? MakeUnique<FNavigationSearchQuery>() : FreeQueries.Pop(false);
+			Search.Query->Start(NavGraph, Search.Request.StartIndex, Search.Request.EndIndex);
+		}
+		QueuedRequests.RemoveAt(0, NumTaken, false);
+	}
+
+	// Hand out the budget in small slices going round all of the active searches, so that one long search can't starve
+	// the rest.
+	const double EndTime = FPlatformTime::Seconds() + BudgetSeconds;
+	while (!ActiveSearches.IsEmpty() && FPlatformTime::Seconds() < EndTime)
+	{
+		NextSliceIndex %= ActiveSearches.Num();
+		FActiveSearch& Search = ActiveSearches[NextSliceIndex];
+
+		const int32 ExpandedBefore = Search.Query->GetNumExpanded();
+		const ENavigationSearchStatus Status = Search.Query->Step(ExpansionsPerSlice);
+		ExpansionsLastFrame += Search.Query->GetNumExpanded() - ExpandedBefore;
+
+		if (Status == ENavigationSearchStatus::InProgress)
+		{
+			NextSliceIndex++;
+			continue;
+		}
+
+		TPair<FPathRequest, TArray<FVector>>& Result = FinishedRequests.AddDefaulted_GetRef();
+		Result.Key = MoveTemp(Search.Request);
+		Result.Value = PathPool.Acquire();
+		Search.Query->GetPath(Result.Value);
+		PathCache.Add(Result.Key.GraphVersion, Result.Key.StartIndex, Result.Key.EndIndex, Result.Value);
+		Search.Query->Reset();
+		FreeQueries.Add(MoveTemp(Search.Query));
+		// Removing keeps the order so NextSliceIndex now points at the search after the one that finished.
+		ActiveSearches.RemoveAt(NextSliceIndex, 1, false);
+	}
+
+	CompleteFinishedRequests();
+}
+
+void UPathfindingSubsystem::ResolveRequestEndpoints(const FNavigationGraph& NavGraph, FPathRequest& Request) const
+{
+	Request.GraphVersion = NavGraph.Version;
+	Request.StartIndex = FindNearestNode(NavGraph, Request.StartLocation);
+	Request.EndIndex = INDEX_NONE;
+	switch (Request.Type)
+	{
+	case EPathRequestType::Path:
+		Request.EndIndex = FindNearestNode(NavGraph, Request.TargetLocation);
+		break;
+	case EPathRequestType::Random:
+		Request.EndIndex = GetRandomNode(NavGraph);
+		break;
+	case EPathRequestType::Away:
+		Request.EndIndex = FindFurthestNode(NavGraph, Request.TargetLocation);
+		break;
+	}
+}
+
+bool UPathfindingSubsystem::TryFinishRequestWithoutSearch(const FNavigationGraphPtr& NavGraph, FPathRequest& Request)
+{
+	TArray<FVector> Path = PathPool.Acquire();
+	bool bFinished = false;
+	if (Request.Type == EPathRequestType::Away)
+	{
+		const FEscapeField* EscapeField = GetEscapeField(NavGraph, FindNearestNode(*NavGraph, Request.TargetLocation));
+		bFinished = EscapeField && EscapeField->Field->GetPath(Request.StartIndex, Path);
+	}
+	if (!bFinished)
+	{
+		bFinished = FindDungeonGridPath(*NavGraph, Request.StartIndex, Request.EndIndex, Path);
+	}
+	if (!bFinished)
+	{
+		if (const TArray<FVector>* CachedPath = PathCache.Find(Request.GraphVersion, Request.StartIndex, Request.EndIndex))
+		{
+			Path.Append(*CachedPath);
+			bFinished = true;
+		}
+	}
+
+	if (!bFinished)
+	{
+		PathPool.Release(MoveTemp(Path));
+		return false;
+	}
+	TPair<FPathRequest, TArray<FVector>>& Result = FinishedRequests.AddDefaulted_GetRef();
+	Result.Key = MoveTemp(Request);
+	Result.Value = MoveTemp(Path);
+	return true;
+}
+
+void UPathfindingSubsystem::CompleteRequest(const FPathRequest& Request, const TArray<FVector>& Path)
+{
+	CompletedRequests++;
+	TotalLatencyFrames += GFrameCounter - Request.RequestFrame;
+	Request.OnComplete.ExecuteIfBound(Path);
+}
+
+void UPathfindingSubsystem::CompleteFinishedRequests()
+{
+	// Nothing that a callback can call adds to FinishedRequests, so it is safe to iterate.
+	for (TPair<FPathRequest, TArray<FVector>>& Result : FinishedRequests)
+	{
+		CompleteRequest(Result.Key, Result.Value);
+		PathPool.Release(MoveTemp(Result.Value));
+	}
+	FinishedRequests.Reset();
+}
+
+UPathfindingSubsystem::FPathRequestStats UPathfindingSubsystem::GetPathRequestStats() const
+{
+	FPathRequestStats Stats;
+	Stats.QueuedRequests = QueuedRequests.Num();
+	Stats.ActiveRequests = ActiveSearches.Num() + InFlightRequests.Num();
+	Stats.ExpansionsLastFrame = ExpansionsLastFrame;
+	Stats.CompletedRequests = CompletedRequests;
+	Stats.AverageLatencyFrames = CompletedRequests > 0 ? static_cast<double>(TotalLatencyFrames) / CompletedRequests : 0.0;
+	Stats.PathCacheHits = PathCache.GetNumHits();
+	Stats.PathCacheMisses = PathCache.GetNumMisses();
+	return Stats;
+}
+
+void UPathfindingSubsystem::MarkGraphDirty()
+{
+	bGraphDirty = true;
+	GraphVersion++;
+	bTrackedPathsStale = true;
+	// The rebuild picks up every blocked flag from the node data.
+	PendingCostNodes.Reset();
+}
+
+uint32 UPathfindingSubsystem::TrackPath(const FVector& StartLocation, const FVector& TargetLocation, FOnPathRequestComplete OnPathRepaired)
+{
+	const uint32 TrackedPathId = NextTrackedPathId++;
+	TrackedPaths.Add(TrackedPathId, { StartLocation, TargetLocation, MoveTemp(OnPathRepaired), nullptr });
+	return TrackedPathId;
+}
+
+void UPathfindingSubsystem::UpdateTrackedPathStart(uint32 TrackedPathId, const FVector& StartLocation)
+{
+	if (FTrackedPath* TrackedPath = TrackedPaths.Find(TrackedPathId))
+	{
+		TrackedPath->StartLocation = StartLocation;
+	}
+}
+
+void UPathfindingSubsystem::StopTrackingPath(uint32 TrackedPathId)
+{
+	TrackedPaths.Remove(TrackedPathId);
+}
+
+bool UPathfindingSubsystem::GetFlowFieldWaypoint(const AActor* Target, const FVector& Location, FVector& OutWaypoint)
+{
+	const FNavigationFlowFieldPtr FlowField = GetFlowField(Target);
+	if (!FlowField.IsValid())
+	{
+		return false;
+	}
+
+	const FNavigationGraph& NavGraph = *FlowField->GetGraph();
+	const int32 Index = NavGraph.FindNearestNode(Location);
+	if (Index == FlowField->GetTargetIndex())
+	{
+		OutWaypoint = Target->GetActorLocation();
+		return true;
+	}
+
+	const int32 NextIndex = FlowField->GetNextNode(Index);
+	if (NextIndex == INDEX_NONE)
+	{
+		return false;
+	}
+	OutWaypoint = NavGraph.Positions[NextIndex];
+	return true;
+}
+
+FNavigationFlowFieldPtr UPathfindingSubsystem::GetFlowField(const AActor* Target)
+{
+	if (!Target)
+	{
+		return nullptr;
+	}
+
+	FFlowFieldEntry& Entry = FlowFields.FindOrAdd(Target);
+	Entry.LastUsedFrame = GFrameCounter;
+	if (!Entry.Current.IsValid())
+	{
+		// Nothing to read from yet, so build the first one straight away rather than making the agents wait a frame.
+		const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+		const TSharedRef<FNavigationFlowField, ESPMode::ThreadSafe> FlowField = MakeShared<FNavigationFlowField, ESPMode::ThreadSafe>();
+		FlowField->Build(NavGraph, FindNearestNode(*NavGraph, Target->GetActorLocation()));
+		if (FlowField->IsBuilt())
+		{
+			Entry.Current = FlowField;
+		}
+	}
+	return Entry.Current;
+}
+
+void UPathfindingSubsystem::UpdateFlowFields()
+{
+	AGP_PATHFINDING_SCOPE(UpdateFlowFields);
+	if (FlowFields.IsEmpty())
+	{
+		return;
+	}
+
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+	for (auto It = FlowFields.CreateIterator(); It; ++It)
+	{
+		const AActor* Target = It.Key().Get();
+		FFlowFieldEntry& Entry = It.Value();
+		if (Entry.Pending.IsValid())
+		{
+			if (!Entry.Pending.IsCompleted()) continue;
+			if (Entry.Pending.GetResult().IsValid())
+			{
+				Entry.Current = Entry.Pending.GetResult();
+			}
+			Entry.Pending = UE::Tasks::TTask<FNavigationFlowFieldPtr>();
+		}
+
+		// The task only holds its own copy of the snapshot, so a field being built when its target goes away can just be
+		// left to finish on its own.
+		if (!Target || GFrameCounter - Entry.LastUsedFrame > FlowFieldIdleFrames)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		const int32 TargetIndex = FindNearestNode(*NavGraph, Target->GetActorLocation());
+		if (TargetIndex == INDEX_NONE) continue;
+		if (Entry.Current.IsValid() && Entry.Current->GetGraph() == NavGraph && Entry.Current->GetTargetIndex() == TargetIndex)
+		{
+			continue;
+		}
+
+		// Agents keep following the old field until the new one is ready.
+		Entry.Pending = UE::Tasks::Launch(UE_SOURCE_LOCATION, [NavGraph, TargetIndex]()
+		{
+			const TSharedRef<FNavigationFlowField, ESPMode::ThreadSafe> FlowField = MakeShared<FNavigationFlowField, ESPMode::ThreadSafe>();
+			FlowField->Build(NavGraph, TargetIndex);
+			return FlowField->IsBuilt() ? FNavigationFlowFieldPtr(FlowField) : FNavigationFlowFieldPtr();
+		});
+	}
+}
+
+bool UPathfindingSubsystem::StartPatrol(const FVector& Location, FNavigationPatrolRoute& OutRoute, FVector& OutWaypoint)
+{
+	OutRoute = FNavigationPatrolRoute();
+	if (!CVarPathfindingPatrolCircuits.GetValueOnGameThread()) return false;
+
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+	UpdatePatrolCircuits(*NavGraph);
+	if (!PatrolCircuits.IsBuilt()) return false;
+
+	const int32 NodeIndex = FindNearestNode(*NavGraph, Location);
+	const int32 Variant = NextPatrolVariant;
+	NextPatrolVariant = (NextPatrolVariant + 1) % PatrolCircuits.GetNumVariants();
+	if (!PatrolCircuits.FindStep(Variant, NodeIndex, OutRoute.Circuit, OutRoute.Step))
+	{
+		OutRoute = FNavigationPatrolRoute();
+		return false;
+	}
+	OutRoute.CircuitsVersion = PatrolCircuitsVersion;
+	OutWaypoint = NavGraph->Positions[NodeIndex];
+	return true;
+}
+
+bool UPathfindingSubsystem::AdvancePatrol(FNavigationPatrolRoute& Route, FVector& OutWaypoint)
+{
+	if (!Route.IsValid() || !CVarPathfindingPatrolCircuits.GetValueOnGameThread())
+	{
+		Route = FNavigationPatrolRoute();
+		return false;
+	}
+
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+	UpdatePatrolCircuits(*NavGraph);
+	if (Route.CircuitsVersion != PatrolCircuitsVersion)
+	{
+		Route = FNavigationPatrolRoute();
+		return false;
+	}
+
+	// The circuits are only rebuilt when the topology changes, so a connection on them may have been blocked since.
+	const int32 NextStep = (Route.Step + 1) % PatrolCircuits.GetCircuitLength(Route.Circuit);
+	const int32 NextIndex = PatrolCircuits.GetNode(Route.Circuit, NextStep);
+	const int32 Edge = NavGraph->FindEdge(PatrolCircuits.GetNode(Route.Circuit, Route.Step), NextIndex);
+	if (Edge == INDEX_NONE || NavGraph->IsEdgeBlocked(Edge))
+	{
+		Route = FNavigationPatrolRoute();
+		return false;
+	}
+	Route.Step = NextStep;
+	OutWaypoint = NavGraph->Positions[NextIndex];
+	return true;
+}
+
+void UPathfindingSubsystem::UpdatePatrolCircuits(const FNavigationGraph& NavGraph)
+{
+	const int32 NumVariants = FMath::Max(1, CVarPathfindingPatrolCircuitVariants.GetValueOnGameThread());
+	if (PatrolCircuitsVersion != 0 && PatrolCircuitsTopologyVersion == NavGraph.TopologyVersion
+		&& PatrolCircuits.GetNumVariants() == NumVariants)
+	{
+		return;
+	}
+
+	AGP_PATHFINDING_SCOPE(BuildPatrolCircuits);
+	const double BuildStartTime = FPlatformTime::Seconds();
+	PatrolCircuits.Build(NavGraph, NumVariants, NavGraph.TopologyVersion);
+	PatrolCircuitsTopologyVersion = NavGraph.TopologyVersion;
+	PatrolCircuitsVersion++;
+	NextPatrolVariant = 0;
+	if (PatrolCircuits.IsBuilt())
+	{
+		UE_LOG(LogTemp, Log, TEXT("Built %d patrol circuits for %d nodes in %.2f ms using %.1f KB"), PatrolCircuits.GetNumCircuits(),
+			NavGraph.Num(), (FPlatformTime::Seconds() - BuildStartTime) * 1000.0, PatrolCircuits.GetAllocatedSize() / 1024.0)
+	}
+}
+
+void UPathfindingSubsystem::SetNodeBlocked(ANavigationNode* Node, bool bBlocked)
+{
+	if (!Node) return;
+
+	Node->bBlocked = bBlocked;
+	if (!bGeneratedNodes && Nodes.IsValidIndex(Node->NodeIndex) && Nodes[Node->NodeIndex] == Node)
+	{
+		SetNodeBlocked(Node->NodeIndex, bBlocked);
+	}
+}
+
+void UPathfindingSubsystem::SetConnectionBlocked(ANavigationNode* NodeA, ANavigationNode* NodeB, bool bBlocked)
+{
+	if (!NodeA || !NodeB) return;
+
+	if (bBlocked)
+	{
+		NodeA->BlockedConnections.AddUnique(NodeB);
+	}
+	else
+	{
+		NodeA->BlockedConnections.Remove(NodeB);
+		NodeB->BlockedConnections.Remove(NodeA);
+	}
+	if (!bGeneratedNodes && Nodes.IsValidIndex(NodeA->NodeIndex) && Nodes[NodeA->NodeIndex] == NodeA
+		&& Nodes.IsValidIndex(NodeB->NodeIndex) && Nodes[NodeB->NodeIndex] == NodeB)
+	{
+		SetConnectionBlocked(NodeA->NodeIndex, NodeB->NodeIndex, bBlocked);
+	}
+}
+
+void UPathfindingSubsystem::SetNodeBlocked(int32 NodeIndex, bool bBlocked)
+{
+	if (!NodeData.IsValidIndex(NodeIndex)) return;
 
-	TArray<AActor*> HidingSpots;
-	for(TActorIterator<AActor> It(GetWorld()); It; ++It)
+	// Hand placed nodes are gathered again on the next rebuild, so the actor has to agree.
+	if (!bGeneratedNodes && Nodes.IsValidIndex(NodeIndex) && Nodes[NodeIndex])
 	{
-		AActor* CheckActor = *It;
+		Nodes[NodeIndex]->bBlocked = bBlocked;
+	}
+	if (NodeData[NodeIndex].bBlocked == bBlocked) return;
 
-		//check if actor has hideableobject tag
-		if(CheckActor->ActorHasTag("HideableObject"))
+	NodeData[NodeIndex].bBlocked = bBlocked;
+	UpdateEdgeCosts({ NodeIndex });
+}
+
+void UPathfindingSubsystem::SetConnectionBlocked(int32 NodeIndexA, int32 NodeIndexB, bool bBlocked)
+{
+	if (!NodeData.IsValidIndex(NodeIndexA) || !NodeData.IsValidIndex(NodeIndexB)) return;
+
+	if (!bGeneratedNodes && Nodes.IsValidIndex(NodeIndexA) && Nodes[NodeIndexA] && Nodes.IsValidIndex(NodeIndexB) && Nodes[NodeIndexB])
+	{
+		if (bBlocked)
 		{
-			HidingSpots.Add(CheckActor);
-			UE_LOG(LogTemp, Error, TEXT("hiding spots: %d"), HidingSpots.Num());
+			Nodes[NodeIndexA]->BlockedConnections.AddUnique(Nodes[NodeIndexB]);
+		}
+		else
+		{
+			Nodes[NodeIndexA]->BlockedConnections.Remove(Nodes[NodeIndexB]);
+			Nodes[NodeIndexB]->BlockedConnections.Remove(Nodes[NodeIndexA]);
 		}
 	}
 
-	AddHidingSpotNode(HidingSpots);
+	if (bBlocked)
+	{
+		NodeData[NodeIndexA].BlockedConnections.AddUnique(NodeIndexB);
+	}
+	else
+	{
+		NodeData[NodeIndexA].BlockedConnections.Remove(NodeIndexB);
+		NodeData[NodeIndexB].BlockedConnections.Remove(NodeIndexA);
+	}
+	UpdateEdgeCosts({ NodeIndexA, NodeIndexB });
 }
 
-TArray<FVector> UPathfindingSubsystem::GetWaypointPositions() const
+int32 UPathfindingSubsystem::FindNearestNodeIndex(const FVector& Location)
 {
-	TArray<FVector> NodePositions;
-	for (ANavigationNode* Node : Nodes)
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+	return FindNearestNode(*NavGraph, Location);
+}
+
+bool UPathfindingSubsystem::IsConnectionBlocked(int32 FromIndex, int32 ToIndex) const
+{
+	const FNavigationNodeData& FromNode = NodeData[FromIndex];
+	const FNavigationNodeData& ToNode = NodeData[ToIndex];
+	return FromNode.bBlocked || ToNode.bBlocked || FromNode.BlockedConnections.Contains(ToIndex)
+		|| ToNode.BlockedConnections.Contains(FromIndex);
+}
+
+void UPathfindingSubsystem::UpdateEdgeCosts(TConstArrayView<int32> ChangedNodes)
+{
+	PendingCostNodes.Append(ChangedNodes.GetData(), ChangedNodes.Num());
+}
+
+void UPathfindingSubsystem::ApplyPendingEdgeCosts()
+{
+	// A rebuild is already due and will pick the blocked flags up from the node data.
+	if (PendingCostNodes.IsEmpty() || bGraphDirty || !Graph)
 	{
-		if (Node)
+		PendingCostNodes.Reset();
+		return;
+	}
+	PendingCostNodes.Sort();
+	PendingCostNodes.SetNum(Algo::Unique(PendingCostNodes));
+
+	const FNavigationGraph& NavGraph = *Graph;
+	TArray<TPair<int32, float>> CostChanges;
+	auto UpdateEdge = [this, &NavGraph, &CostChanges](int32 FromIndex, int32 ToIndex, int32 Edge)
+	{
+		const float Cost = IsConnectionBlocked(FromIndex, ToIndex)
+			? FNavigationGraph::BlockedCost : FVector::Distance(NavGraph.Positions[FromIndex], NavGraph.Positions[ToIndex]);
+		if (Cost != NavGraph.EdgeCosts[Edge])
 		{
-			NodePositions.Add(Node->GetActorLocation());
+			CostChanges.Emplace(Edge, Cost);
+		}
+	};
+
+	for (const int32 Index : PendingCostNodes)
+	{
+		if (!NavGraph.IsValidNode(Index)) continue;
+
+		for (int32 Edge = NavGraph.GetNeighbourBegin(Index); Edge < NavGraph.GetNeighbourEnd(Index); Edge++)
+		{
+			UpdateEdge(Index, NavGraph.Neighbours[Edge], Edge);
+		}
+		for (int32 i = NavGraph.ReverseOffsets[Index]; i < NavGraph.ReverseOffsets[Index + 1]; i++)
+		{
+			UpdateEdge(NavGraph.ReverseNeighbours[i], Index, NavGraph.ReverseEdges[i]);
 		}
 	}
-	return NodePositions;
+	PendingCostNodes.Reset();
+	if (CostChanges.IsEmpty()) return;
+
+	// Changed nodes that are neighbours both list the edge between them, so the same edge can appear twice.
+	CostChanges.Sort([](const TPair<int32, float>& A, const TPair<int32, float>& B) { return A.Key < B.Key; });
+	CostChanges.SetNum(Algo::Unique(CostChanges, [](const TPair<int32, float>& A, const TPair<int32, float>& B) { return A.Key == B.Key; }));
+
+	// The new snapshot gets a new version so the path cache drops the paths that may have gone through the edges.
+	GraphVersion++;
+	Graph = FNavigationGraph::WithEdgeCosts(NavGraph, CostChanges, GraphVersion);
+	GraphVersions.Publish(Graph);
+	for (const TPair<int32, float>& Change : CostChanges)
+	{
+		PendingEdgeChanges.Add(Change.Key);
+	}
 }
 
-TArray<FVector> UPathfindingSubsystem::GetRandomPath(const FVector& StartLocation)
+void UPathfindingSubsystem::RepairTrackedPaths()
+{
+	AGP_PATHFINDING_SCOPE(RepairTrackedPaths);
+	if (TrackedPaths.IsEmpty() || (PendingEdgeChanges.IsEmpty() && !bTrackedPathsStale))
+	{
+		PendingEdgeChanges.Reset();
+		bTrackedPathsStale = false;
+		return;
+	}
+
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+	PendingEdgeChanges.Sort();
+	PendingEdgeChanges.SetNum(Algo::Unique(PendingEdgeChanges));
+
+	// The callbacks may start or stop tracking paths, so gather the results first and run them once the map is no
+	// longer being iterated.
+	TArray<TPair<uint32, TArray<FVector>>, TInlineAllocator<16>> RepairedPaths;
+	RepairedPaths.Reserve(TrackedPaths.Num());
+	for (TPair<uint32, FTrackedPath>& Pair : TrackedPaths)
+	{
+		FTrackedPath& TrackedPath = Pair.Value;
+		const int32 StartIndex = FindNearestNode(*NavGraph, TrackedPath.StartLocation);
+		if (!TrackedPath.Search.IsValid() || !TrackedPath.Search->GetGraph().IsValid()
+			|| TrackedPath.Search->GetGraph()->TopologyVersion != NavGraph->TopologyVersion)
+		{
+			if (!TrackedPath.Search.IsValid())
+			{
+				TrackedPath.Search = MakeUnique<FNavigationIncrementalSearch>();
+			}
+			TrackedPath.Search->Start(NavGraph, StartIndex, FindNearestNode(*NavGraph, TrackedPath.TargetLocation));
+		}
+		else
+		{
+			TrackedPath.Search->MoveStart(StartIndex);
+			TrackedPath.Search->ApplyEdgeChanges(NavGraph, PendingEdgeChanges);
+		}
+
+		TArray<FVector>& Path = RepairedPaths.Emplace_GetRef(Pair.Key, PathPool.Acquire()).Value;
+		TrackedPath.Search->GetPath(Path);
+	}
+	PendingEdgeChanges.Reset();
+	bTrackedPathsStale = false;
+
+	for (TPair<uint32, TArray<FVector>>& Repaired : RepairedPaths)
+	{
+		if (const FTrackedPath* TrackedPath = TrackedPaths.Find(Repaired.Key))
+		{
+			TrackedPath->OnPathRepaired.ExecuteIfBound(Repaired.Value);
+		}
+		PathPool.Release(MoveTemp(Repaired.Value));
+	}
+}
+
+FNavigationGraphPtr UPathfindingSubsystem::GetGraphSnapshot()
 {
-	return GetPath(FindNearestNode(StartLocation), GetRandomNode());
+	if (bGraphDirty || !Graph)
+	{
+		RebuildGraph();
+	}
+	return Graph;
 }
 
-TArray<FVector> UPathfindingSubsystem::GetPath(const FVector& StartLocation, const FVector& TargetLocation)
+FNavigationGraphPtr UPathfindingSubsystem::PinGraph() const
 {
-	return GetPath(FindNearestNode(StartLocation), FindNearestNode(TargetLocation));
+	return GraphVersions.Pin();
 }
 
-TArray<FVector> UPathfindingSubsystem::GetPathAway(const FVector& StartLocation, const FVector& TargetLocation)
+bool UPathfindingSubsystem::GetPathOnAnyThread(const FVector& StartLocation, const FVector& TargetLocation, TArray<FVector>& OutPath) const
 {
-	return GetPath(FindNearestNode(StartLocation), FindFurthestNode(TargetLocation));
+	AGP_PATHFINDING_QUERY_SCOPE(GetPath);
+	OutPath.Reset();
+	const FNavigationGraphPtr NavGraph = PinGraph();
+	if (!NavGraph || NavGraph->Num() == 0) return false;
+
+	// Each thread keeps its own scratch so searches never share working memory.
+	static thread_local FNavigationSearchScratch AnyThreadScratch;
+	const bool bFound = FNavigationSearch::FindPath(*NavGraph, NavGraph->FindNearestNode(StartLocation),
+		NavGraph->FindNearestNode(TargetLocation), AnyThreadScratch, OutPath);
+	PathfindingQueryScope.SetSearchCounters(AnyThreadScratch.NumExpanded, AnyThreadScratch.PeakOpenSetSize, OutPath.Num());
+	INC_DWORD_STAT(STAT_AGPPathfinding_NumPathQueries);
+	INC_DWORD_STAT_BY(STAT_AGPPathfinding_NodesExpanded, AnyThreadScratch.NumExpanded);
+	return bFound;
 }
 
 void UPathfindingSubsystem::PlaceProceduralNodes(const TArray<FVector>& LandscapeVertexData, int32 MapWidth, int32 MapHeight)
 {
+	AGP_PATHFINDING_QUERY_SCOPE(PlaceProceduralNodes);
 	// Clear existing nodes
 	RemoveAllNodes();
+	DungeonRoomSize = 0.0f;
+	DungeonGrid.Reset();
 
-	// Place nodes if they are above solid ground
-	for (const FVector& Location : LandscapeVertexData)
+	// Place nodes if they are above solid ground. All of the traces are made first so they can run together, then the
+	// nodes that passed are added in one go.
+	const double StartTime = FPlatformTime::Seconds();
+	TArray<bool> AboveGround;
+	ProbeGround(LandscapeVertexData, AboveGround);
+	const double ProbeSeconds = FPlatformTime::Seconds() - StartTime;
+
+	bGeneratedNodes = true;
+	NodeData.Reserve(LandscapeVertexData.Num());
+	for (int32 i = 0; i < LandscapeVertexData.Num(); i++)
 	{
-		if (IsLocationAboveSolidGround(Location)) // Use the existing function to verify solid ground
+		if (AboveGround[i])
 		{
-			if (ANavigationNode* Node = GetWorld()->SpawnActor<ANavigationNode>())
-			{
-				Node->SetActorLocation(Location);
-				ProcedurallyPlacedNodes.Add(Node);
-			}
+			NodeData.AddDefaulted_GetRef().Location = LandscapeVertexData[i];
 		}
 	}
+
+	MarkGraphDirty();
+	UE_LOG(LogTemp, Log, TEXT("Placed %d of %d procedural nodes, probing the ground took %.2f ms (%s)"), NodeData.Num(),
+		LandscapeVertexData.Num(), ProbeSeconds * 1000.0, CVarPathfindingParallelGroundProbes.GetValueOnGameThread() ? TEXT("parallel") : TEXT("serial"))
 }
 
 void UPathfindingSubsystem::PopulateNodes()
 {
 	Nodes.Empty();
+	bGeneratedNodes = false;
 
 	for (TActorIterator<ANavigationNode> It(GetWorld()); It; ++It)
 	{
 		Nodes.Add(*It);
 		//UE_LOG(LogTemp, Warning, TEXT("NODE: %s"), *(*It)->GetActorLocation().ToString())
 	}
+
+	RebuildNodeIndices();
+	MarkGraphDirty();
 }
 
-void UPathfindingSubsystem::RemoveAllNodes()
+void UPathfindingSubsystem::RebuildNodeIndices()
 {
-	Nodes.Empty();
-	ProcedurallyPlacedNodes.Empty();
-
-	for (TActorIterator<ANavigationNode> It(GetWorld()); It; ++It)
+	for (int32 i = 0; i < Nodes.Num(); i++)
 	{
-		GetWorld()->DestroyActor(*It);
+		Nodes[i]->NodeIndex = i;
 	}
 }
 
-ANavigationNode* UPathfindingSubsystem::GetRandomNode()
+void UPathfindingSubsystem::GatherNodeData()
 {
-	// Failure condition
-	if (Nodes.Num() == 0)
+	// Drop any nodes that have been destroyed since the Nodes array was last populated.
+	Nodes.RemoveAll([](const ANavigationNode* Node) { return !IsValid(Node); });
+	RebuildNodeIndices();
+
+	// Only keep connections to nodes that are registered with this subsystem.
+	auto IsRegistered = [this](const ANavigationNode* Node)
 	{
-		UE_LOG(LogTemp, Error, TEXT("The nodes array is empty."))
-		return nullptr;
+		return Node && Nodes.IsValidIndex(Node->NodeIndex) && Nodes[Node->NodeIndex] == Node;
+	};
+
+	NodeData.Reset();
+	NodeData.SetNum(Nodes.Num());
+	for (int32 i = 0; i < Nodes.Num(); i++)
+	{
+		const ANavigationNode* Node = Nodes[i];
+		FNavigationNodeData& Data = NodeData[i];
+		Data.Location = Node->GetActorLocation();
+		Data.Kind = Node->NodeKind;
+		Data.bBlocked = Node->bBlocked;
+		for (const ANavigationNode* ConnectedNode : Node->ConnectedNodes)
+		{
+			if (IsRegistered(ConnectedNode))
+			{
+				Data.ConnectedNodes.Add(ConnectedNode->NodeIndex);
+			}
+		}
+		for (const ANavigationNode* BlockedNode : Node->BlockedConnections)
+		{
+			if (IsRegistered(BlockedNode))
+			{
+				Data.BlockedConnections.Add(BlockedNode->NodeIndex);
+			}
+		}
 	}
-	const int32 RandIndex = FMath::RandRange(0, Nodes.Num()-1);
-	return Nodes[RandIndex];
 }
 
-ANavigationNode* UPathfindingSubsystem::FindNearestNode(const FVector& TargetLocation)
+void UPathfindingSubsystem::RebuildGraph()
 {
-	// Failure condition.
-	if (Nodes.Num() == 0)
+	AGP_PATHFINDING_QUERY_SCOPE(RebuildGraph);
+	if (!bGeneratedNodes)
 	{
-		UE_LOG(LogTemp, Error, TEXT("The nodes array is empty."))
-		return nullptr;
+		GatherNodeData();
 	}
 
-	// Using the minimum programming pattern to find the closest node.
-	// What is the Big O complexity of this? Can you do it more efficiently?
-	ANavigationNode* ClosestNode = nullptr;
-	float MinDistance = UE_MAX_FLT;
-	for (ANavigationNode* Node : Nodes)
+	TArray<FVector> Positions;
+	TArray<TArray<int32>> Adjacency;
+	Positions.Reserve(NodeData.Num());
+	Adjacency.Reserve(NodeData.Num());
+	for (const FNavigationNodeData& Node : NodeData)
+	{
+		Positions.Add(Node.Location);
+		Adjacency.Add(Node.ConnectedNodes);
+	}
+
+	const FNavigationGraphBuildSettings Settings = GetBuildSettings(NodeData.Num(), DungeonRoomSize);
+	const double BuildStartTime = FPlatformTime::Seconds();
+	// Only the first graph with any nodes can come from the bake, every later rebuild is for an edit.
+	FNavigationGraphPtr BakedGraph;
+	if (bLoadBakedGraph && !NodeData.IsEmpty())
+	{
+		bLoadBakedGraph = false;
+		BakedGraph = LoadBakedGraph(Settings);
+	}
+
+	if (BakedGraph)
 	{
-		const float Distance = FVector::Distance(TargetLocation, Node->GetActorLocation());
-		if (Distance < MinDistance)
+		Graph = MoveTemp(BakedGraph);
+		UE_LOG(LogTemp, Log, TEXT("Loaded the baked navigation graph for %d nodes in %.2f ms"), Graph->Num(),
+			(FPlatformTime::Seconds() - BuildStartTime) * 1000.0)
+	}
+	else
+	{
+		Graph = FNavigationGraph::Build(Positions, Adjacency, GraphVersion, Settings, [this](int32 FromIndex, int32 ToIndex)
+		{
+			return IsConnectionBlocked(FromIndex, ToIndex);
+		});
+
+		if (Graph->RoutingTable.IsBuilt())
 		{
-			MinDistance = Distance;
-			ClosestNode = Node;
+			UE_LOG(LogTemp, Log, TEXT("Built navigation routing table for %d nodes in %.2f ms using %.1f KB"), Graph->Num(),
+				(FPlatformTime::Seconds() - BuildStartTime) * 1000.0, Graph->RoutingTable.GetAllocatedSize() / 1024.0)
+		}
+		else if (Graph->Hierarchy.IsBuilt())
+		{
+			UE_LOG(LogTemp, Log, TEXT("Built navigation hierarchy with %d clusters and %d entrances for %d nodes in %.2f ms using %.1f KB"),
+				Graph->Hierarchy.NumClusters(), Graph->Hierarchy.NumEntrances(), Graph->Num(),
+				(FPlatformTime::Seconds() - BuildStartTime) * 1000.0, Graph->Hierarchy.GetAllocatedSize() / 1024.0)
+		}
+		if (Graph->Landmarks.IsBuilt())
+		{
+			UE_LOG(LogTemp, Log, TEXT("Built %d navigation landmarks for %d nodes using %.1f KB"), Graph->Landmarks.GetNumLandmarks(),
+				Graph->Num(), Graph->Landmarks.GetAllocatedSize() / 1024.0)
 		}
 	}
+	bGraphDirty = false;
+	GraphVersions.Publish(Graph);
 
-	return ClosestNode;
+	// Build the patrol circuits alongside the graph rather than on the first patrolling agent's frame.
+	if (CVarPathfindingPatrolCircuits.GetValueOnGameThread())
+	{
+		UpdatePatrolCircuits(*Graph);
+	}
 }
 
-ANavigationNode* UPathfindingSubsystem::FindFurthestNode(const FVector& TargetLocation)
+FNavigationGraphBuildSettings UPathfindingSubsystem::GetBuildSettings(int32 NumNodes, float RoomSize) const
 {
-	// Failure condition.
-	if (Nodes.Num() == 0)
+	FNavigationGraphBuildSettings Settings;
+	Settings.RoutingTableMaxNodes = CVarPathfindingRoutingTableMaxNodes.GetValueOnGameThread();
+	Settings.NumLandmarks = CVarPathfindingLandmarks.GetValueOnGameThread();
+	if (NumNodes >= CVarPathfindingHierarchyMinNodes.GetValueOnGameThread())
 	{
-		UE_LOG(LogTemp, Error, TEXT("The nodes array is empty."))
-		return nullptr;
+		Settings.HierarchyClusterSize = RoomSize * CVarPathfindingHierarchyClusterRooms.GetValueOnGameThread();
 	}
+	return Settings;
+}
 
-	// Using the minimum programming pattern to find the closest node.
-	// What is the Big O complexity of this? Can you do it more efficiently?
-	ANavigationNode* FurthestNode = nullptr;
-	float MaxDistance = -1.0f;
-	for (ANavigationNode* Node : Nodes)
+FString UPathfindingSubsystem::GetBakedGraphPath(const UWorld& World)
+{
+	// Play in editor worlds are named after their level with a prefix, which would otherwise give them their own bake.
+	const FString LevelName = FPackageName::GetShortName(UWorld::RemovePIEPrefix(World.GetOutermost()->GetName()));
+	return FPaths::ProjectContentDir() / TEXT("NavigationGraphs") / LevelName + TEXT(".navgraph");
+}
+
+bool UPathfindingSubsystem::SaveBakedGraph()
+{
+	// Getting the snapshot also brings NodeData up to date with the node actors.
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	uint32 Magic = BakedGraphMagic;
+	uint32 FileVersion = BakedGraphFileVersion;
+	FSHAHash NodeDataHash = HashNodeData();
+	Writer << Magic << FileVersion << NodeDataHash;
+	NavGraph->Save(Writer);
+
+	const FString Path = GetBakedGraphPath(*GetWorld());
+	if (!FFileHelper::SaveArrayToFile(Bytes, *Path))
 	{
-		const float Distance = FVector::Distance(TargetLocation, Node->GetActorLocation());
-		if (Distance > MaxDistance)
-		{
-			MaxDistance = Distance;
-			FurthestNode = Node;
-		}
+		UE_LOG(LogTemp, Error, TEXT("Unable to write the baked navigation graph to %s."), *Path)
+		return false;
 	}
-
-	return FurthestNode;
+	UE_LOG(LogTemp, Display, TEXT("Baked the navigation graph with %d nodes to %s (%.1f KB)."), NavGraph->Num(), *Path,
+		Bytes.Num() / 1024.0)
+	return true;
 }
 
-TArray<FVector> UPathfindingSubsystem::GetPath(ANavigationNode* StartNode, ANavigationNode* EndNode)
+FNavigationGraphPtr UPathfindingSubsystem::LoadBakedGraph(const FNavigationGraphBuildSettings& Settings) const
 {
-	if (!StartNode || !EndNode)
+	// The whole file is read in one go and everything is copied out of memory from there.
+	const FString Path = GetBakedGraphPath(*GetWorld());
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path, FILEREAD_Silent))
 	{
-		UE_LOG(LogTemp, Error, TEXT("Either the start or end node are nullptrs."))
-		return TArray<FVector>();
+		return nullptr;
 	}
 
-	// Setup the open set and add the start node.
-	TArray<ANavigationNode*> OpenSet;
-	OpenSet.Add(StartNode);
-
-	// StartNode->GScore = UE_MAX_FLT;
-	// StartNode->HScore = FVector::Distance(StartNode->GetActorLocation(), EndNode->GetActorLocation());
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0;
+	uint32 FileVersion = 0;
+	Reader << Magic << FileVersion;
+	if (Magic != BakedGraphMagic || FileVersion != BakedGraphFileVersion)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ignoring the baked navigation graph %s as it was baked by a different version. Save the level to bake it again."), *Path)
+		return nullptr;
+	}
 
-	// Setup the maps that will hold the GScores, HScores and CameFrom
-	TMap<ANavigationNode*, float> GScores, HScores;
-	TMap<ANavigationNode*, ANavigationNode*> CameFrom;
-	// You could pre-populate the GScores and HScores maps with all of the GScores (at infinity) and HScores here by looping over
-	// all the nodes in the Nodes array. However it is more efficient to only calculate these when you need them
-	// as some nodes might not be explored when finding a path.
+	// Node actors, or a generated dungeon, that have been edited since the bake would otherwise be silently replaced by
+	// the graph they used to make.
+	FSHAHash BakedNodeDataHash;
+	Reader << BakedNodeDataHash;
+	if (Reader.IsError() || BakedNodeDataHash != HashNodeData())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ignoring the baked navigation graph %s as the level's nodes have changed since it was baked. Save the level to bake it again."), *Path)
+		return nullptr;
+	}
 
-	// Setup the start nodes G and H score.
-	GScores.Add(StartNode, 0);
-	HScores.Add(StartNode, FVector::Distance(StartNode->GetActorLocation(), EndNode->GetActorLocation()));
-	CameFrom.Add(StartNode, nullptr);
+	const FNavigationGraphPtr LoadedGraph = FNavigationGraph::Load(Reader, GraphVersion, Settings);
+	if (!LoadedGraph || Reader.IsError() || LoadedGraph->Num() != NodeData.Num())
+	{
+		UE_LOG(LogTemp, Error, TEXT("The baked navigation graph %s is corrupt. Save the level to bake it again."), *Path)
+		return nullptr;
+	}
+	return LoadedGraph;
+}
 
-	while (!OpenSet.IsEmpty())
+FSHAHash UPathfindingSubsystem::HashNodeData() const
+{
+	// Everything that the snapshot is built from, in order, so that any edit to the nodes changes the hash.
+	FSHA1 Sha;
+	Sha.Update(reinterpret_cast<const uint8*>(&DungeonRoomSize), sizeof(DungeonRoomSize));
+	for (const FNavigationNodeData& Node : NodeData)
 	{
-		// Find the node in the open set with the lowest FScore.
-		ANavigationNode* CurrentNode = OpenSet[0]; // We know this exists because the OpenSet is not empty.
-		for (int32 i = 1; i < OpenSet.Num(); i++)
-		{
-			// We can be sure that all the nodes in the open set have already had their GScores and HScores calculated.
-			if (GScores[OpenSet[i]] + HScores[OpenSet[i]] < GScores[CurrentNode] + HScores[CurrentNode])
-			{
-				CurrentNode = OpenSet[i];
-			}
-		}
+		const uint8 Kind = static_cast<uint8>(Node.Kind);
+		const uint8 bBlocked = Node.bBlocked;
+		const int32 NumConnectedNodes = Node.ConnectedNodes.Num();
+		const int32 NumBlockedConnections = Node.BlockedConnections.Num();
+		Sha.Update(reinterpret_cast<const uint8*>(&Node.Location), sizeof(Node.Location));
+		Sha.Update(&Kind, sizeof(Kind));
+		Sha.Update(&bBlocked, sizeof(bBlocked));
+		Sha.Update(reinterpret_cast<const uint8*>(&NumConnectedNodes), sizeof(NumConnectedNodes));
+		Sha.Update(reinterpret_cast<const uint8*>(Node.ConnectedNodes.GetData()), NumConnectedNodes * sizeof(int32));
+		Sha.Update(reinterpret_cast<const uint8*>(&NumBlockedConnections), sizeof(NumBlockedConnections));
+		Sha.Update(reinterpret_cast<const uint8*>(Node.BlockedConnections.GetData()), NumBlockedConnections * sizeof(int32));
+	}
+	Sha.Final();
 
-		// Remove the current node from the OpenSet
-		OpenSet.Remove(CurrentNode);
+	FSHAHash Hash;
+	Sha.GetHash(Hash.Hash);
+	return Hash;
+}
 
-		if (CurrentNode == EndNode)
-		{
-			// Then we have found the path so reconstruct it and get the positions of each of the nodes in the path.
-			// UE_LOG(LogTemp, Display, TEXT("PATH FOUND"))
-			return ReconstructPath(CameFrom, EndNode);
-		}
+#if !UE_BUILD_SHIPPING
+void UPathfindingSubsystem::DrawGraph()
+{
+	ULineBatchComponent* LineBatcher = GetWorld() ? GetWorld()->LineBatcher.Get() : nullptr;
+	if (!LineBatcher || CVarPathfindingDrawGraph.GetValueOnGameThread() == 0)
+	{
+		return;
+	}
 
-		for (ANavigationNode* ConnectedNode : CurrentNode->ConnectedNodes)
+	const FNavigationGraphPtr NavGraph = GetGraphSnapshot();
+	if (DebugLinesVersion != NavGraph->Version || (DebugPoints.IsEmpty() && NavGraph->Num() > 0))
+	{
+		DebugLinesVersion = NavGraph->Version;
+		DebugLines.Reset(NavGraph->NumEdges());
+		DebugPoints.Reset(NavGraph->Num());
+		for (int32 i = 0; i < NavGraph->Num(); i++)
 		{
-			if (!ConnectedNode) continue; // Failsafe if the ConnectedNode is a nullptr.
-			const float TentativeGScore = GScores[CurrentNode] + FVector::Distance(CurrentNode->GetActorLocation(), ConnectedNode->GetActorLocation());
-			// Because we didn't setup all the scores and came from at the start, we need to check if the connected node has a gscore
-			// already otherwise set it. If it doesn't have a gscore then it won't have all the other things either so initialise them as well.
-			if (!GScores.Contains(ConnectedNode))
-			{
-				GScores.Add(ConnectedNode, UE_MAX_FLT);
-				HScores.Add(ConnectedNode, FVector::Distance(ConnectedNode->GetActorLocation(), EndNode->GetActorLocation()));
-				CameFrom.Add(ConnectedNode, nullptr);
-			}
+			// Nodes connected to themselves are drawn red as that is almost certainly a mistake.
+			const bool bSelfConnected = NavGraph->FindEdge(i, i) != INDEX_NONE;
+			DebugPoints.Emplace(NavGraph->Positions[i], bSelfConnected ? FColor::Red : FColor::Blue, 10.0f, 0.0f, SDPG_World);
 
-			// Then update this nodes scores and came from if the tentative g score is lower than the current g score.
-			if (TentativeGScore < GScores[ConnectedNode])
+			for (int32 Edge = NavGraph->GetNeighbourBegin(i); Edge < NavGraph->GetNeighbourEnd(i); Edge++)
 			{
-				CameFrom[ConnectedNode] = CurrentNode;
-				GScores[ConnectedNode] = TentativeGScore;
-				// HScore is already set when adding the node to the HScores map.
-				// Then add connected node to the open set if it isn't already in there.
-				if (!OpenSet.Contains(ConnectedNode))
+				const int32 ConnectedIndex = NavGraph->Neighbours[Edge];
+				const int32 ReverseEdge = NavGraph->FindEdge(ConnectedIndex, i);
+				// Two way connections only need drawing once.
+				if (ReverseEdge != INDEX_NONE && ConnectedIndex < i) continue;
+
+				FColor LineColor = ReverseEdge != INDEX_NONE ? FColor::Green : FColor::Red;
+				if (NavGraph->IsEdgeBlocked(Edge) || (ReverseEdge != INDEX_NONE && NavGraph->IsEdgeBlocked(ReverseEdge)))
 				{
-					OpenSet.Add(ConnectedNode);
+					LineColor = FColor::Orange;
 				}
+				DebugLines.Emplace(NavGraph->Positions[i], NavGraph->Positions[ConnectedIndex], LineColor, 0.0f, 5.0f, SDPG_World);
 			}
 		}
 	}
 
-	// If we get here, then no path has been found so return an empty array.
-	return TArray<FVector>();
-	
+	// The world's line batcher is cleared every frame so everything is handed over again, but in one go rather than a
+	// draw call per node.
+	LineBatcher->DrawLines(DebugLines);
+	LineBatcher->BatchedPoints.Append(DebugPoints);
+	LineBatcher->MarkRenderStateDirty();
+}
+#endif
+
+void UPathfindingSubsystem::RemoveAllNodes()
+{
+	Nodes.Empty();
+	NodeData.Empty();
+	bGeneratedNodes = false;
+	MarkGraphDirty();
+
+	for (TActorIterator<ANavigationNode> It(GetWorld()); It; ++It)
+	{
+		GetWorld()->DestroyActor(*It);
+	}
+}
+
+int32 UPathfindingSubsystem::GetRandomNode(const FNavigationGraph& NavGraph) const
+{
+	// Failure condition
+	if (NavGraph.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The nodes array is empty."))
+		return INDEX_NONE;
+	}
+	return FMath::RandRange(0, NavGraph.Num()-1);
+}
+
+int32 UPathfindingSubsystem::FindNearestNode(const FNavigationGraph& NavGraph, const FVector& TargetLocation) const
+{
+	AGP_PATHFINDING_QUERY_SCOPE(FindNearestNode);
+	// Failure condition.
+	if (NavGraph.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The nodes array is empty."))
+		return INDEX_NONE;
+	}
+
+	// The snapshot's k-d tree only looks at the handful of nodes near the target location.
+	return NavGraph.FindNearestNode(TargetLocation);
+}
+
+int32 UPathfindingSubsystem::FindFurthestNode(const FNavigationGraph& NavGraph, const FVector& TargetLocation) const
+{
+	AGP_PATHFINDING_QUERY_SCOPE(FindFurthestNode);
+	// Failure condition.
+	if (NavGraph.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The nodes array is empty."))
+		return INDEX_NONE;
+	}
+
+	// The k-d tree skips every part of the graph whose bounding box can't contain a node further than the best so far.
+	return NavGraph.FindFurthestNode(TargetLocation);
+}
+
+TArray<FVector> UPathfindingSubsystem::GetPath(const FNavigationGraph& NavGraph, int32 StartIndex, int32 EndIndex)
+{
+	TArray<FVector> Path;
+	GetPath(NavGraph, StartIndex, EndIndex, Path);
+	return Path;
 }
 
-TArray<FVector> UPathfindingSubsystem::ReconstructPath(const TMap<ANavigationNode*, ANavigationNode*>& CameFromMap, ANavigationNode* EndNode)
+bool UPathfindingSubsystem::GetPath(const FNavigationGraph& NavGraph, int32 StartIndex, int32 EndIndex, TArray<FVector>& OutPath)
 {
-	TArray<FVector> NodeLocations;
+	AGP_PATHFINDING_QUERY_SCOPE(GetPath);
+	INC_DWORD_STAT(STAT_AGPPathfinding_NumPathQueries);
+	OutPath.Reset();
+	if (!NavGraph.IsValidNode(StartIndex) || !NavGraph.IsValidNode(EndIndex))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Either the start or end node are invalid."))
+		return false;
+	}
+	if (FindDungeonGridPath(NavGraph, StartIndex, EndIndex, OutPath))
+	{
+		return true;
+	}
 
-	const ANavigationNode* NextNode = EndNode;
-	while(NextNode)
+	PathCache.SetCapacity(CVarPathfindingPathCacheSize.GetValueOnGameThread());
+	if (const TArray<FVector>* CachedPath = PathCache.Find(NavGraph.Version, StartIndex, EndIndex))
 	{
-		NodeLocations.Push(NextNode->GetActorLocation());
-		NextNode = CameFromMap[NextNode];
+		OutPath.Append(*CachedPath);
+		return !OutPath.IsEmpty();
 	}
 
-	return NodeLocations;
+	const bool bFoundPath = FNavigationSearch::FindPath(NavGraph, StartIndex, EndIndex, SearchScratch, OutPath);
+	PathfindingQueryScope.SetSearchCounters(SearchScratch.NumExpanded, SearchScratch.PeakOpenSetSize, OutPath.Num());
+	INC_DWORD_STAT_BY(STAT_AGPPathfinding_NodesExpanded, SearchScratch.NumExpanded);
+	PathCache.Add(NavGraph.Version, StartIndex, EndIndex, OutPath);
+	return bFoundPath;
 }
 
-void UPathfindingSubsystem::UpdatePathfindingNodes(const TArray<FVector>& RoomAndCorridorLocations, int32 MapWidth, int32 MapHeight, float RoomSize)
+bool UPathfindingSubsystem::FindDungeonGridPath(const FNavigationGraph& NavGraph, int32 StartIndex, int32 EndIndex, TArray<FVector>& OutPath) const
 {
+	// The grid knows nothing about blocked nodes or connections, so it is only used while there are none.
+	if (!bGeneratedNodes || DungeonGrid.IsEmpty() || NavGraph.NumBlockedEdges > 0 || !CVarPathfindingDungeonGridPaths.GetValueOnGameThread()
+		|| !NavGraph.IsValidNode(StartIndex) || !NavGraph.IsValidNode(EndIndex))
+	{
+		return false;
+	}
+
+	// Room nodes sit on the centres of their cells, so the walk starts and ends at the same nodes a search would.
+	const FIntPoint StartCell = DungeonGrid.WorldToCell(NavGraph.Positions[StartIndex]);
+	const FIntPoint EndCell = DungeonGrid.WorldToCell(NavGraph.Positions[EndIndex]);
+	if (GetNodeKind(StartIndex) != ENavigationNodeKind::Room || GetNodeKind(EndIndex) != ENavigationNodeKind::Room
+		|| !DungeonGrid.IsRoom(StartCell) || !DungeonGrid.IsRoom(EndCell))
+	{
+		return false;
+	}
+	return DungeonGrid.FindPath(StartCell, EndCell, OutPath);
+}
+
+void UPathfindingSubsystem::UpdatePathfindingNodes(const TArray<FVector>& NodeLocations, const TArray<ENavigationNodeKind>& NodeKinds,
+    int32 MapWidth, int32 MapHeight, float RoomSize)
+{
+    AGP_PATHFINDING_QUERY_SCOPE(UpdatePathfindingNodes);
+    check(NodeLocations.Num() == NodeKinds.Num());
+
     // Clear existing nodes
     RemoveAllNodes();
+    DungeonRoomSize = RoomSize;
 
-    // Place nodes at room and corridor locations
-    for (const FVector& Location : RoomAndCorridorLocations)
+    // The nodes are only data, no actors are spawned for them.
+    const double BuildStartTime = FPlatformTime::Seconds();
+    bGeneratedNodes = true;
+    NodeData.SetNum(NodeLocations.Num());
+    for (int32 i = 0; i < NodeLocations.Num(); i++)
     {
-        if (ANavigationNode* Node = GetWorld()->SpawnActor<ANavigationNode>())
-        {
-            Node->SetActorLocation(Location);
-            ProcedurallyPlacedNodes.Add(Node);
-        }
+        NodeData[i].Location = NodeLocations[i];
+        NodeData[i].Kind = NodeKinds[i];
     }
 
-    // Separate room and corridor nodes for more precise connection logic
-    TArray<ANavigationNode*> RoomNodes;
-    TArray<ANavigationNode*> CorridorNodes;
-
-    for (ANavigationNode* Node : ProcedurallyPlacedNodes)
+    TArray<TArray<int32>> Adjacency;
+    ConnectDungeonNodes(NodeLocations, NodeKinds, RoomSize, Adjacency);
+    int32 NumConnections = 0;
+    for (int32 i = 0; i < NodeData.Num(); i++)
     {
-        if (IsCorridorNode(Node))
-        {
-            CorridorNodes.Add(Node);
-        }
-        else
-        {
-            RoomNodes.Add(Node);
-        }
+        NumConnections += Adjacency[i].Num();
+        NodeData[i].ConnectedNodes = MoveTemp(Adjacency[i]);
     }
+    UE_LOG(LogTemp, Log, TEXT("Connected %d dungeon nodes with %d connections in %.2f ms"), NodeData.Num(), NumConnections,
+        (FPlatformTime::Seconds() - BuildStartTime) * 1000.0)
 
-    // Connect room nodes to each other
-    for (ANavigationNode* RoomNode : RoomNodes)
-    {
-        for (ANavigationNode* OtherRoomNode : RoomNodes)
-        {
-            if (RoomNode != OtherRoomNode && FVector::Dist(RoomNode->GetActorLocation(), OtherRoomNode->GetActorLocation()) <= RoomSize)
-            {
-                RoomNode->ConnectedNodes.Add(OtherRoomNode);
-            }
-        }
-    }
+    MarkGraphDirty();
+}
 
-    // Connect corridor nodes to room nodes and selectively to other corridor nodes
-    for (ANavigationNode* CorridorNode : CorridorNodes)
-    {
-        // Connect corridor nodes to nearby room nodes
-        for (ANavigationNode* RoomNode : RoomNodes)
-        {
-            if (FVector::Dist(CorridorNode->GetActorLocation(), RoomNode->GetActorLocation()) <= RoomSize)
-            {
-                CorridorNode->ConnectedNodes.Add(RoomNode);
-                RoomNode->ConnectedNodes.Add(CorridorNode);
-            }
-        }
-
-        // Connect corridor nodes to other corridor nodes only if they’re not immediately adjacent
-        for (ANavigationNode* OtherCorridorNode : CorridorNodes)
-        {
-            if (CorridorNode != OtherCorridorNode)
-            {
-                float Distance = FVector::Dist(CorridorNode->GetActorLocation(), OtherCorridorNode->GetActorLocation());
-
-                // Only connect if the distance is within range but not too close
-                if (Distance > RoomSize * 0.5f && Distance <= RoomSize)  // Adjust the 0.5f factor as needed
-                {
-                    CorridorNode->ConnectedNodes.Add(OtherCorridorNode);
-                }
-            }
-        }
-    }
+void UPathfindingSubsystem::ConnectDungeonNodes(const TArray<FVector>& Positions, const TArray<ENavigationNodeKind>& Kinds, float RoomSize,
+	TArray<TArray<int32>>& OutAdjacency)
+{
+	// Only the nodes in the cells around each node can be within a room's width of it.
+	FNavigationSpatialHash SpatialHash;
+	SpatialHash.Build(Positions, RoomSize);
+
+	OutAdjacency.Reset();
+	OutAdjacency.SetNum(Positions.Num());
+	const double MinCorridorDistSquared = FMath::Square(RoomSize * 0.5);
+	for (int32 i = 0; i < Positions.Num(); i++)
+	{
+		// Every other node is visited at most once per node, so there are no duplicate connections to filter out.
+		SpatialHash.ForEachInRadius(Positions, Positions[i], RoomSize, [&](int32 OtherIndex)
+		{
+			if (OtherIndex == i) return;
+
+			// Rooms connect to everything in range, but corridors only connect to each other if they're not immediately
+			// adjacent.
+			if (Kinds[i] == ENavigationNodeKind::Corridor && Kinds[OtherIndex] == ENavigationNodeKind::Corridor
+				&& FVector::DistSquared(Positions[i], Positions[OtherIndex]) <= MinCorridorDistSquared)
+			{
+				return;
+			}
+			OutAdjacency[i].Add(OtherIndex);
+		});
+	}
 }
 
-bool UPathfindingSubsystem::IsCorridorNode(ANavigationNode* Node)
+bool UPathfindingSubsystem::IsCorridorNode(const ANavigationNode* Node) const
 {
-	// Determine if a node is part of a corridor based on naming, tag, or another property
-	return Node->GetActorLabel().Contains("Corridor"); // Adjust based on your naming/tagging setup
+	return Node && Node->NodeKind == ENavigationNodeKind::Corridor;
 }
 
-bool UPathfindingSubsystem::IsLocationAboveSolidGround(const FVector& Location) const
+bool UPathfindingSubsystem::IsCorridorNode(int32 NodeIndex) const
 {
-	FVector Start = Location + FVector(0, 0, 100.0f); // Start a bit above the location
-	FVector End = Location - FVector(0, 0, 1000.0f);  // Trace downward
+	return GetNodeKind(NodeIndex) == ENavigationNodeKind::Corridor;
+}
+
+ENavigationNodeKind UPathfindingSubsystem::GetNodeKind(int32 NodeIndex) const
+{
+	if (!bGeneratedNodes)
+	{
+		// Hand placed nodes can be edited between rebuilds so ask the actor.
+		return Nodes.IsValidIndex(NodeIndex) && Nodes[NodeIndex] ? Nodes[NodeIndex]->NodeKind : ENavigationNodeKind::Room;
+	}
+	return NodeData.IsValidIndex(NodeIndex) ? NodeData[NodeIndex].Kind : ENavigationNodeKind::Room;
+}
 
-	FHitResult HitResult;
+bool UPathfindingSubsystem::IsLocationAboveSolidGround(const FVector& Location) const
+{
+	TArray<bool> AboveGround;
+	ProbeGround(MakeArrayView(&Location, 1), AboveGround);
+	return AboveGround[0];
+}
 
-	// Perform the line trace
-	bool bHit = GetWorld()->LineTraceSingleByChannel(
-		HitResult,
-		Start,
-		End,
-		ECC_Visibility 
-	);
+void UPathfindingSubsystem::ProbeGround(TConstArrayView<FVector> Locations, TArray<bool>& OutAboveGround) const
+{
+	OutAboveGround.SetNumUninitialized(Locations.Num());
+	const UWorld* World = GetWorld();
+	if (!World)
+	{
+		FMemory::Memzero(OutAboveGround.GetData(), OutAboveGround.Num() * sizeof(bool));
+		return;
+	}
 
-	// Draw a debug line to visualize the trace
-	DrawDebugLine(GetWorld(), Start, End, bHit ? FColor::Green : FColor::Red, false, 1.0f);
+	// Only whether something was hit matters, so a test trace is enough and skips building the hit result. Scene
+	// queries only read the physics scene, so the workers can trace at the same time while the game thread waits.
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(AGPPathfindingGroundProbe), false);
+	auto ProbeBatch = [World, Locations, &OutAboveGround, &QueryParams](int32 Batch)
+	{
+		const int32 End = FMath::Min((Batch + 1) * GroundProbesPerBatch, Locations.Num());
+		for (int32 i = Batch * GroundProbesPerBatch; i < End; i++)
+		{
+			OutAboveGround[i] = World->LineTraceTestByChannel(Locations[i] + FVector(0.0f, 0.0f, GroundProbeHeight),
+				Locations[i] - FVector(0.0f, 0.0f, GroundProbeDepth), ECC_Visibility, QueryParams);
+		}
+	};
+	const int32 NumBatches = FMath::DivideAndRoundUp(Locations.Num(), GroundProbesPerBatch);
+	ParallelFor(NumBatches, ProbeBatch, CVarPathfindingParallelGroundProbes.GetValueOnGameThread() == 0 || NumBatches <= 1
+		? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
 
-	// Return true if the trace hits something (indicating solid ground)
-	return bHit;
+#if !UE_BUILD_SHIPPING
+	// Debug lines can only be drawn from the game thread, so they are all drawn once the traces are done.
+	if (CVarPathfindingDrawGroundProbes.GetValueOnGameThread())
+	{
+		for (int32 i = 0; i < Locations.Num(); i++)
+		{
+			DrawDebugLine(World, Locations[i] + FVector(0.0f, 0.0f, GroundProbeHeight), Locations[i] - FVector(0.0f, 0.0f, GroundProbeDepth),
+				OutAboveGround[i] ? FColor::Green : FColor::Red, false, 1.0f);
+		}
+	}
+#endif
 }
 
 void UPathfindingSubsystem::AddHidingSpotNode(TArray<AActor*> HidingSpots)
@@ -377,19 +1707,30 @@ void UPathfindingSubsystem::AddHidingSpotNode(TArray<AActor*> HidingSpots)
 	}
 }
 
-void UPathfindingSubsystem::ConnectToOtherNodes(ANavigationNode* HidingNode)
+void UPathfindingSubsystem::ConnectToOtherNodes(const TArray<ANavigationNode*>& NewNodes)
 {
-	//if a node is close to new hiding spot node, add a connection between them
-	for(ANavigationNode* Node : Nodes)
+	TArray<FVector> Positions;
+	Positions.Reserve(Nodes.Num());
+	for (const ANavigationNode* Node : Nodes)
+	{
+		Positions.Add(Node->GetActorLocation());
+	}
+
+	//if a node is close to a new node, add a connection between them
+	constexpr float ConnectionDistance = 250.0f;
+	FNavigationSpatialHash SpatialHash;
+	SpatialHash.Build(Positions, ConnectionDistance);
+	for (ANavigationNode* NewNode : NewNodes)
 	{
-		if(Node != HidingNode)
+		SpatialHash.ForEachInRadius(Positions, NewNode->GetActorLocation(), ConnectionDistance, [this, NewNode](int32 Index)
 		{
-			float distance = FVector::Distance(Node->GetActorLocation(), HidingNode->GetActorLocation());
-			if(distance <= 250.0f)
+			ANavigationNode* Node = Nodes[Index];
+			if (Node != NewNode)
 			{
-				HidingNode->ConnectedNodes.Add(Node);
-				Node->ConnectedNodes.Add(HidingNode);
+				NewNode->ConnectedNodes.AddUnique(Node);
+				Node->ConnectedNodes.AddUnique(NewNode);
 			}
-		}
+		});
 	}
-} 
\ No newline at end of file
+	MarkGraphDirty();
+}
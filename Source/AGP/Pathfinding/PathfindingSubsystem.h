@@ -4,20 +4,62 @@
 
 #include "CoreMinimal.h"
 #include "Subsystems/WorldSubsystem.h"
+#include "Misc/SecureHash.h"
+#include "Components/LineBatchComponent.h"
+#include "DungeonNavigationGrid.h"
+#include "NavigationFlowField.h"
+#include "NavigationGraph.h"
+#include "NavigationGraphVersions.h"
+#include "NavigationIncrementalSearch.h"
+#include "NavigationNode.h"
+#include "NavigationPathCache.h"
+#include "NavigationPathPool.h"
+#include "NavigationPatrolCircuits.h"
+#include "NavigationSearch.h"
+#include "Tasks/Task.h"
 #include "PathfindingSubsystem.generated.h"
 
 class ANavigationNode;
+class FObjectPreSaveContext;
+
+/**
+ * Called on the game thread when an asynchronous path request has been solved. The path is in reverse order, the same
+ * as the synchronous path functions, and is empty if no path could be found.
+ */
+DECLARE_DELEGATE_OneParam(FOnPathRequestComplete, const TArray<FVector>& /*Path*/);
+
+/**
+ * A navigation node that only exists as data in the UPathfindingSubsystem. Generated dungeons and landscapes have
+ * thousands of nodes, so they are kept like this rather than as ANavigationNode actors, which are only used for
+ * placing nodes by hand in the editor.
+ */
+struct FNavigationNodeData
+{
+	FVector Location = FVector::ZeroVector;
+	ENavigationNodeKind Kind = ENavigationNodeKind::Room;
+	// Indices of the nodes that this node connects to.
+	TArray<int32> ConnectedNodes;
+	bool bBlocked = false;
+	// Indices of the connected nodes that can't currently be reached from this node or reach it.
+	TArray<int32> BlockedConnections;
+};
+
 /**
  * 
  */
 UCLASS()
-class AGP_API UPathfindingSubsystem : public UWorldSubsystem
+class AGP_API UPathfindingSubsystem : public UTickableWorldSubsystem
 {
 	GENERATED_BODY()
 
 public:
 
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
 	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickableInEditor() const override;
+	virtual TStatId GetStatId() const override;
 
 	/**
 	 * Will get all of the world positions of the nodes in the navigation system.
@@ -38,13 +80,162 @@ public:
 	 */
 	TArray<FVector> GetPath(const FVector& StartLocation, const FVector& TargetLocation);
 	/**
-	 * Will retrieve a path from the StartLocation, to a position far away from the TargetLocation
+	 * Will retrieve a path from the StartLocation, to the node that is furthest from the TargetLocation by path. Every
+	 * query fleeing the same node of the same graph snapshot shares one escape field, so after the first one a query is
+	 * just a walk along the field.
 	 * @param StartLocation The location that the path will start at.
 	 * @param TargetLocation The location that will be used to determine a position far away from.
 	 * @return An array of vector positions representing the steps along the path, in reverse order.
 	 */
 	TArray<FVector> GetPathAway(const FVector& StartLocation, const FVector& TargetLocation);
 
+	// The same queries written into a path the caller owns. Its allocation is kept, so a caller that holds on to one
+	// array and repaths into it doesn't allocate once the array is big enough for its longest path.
+	/**
+	 * @param OutPath Set to the steps along the path, in reverse order. Empty if there is no path.
+	 * @return true if a path was found.
+	 */
+	bool GetRandomPath(const FVector& StartLocation, TArray<FVector>& OutPath);
+	bool GetPath(const FVector& StartLocation, const FVector& TargetLocation, TArray<FVector>& OutPath);
+	bool GetPathAway(const FVector& StartLocation, const FVector& TargetLocation, TArray<FVector>& OutPath);
+
+	/**
+	 * Stores a copy of the occupancy grid of a newly generated dungeon. While nothing is blocked, paths between two of
+	 * its rooms, synchronous or requested, are walked over the grid instead of searched for on the node graph.
+	 */
+	void SetDungeonGrid(const FDungeonNavigationGrid& InDungeonGrid);
+
+	// Asynchronous path requests. Requests made during a frame are solved together as one batch on worker threads
+	// against the current graph snapshot and the callbacks are run on the game thread in a later tick. Requests are
+	// only processed while the world is ticking.
+	/**
+	 * Asynchronous version of GetRandomPath.
+	 * @param StartLocation The location that the path will start at.
+	 * @param OnComplete Called on the game thread with the path once it has been found.
+	 * @return An id that can be passed to CancelPathRequest.
+	 */
+	uint32 RequestRandomPath(const FVector& StartLocation, FOnPathRequestComplete OnComplete);
+	/**
+	 * Asynchronous version of GetPath.
+	 * @param StartLocation The location that the path will start at.
+	 * @param TargetLocation A location near where the path will end at.
+	 * @param OnComplete Called on the game thread with the path once it has been found.
+	 * @return An id that can be passed to CancelPathRequest.
+	 */
+	uint32 RequestPath(const FVector& StartLocation, const FVector& TargetLocation, FOnPathRequestComplete OnComplete);
+	/**
+	 * Asynchronous version of GetPathAway.
+	 * @param StartLocation The location that the path will start at.
+	 * @param TargetLocation The location that will be used to determine a position far away from.
+	 * @param OnComplete Called on the game thread with the path once it has been found.
+	 * @return An id that can be passed to CancelPathRequest.
+	 */
+	uint32 RequestPathAway(const FVector& StartLocation, const FVector& TargetLocation, FOnPathRequestComplete OnComplete);
+	/**
+	 * Stops the callback of a path request from being called. Does nothing if the request has already completed.
+	 * @param RequestId The id returned when the request was made.
+	 */
+	void CancelPathRequest(uint32 RequestId);
+
+	/**
+	 * Statistics about the asynchronous path requests.
+	 */
+	struct FPathRequestStats
+	{
+		// Requests that have not been started yet.
+		int32 QueuedRequests = 0;
+		// Requests that are being solved, either time sliced or in the worker batch.
+		int32 ActiveRequests = 0;
+		// Nodes expanded by the time sliced searches during the last tick.
+		int32 ExpansionsLastFrame = 0;
+		uint64 CompletedRequests = 0;
+		// Average number of frames between a request being made and its callback being called.
+		double AverageLatencyFrames = 0.0;
+		// Lookups in the path cache, from both the synchronous and asynchronous queries.
+		uint64 PathCacheHits = 0;
+		uint64 PathCacheMisses = 0;
+	};
+	FPathRequestStats GetPathRequestStats() const;
+
+	// Tracked paths. Once tracked, a path is repaired incrementally whenever nodes or connections are blocked or
+	// unblocked, rather than the owner having to search for a new one from scratch.
+	/**
+	 * Starts tracking the path between two locations.
+	 * @param StartLocation The location that the path starts at.
+	 * @param TargetLocation A location near where the path ends at.
+	 * @param OnPathRepaired Called on the game thread with the new path, in reverse order, every time the path has been
+	 * repaired. The path is empty if the target can no longer be reached.
+	 * @return An id for the other tracked path functions.
+	 */
+	uint32 TrackPath(const FVector& StartLocation, const FVector& TargetLocation, FOnPathRequestComplete OnPathRepaired);
+	/**
+	 * Lets a tracked path know that its owner has moved on, so repairs start from the new location.
+	 */
+	void UpdateTrackedPathStart(uint32 TrackedPathId, const FVector& StartLocation);
+	void StopTrackingPath(uint32 TrackedPathId);
+
+	// Flow fields. Agents that are all heading for the same actor, such as enemies chasing a player, share one flow
+	// field for that actor instead of each searching for their own path. The field is rebuilt on a worker thread
+	// whenever the actor moves to a different node, so the cost depends on the size of the graph and not on how many
+	// agents use it. Fields that stop being used are thrown away after a short while.
+	/**
+	 * Gets the next waypoint from a location towards an actor.
+	 * @param Target The actor to head for.
+	 * @param Location Where the agent currently is.
+	 * @param OutWaypoint Set to the next node to move to, or the target's location if the agent is already at the
+	 * target's node.
+	 * @return false if the target can't be reached from the location.
+	 */
+	bool GetFlowFieldWaypoint(const AActor* Target, const FVector& Location, FVector& OutWaypoint);
+	/**
+	 * Will get the flow field towards an actor, building it first if nothing has asked for it recently.
+	 * @return The most recently built flow field for the actor. It is never modified once built so it can be held onto
+	 * safely. Invalid if there is no graph or Target is null.
+	 */
+	FNavigationFlowFieldPtr GetFlowField(const AActor* Target);
+
+	// Patrol circuits. Loops through every part of the graph are built once per graph topology, so a patrolling agent
+	// just steps from one node of its loop to the next instead of searching for a path to a random node every time it
+	// arrives at one.
+	/**
+	 * Puts an agent on a patrol circuit at the node nearest to it. Agents are handed the circuit variants in turn, so
+	 * ones that start next to each other still take different routes.
+	 * @param Location Where the agent currently is.
+	 * @param OutRoute Set to the agent's place on the circuit.
+	 * @param OutWaypoint Set to the location of the node the agent joins the circuit at.
+	 * @return false if AGP.Pathfinding.PatrolCircuits is off or no circuit goes near the location.
+	 */
+	bool StartPatrol(const FVector& Location, FNavigationPatrolRoute& OutRoute, FVector& OutWaypoint);
+	/**
+	 * Moves a route on to the next step of its circuit.
+	 * @param Route The route to advance. Reset if it can't be followed any more.
+	 * @param OutWaypoint Set to the location of the next node on the circuit.
+	 * @return false if the route has ended because the circuits were rebuilt or the connection to the next node has been
+	 * blocked, in which case the agent has to start a new patrol.
+	 */
+	bool AdvancePatrol(FNavigationPatrolRoute& Route, FVector& OutWaypoint);
+
+	/**
+	 * Blocks or unblocks a node so that no path goes through it. This only changes the costs of the node's edges so it
+	 * is much cheaper than editing its connections. Every change made during a frame goes into one new snapshot on the
+	 * next tick, and tracked paths are repaired then.
+	 */
+	void SetNodeBlocked(ANavigationNode* Node, bool bBlocked);
+	/**
+	 * Blocks or unblocks the connection between two nodes in both directions.
+	 */
+	void SetConnectionBlocked(ANavigationNode* NodeA, ANavigationNode* NodeB, bool bBlocked);
+	/**
+	 * Versions of SetNodeBlocked and SetConnectionBlocked that take node indices, for nodes that were generated and so
+	 * have no actor.
+	 */
+	void SetNodeBlocked(int32 NodeIndex, bool bBlocked);
+	void SetConnectionBlocked(int32 NodeIndexA, int32 NodeIndexB, bool bBlocked);
+	/**
+	 * @return The index of the node closest to the location, or INDEX_NONE if there are no nodes.
+	 */
+	int32 FindNearestNodeIndex(const FVector& Location);
+
 	// Procedural Map Logic
 	/**
 	 * Will place down navigation nodes at the vertex positions, excluding the edge vertex positions and
@@ -56,11 +247,25 @@ public:
 	 */
 	void PlaceProceduralNodes(const TArray<FVector>& LandscapeVertexData, int32 MapWidth, int32 MapHeight);
 
-	void UpdatePathfindingNodes(const TArray<FVector>& RoomLocations, int32 MapWidth, int32 MapHeight, float RoomSize);
+	/**
+	 * Will replace all of the nodes with the rooms and corridors of a generated dungeon and connect the nearby ones.
+	 * @param NodeLocations The location of each node.
+	 * @param NodeKinds What each node is, in the same order as NodeLocations.
+	 * @param MapWidth The number of rooms along X.
+	 * @param MapHeight The number of rooms along Y.
+	 * @param RoomSize The distance between neighbouring rooms.
+	 */
+	void UpdatePathfindingNodes(const TArray<FVector>& NodeLocations, const TArray<ENavigationNodeKind>& NodeKinds,
+		int32 MapWidth, int32 MapHeight, float RoomSize);
 
 	//bool NoNearbyAlternative(ANavigationNode* Node, ANavigationNode* NeighborNode, float RoomSize);
 
-	bool IsCorridorNode(ANavigationNode* Node);
+	bool IsCorridorNode(const ANavigationNode* Node) const;
+	bool IsCorridorNode(int32 NodeIndex) const;
+	/**
+	 * @return What the node at the index represents.
+	 */
+	ENavigationNodeKind GetNodeKind(int32 NodeIndex) const;
 
 	/**
 	 * Checks if the location is above solid ground by performing a line trace.
@@ -69,23 +274,349 @@ public:
 	 */
 	bool IsLocationAboveSolidGround(const FVector& Location) const;
 
+	/**
+	 * Checks a batch of locations for solid ground with the same trace as IsLocationAboveSolidGround. The traces only
+	 * test for a hit and are spread over the task graph workers, which is much faster than tracing one at a time for
+	 * large landscapes. Must be called from the game thread while nothing is changing the physics scene.
+	 * @param Locations The locations to check.
+	 * @param OutAboveGround Set to whether each location is above solid ground, in the same order as Locations.
+	 */
+	void ProbeGround(TConstArrayView<FVector> Locations, TArray<bool>& OutAboveGround) const;
+
+	/**
+	 * Flags the graph snapshot as out of date so it will be rebuilt from the node actors before the next query. Called
+	 * when nodes or their connections are edited.
+	 */
+	void MarkGraphDirty();
+
+	/**
+	 * Will get the current compact snapshot of the navigation graph, rebuilding it first if the graph has changed.
+	 * @return The current graph snapshot. This is never modified once built so it can be held onto safely.
+	 */
+	FNavigationGraphPtr GetGraphSnapshot();
+
+	// Worker thread queries. Every snapshot the subsystem builds is also published for other threads, so they can pin
+	// one and search it without locks while the game thread keeps editing the graph. Edits reach them once the game
+	// thread has rebuilt the snapshot, which happens on the next query or tick.
+	/**
+	 * Safe to call from any thread while the subsystem is initialised.
+	 * @return The latest published graph snapshot. Holding on to it keeps it alive, however many newer versions are
+	 * published meanwhile.
+	 */
+	FNavigationGraphPtr PinGraph() const;
+	/**
+	 * A version of GetPath that can be called from any thread. It searches the latest published snapshot and doesn't
+	 * touch the path cache.
+	 * @return true if a path was found.
+	 */
+	bool GetPathOnAnyThread(const FVector& StartLocation, const FVector& TargetLocation, TArray<FVector>& OutPath) const;
+
+	/**
+	 * Writes the current graph to the level's baked graph file, along with a hash of the nodes it was built from. The
+	 * next time the level starts with the same nodes its graph is loaded in one read instead of built. Levels are baked
+	 * whenever they are saved in the editor.
+	 * @return true if the file was written.
+	 */
+	bool SaveBakedGraph();
+	/**
+	 * @return Where the baked graph of a level is kept. The folder is staged with the cooked game.
+	 */
+	static FString GetBakedGraphPath(const UWorld& World);
+	/**
+	 * Works out the connections between the nodes of a generated dungeon. Rooms connect to every node within RoomSize
+	 * and corridors connect to other corridors between half and one RoomSize away. Needs no world, so tests can connect
+	 * a layout the same way the subsystem does.
+	 * @param Positions The location of each node.
+	 * @param Kinds What each node represents.
+	 * @param RoomSize The size of a dungeon room.
+	 * @param OutAdjacency Filled with the indices of the nodes that each node connects to.
+	 */
+	static void ConnectDungeonNodes(const TArray<FVector>& Positions, const TArray<ENavigationNodeKind>& Kinds, float RoomSize,
+		TArray<TArray<int32>>& OutAdjacency);
+
 protected:
 	
+	// Nodes placed by hand in the level. Empty once nodes have been generated.
+	UPROPERTY()
 	TArray<ANavigationNode*> Nodes;
 
-	// Procedural Map Logic
-	TArray<ANavigationNode*> ProcedurallyPlacedNodes;
-
 private:
 
+	// The nodes that the graph is built from. Gathered from the Nodes actors before every rebuild unless they were
+	// generated, in which case there are no actors behind them and this is the only copy.
+	TArray<FNavigationNodeData> NodeData;
+	bool bGeneratedNodes = false;
+
+	// The snapshot that all queries run against, built from NodeData. Only read and written on the game thread.
+	FNavigationGraphPtr Graph;
+	// Every snapshot assigned to Graph, published for the worker thread queries.
+	FNavigationGraphVersions GraphVersions;
+	// Bumped every time the graph changes. The next snapshot is stamped with it, which also invalidates the path cache.
+	uint32 GraphVersion = 0;
+	bool bGraphDirty = true;
+	// The room size of the last generated dungeon, which sets the size of the hierarchy's clusters. 0 if the nodes
+	// were not placed by a dungeon generator, in which case no hierarchy is built.
+	float DungeonRoomSize = 0.0f;
+	// Set on begin play and cleared by the first rebuild with any nodes, which tries the bake before building.
+	bool bLoadBakedGraph = false;
+	// The room and corridor grid of the last generated dungeon. Empty when the nodes were not placed by a generator.
+	FDungeonNavigationGrid DungeonGrid;
+
+	// Recently found paths between pairs of nodes, shared by the synchronous and asynchronous queries.
+	FNavigationPathCache PathCache;
+
+	// A* working memory for the synchronous queries made on the game thread.
+	FNavigationSearchScratch SearchScratch;
+
+	// Buffers for the paths handed to request callbacks, which are only borrowed for the length of the callback.
+	FNavigationPathPool PathPool;
+
+	enum class EPathRequestType : uint8
+	{
+		Path,
+		Random,
+		Away
+	};
+
+	struct FPathRequest
+	{
+		uint32 Id;
+		EPathRequestType Type;
+		FVector StartLocation;
+		FVector TargetLocation;
+		FOnPathRequestComplete OnComplete;
+		// The frame the request was made on, used for the latency stats.
+		uint64 RequestFrame = 0;
+		// The nodes and graph version the request was resolved to when it was started.
+		int32 StartIndex = INDEX_NONE;
+		int32 EndIndex = INDEX_NONE;
+		uint32 GraphVersion = 0;
+	};
+
+	// Requests waiting for the next batch to be dispatched.
+	TArray<FPathRequest> QueuedRequests;
+	// Requests in the batch that is currently being solved, in the same order as the batch task's results.
+	TArray<FPathRequest> InFlightRequests;
+	// The requests of the batch whose callbacks are being run, kept so the array doesn't have to be allocated again.
+	TArray<FPathRequest> DeliveringRequests;
+
+	// The endpoints and paths of a batch. It is moved into the task and back out again, so its arrays, and every path
+	// in it, keep their memory from one batch to the next.
+	struct FPathBatch
+	{
+		TArray<TPair<int32, int32>> Endpoints;
+		// Never shrinks, only the first Endpoints.Num() paths belong to the current batch.
+		TArray<TArray<FVector>> Paths;
+	};
+	FPathBatch PathBatch;
+	UE::Tasks::TTask<FPathBatch> InFlightBatch;
+
+	// Requests that finished without a search, or whose search finished this frame, waiting for their callbacks. The
+	// paths come from PathPool and go back to it once the callbacks have run.
+	TArray<TPair<FPathRequest, TArray<FVector>>> FinishedRequests;
+	uint32 NextRequestId = 1;
+
+	uint32 QueuePathRequest(EPathRequestType Type, const FVector& StartLocation, const FVector& TargetLocation, FOnPathRequestComplete&& OnComplete);
+	/**
+	 * Resolves the start and end nodes of every queued request on the game thread, then launches a task that solves
+	 * all of them in parallel against the current graph snapshot.
+	 */
+	void DispatchPathRequests();
+	/**
+	 * Runs the callbacks of the batch that has just finished.
+	 */
+	void DeliverPathResults();
+
+	/**
+	 * Where to flee to from one threat node and the way there from anywhere, shared by every query fleeing that node.
+	 */
+	struct FEscapeField
+	{
+		// The node with the longest path to the threat.
+		int32 EscapeIndex = INDEX_NONE;
+		// Leads from every node to the escape node.
+		FNavigationFlowFieldPtr Field;
+		uint64 LastUsedFrame = 0;
+	};
+	// Keyed by the threat's node. Every field belongs to the graph version EscapeFieldsVersion.
+	TMap<int32, FEscapeField> EscapeFields;
+	uint32 EscapeFieldsVersion = 0;
+
+	/**
+	 * Will get the escape field from a threat node, building it if nothing has fled that node in this snapshot yet.
+	 * Building it takes two Dijkstra searches over the whole graph, one to the threat to find the escape node and one to
+	 * the escape node.
+	 * @return The escape field, or nullptr if AGP.Pathfinding.EscapeFields is off or the threat node isn't valid. Only
+	 * valid until the next call.
+	 */
+	const FEscapeField* GetEscapeField(const FNavigationGraphPtr& NavGraph, int32 ThreatIndex);
+	/**
+	 * Answers a request from the escape fields, the dungeon grid or the path cache, without a search.
+	 * @return true if the request was moved to FinishedRequests.
+	 */
+	bool TryFinishRequestWithoutSearch(const FNavigationGraphPtr& NavGraph, FPathRequest& Request);
+
+	// The patrol circuits of the topology PatrolCircuitsTopologyVersion. PatrolCircuitsVersion is bumped every time
+	// they are built so routes on older circuits can tell.
+	FNavigationPatrolCircuits PatrolCircuits;
+	uint32 PatrolCircuitsTopologyVersion = 0;
+	uint32 PatrolCircuitsVersion = 0;
+	// The variant handed to the next agent that starts patrolling.
+	int32 NextPatrolVariant = 0;
+
+	/**
+	 * Builds the patrol circuits over the snapshot if they were built for another topology or variant count.
+	 */
+	void UpdatePatrolCircuits(const FNavigationGraph& NavGraph);
+
+	// Time sliced searches run on the game thread when AGP.Pathfinding.TimeSliceBudgetUs is above zero. Each one keeps
+	// its open set between frames.
+	struct FActiveSearch
+	{
+		FPathRequest Request;
+		TUniquePtr<FNavigationSearchQuery> Query;
+	};
+	TArray<FActiveSearch> ActiveSearches;
+	// Finished queries are kept so their scratch memory can be reused by the next search.
+	TArray<TUniquePtr<FNavigationSearchQuery>> FreeQueries;
+	// Which active search gets the next slice, so the budget is shared round robin across frames.
+	int32 NextSliceIndex = 0;
+
+	struct FTrackedPath
+	{
+		FVector StartLocation;
+		FVector TargetLocation;
+		FOnPathRequestComplete OnPathRepaired;
+		// Only created the first time the path needs repairing, so paths that are never affected by an edit cost nothing.
+		TUniquePtr<FNavigationIncrementalSearch> Search;
+	};
+	TMap<uint32, FTrackedPath> TrackedPaths;
+	uint32 NextTrackedPathId = 1;
+	// Nodes whose blocked state has changed since the last snapshot was published.
+	TArray<int32> PendingCostNodes;
+	// Edges whose costs have changed since the tracked paths were last repaired.
+	TArray<int32> PendingEdgeChanges;
+	// Set when the graph has been rebuilt from the node actors, which changes the edge indices, so every tracked path
+	// has to be searched again from scratch.
+	bool bTrackedPathsStale = false;
+
+	/**
+	 * Brings every tracked path up to date with the edge changes made since the last tick and runs their callbacks.
+	 */
+	void RepairTrackedPaths();
+	/**
+	 * Queues the nodes for ApplyPendingEdgeCosts, so a door that touches several nodes only costs one new snapshot.
+	 */
+	void UpdateEdgeCosts(TConstArrayView<int32> ChangedNodes);
+	/**
+	 * Recalculates the costs of every edge into or out of the queued nodes and publishes one snapshot with the new
+	 * costs. Called once a tick, before the tracked paths are repaired.
+	 */
+	void ApplyPendingEdgeCosts();
+	bool IsConnectionBlocked(int32 FromIndex, int32 ToIndex) const;
+
+	struct FFlowFieldEntry
+	{
+		// The field that agents are reading from.
+		FNavigationFlowFieldPtr Current;
+		// A newer field being built on a worker thread, which replaces Current once it is done.
+		UE::Tasks::TTask<FNavigationFlowFieldPtr> Pending;
+		uint64 LastUsedFrame = 0;
+	};
+	TMap<TWeakObjectPtr<const AActor>, FFlowFieldEntry> FlowFields;
+
+	/**
+	 * Swaps in the flow fields that have finished building, starts rebuilds for targets that have moved to another node
+	 * or whose graph is out of date, and drops fields that are no longer used.
+	 */
+	void UpdateFlowFields();
+
+	int32 ExpansionsLastFrame = 0;
+	uint64 CompletedRequests = 0;
+	uint64 TotalLatencyFrames = 0;
+
+	/**
+	 * Starts searches for queued requests and then advances the active searches a slice at a time until they have all
+	 * finished or the budget has been used up.
+	 * @param BudgetSeconds How long to spend searching this frame.
+	 */
+	void TickTimeSlicedSearches(double BudgetSeconds);
+	/**
+	 * Picks the start and end nodes of the request in the given snapshot.
+	 */
+	void ResolveRequestEndpoints(const FNavigationGraph& NavGraph, FPathRequest& Request) const;
+	void CompleteRequest(const FPathRequest& Request, const TArray<FVector>& Path);
+	/**
+	 * Runs the callbacks of FinishedRequests and gives their paths back to the pool.
+	 */
+	void CompleteFinishedRequests();
+
+	/**
+	 * Assigns every node in the Nodes array its dense NodeIndex. Needs to be called whenever the Nodes array changes.
+	 */
+	void RebuildNodeIndices();
+	/**
+	 * Copies the locations, connections and blocked flags of the Nodes actors into NodeData.
+	 */
+	void GatherNodeData();
+	/**
+	 * Builds a new graph snapshot from NodeData, gathering it from the Nodes actors first if they were placed by hand.
+	 */
+	void RebuildGraph();
+	FNavigationGraphBuildSettings GetBuildSettings(int32 NumNodes, float RoomSize) const;
+	/**
+	 * Loads the level's baked graph, if it has one that was baked by this version of the game from the nodes now in
+	 * NodeData.
+	 * @return The loaded snapshot, stamped with the current graph version, or nullptr if there is no matching bake.
+	 */
+	FNavigationGraphPtr LoadBakedGraph(const FNavigationGraphBuildSettings& Settings) const;
+	/**
+	 * @return A hash of everything in NodeData and the dungeon room size, which the baked graph is checked against.
+	 */
+	FSHAHash HashNodeData() const;
+#if WITH_EDITOR
+	/**
+	 * Bakes the graph when the editor level is saved.
+	 */
+	void OnObjectPreSave(UObject* Object, FObjectPreSaveContext SaveContext);
+#endif
+
+#if !UE_BUILD_SHIPPING
+	// The graph snapshot as debug lines, kept so they only need to be remade when the snapshot changes.
+	TArray<FBatchedLine> DebugLines;
+	TArray<FBatchedPoint> DebugPoints;
+	uint32 DebugLinesVersion = 0;
+
+	/**
+	 * Draws every node and connection of the graph snapshot through the world's line batcher in one go, when
+	 * AGP.Pathfinding.DrawGraph is on.
+	 */
+	void DrawGraph();
+#endif
+
 	void PopulateNodes();
 	void RemoveAllNodes();
-	ANavigationNode* GetRandomNode();
-	ANavigationNode* FindNearestNode(const FVector& TargetLocation);
-	ANavigationNode* FindFurthestNode(const FVector& TargetLocation);
-	TArray<FVector> GetPath(ANavigationNode* StartNode, ANavigationNode* EndNode);
-	static TArray<FVector> ReconstructPath(const TMap<ANavigationNode*, ANavigationNode*>& CameFromMap, ANavigationNode* EndNode);
+	int32 GetRandomNode(const FNavigationGraph& NavGraph) const;
+	int32 FindNearestNode(const FNavigationGraph& NavGraph, const FVector& TargetLocation) const;
+	int32 FindFurthestNode(const FNavigationGraph& NavGraph, const FVector& TargetLocation) const;
+	TArray<FVector> GetPath(const FNavigationGraph& NavGraph, int32 StartIndex, int32 EndIndex);
+	bool GetPath(const FNavigationGraph& NavGraph, int32 StartIndex, int32 EndIndex, TArray<FVector>& OutPath);
+	/**
+	 * Walks from one room node to another over the dungeon grid, when AGP.Pathfinding.DungeonGridPaths is on. The walk
+	 * is the one with the fewest cells and goes through the centres of corridors rather than their end nodes.
+	 * @param OutPath Set to the centres of the cells along the walk, in reverse order.
+	 * @return false if either node isn't a room of the grid, anything in the snapshot is blocked or there is no walk, in
+	 * which case the node graph has to be searched instead.
+	 */
+	bool FindDungeonGridPath(const FNavigationGraph& NavGraph, int32 StartIndex, int32 EndIndex, TArray<FVector>& OutPath) const;
+
+#if !UE_BUILD_SHIPPING
+	friend class FPathfindingBenchmark;
+#endif
 
 	void AddHidingSpotNode(TArray<AActor*> HidingSpots);
-	void ConnectToOtherNodes(ANavigationNode* HidingNode);
+	/**
+	 * Connects each of the new nodes to every node in the Nodes array within 250 units of it, in both directions.
+	 */
+	void ConnectToOtherNodes(const TArray<ANavigationNode*>& NewNodes);
 };
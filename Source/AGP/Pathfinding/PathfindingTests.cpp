@@ -0,0 +1,278 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Misc/AutomationTest.h"
+#include "NavigationGraph.h"
+#include "NavigationIncrementalSearch.h"
+#include "NavigationSearch.h"
+#include "PathfindingHeap.h"
+#include "PathfindingSubsystem.h"
+#include "AGP/Landscape/DungeonGenerator.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	constexpr float TestRoomSize = 500.0f;
+
+	/**
+	 * Plain Dijkstra over the snapshot's edges, with no heuristic and none of its acceleration structures, as the
+	 * reference the searches are checked against.
+	 * @param OutDistances Set to the length of the shortest path from the start to each node, UE_MAX_FLT if there is none.
+	 */
+	void GetShortestDistances(const FNavigationGraph& Graph, int32 StartIndex, TArray<float>& OutDistances)
+	{
+		FIndexedMinHeap OpenSet;
+		OpenSet.Reset(Graph.Num());
+		OutDistances.Init(UE_MAX_FLT, Graph.Num());
+		OutDistances[StartIndex] = 0.0f;
+		OpenSet.PushOrDecrease(StartIndex, 0.0f);
+		while (!OpenSet.IsEmpty())
+		{
+			const int32 CurrentIndex = OpenSet.Pop();
+			for (int32 Edge = Graph.GetNeighbourBegin(CurrentIndex); Edge < Graph.GetNeighbourEnd(CurrentIndex); Edge++)
+			{
+				if (Graph.IsEdgeBlocked(Edge)) continue;
+				const int32 ConnectedIndex = Graph.Neighbours[Edge];
+				const float TentativeDistance = OutDistances[CurrentIndex] + Graph.EdgeCosts[Edge];
+				if (TentativeDistance < OutDistances[ConnectedIndex])
+				{
+					OutDistances[ConnectedIndex] = TentativeDistance;
+					OpenSet.PushOrDecrease(ConnectedIndex, TentativeDistance);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Lays out a small dungeon with a fixed seed the same way ADungeonGenerator does and connects it the same way the
+	 * subsystem does.
+	 */
+	void MakeTestDungeon(TArray<FVector>& OutPositions, TArray<TArray<int32>>& OutAdjacency)
+	{
+		constexpr int32 GridSize = 12;
+		constexpr int32 RandomSeed = 1234;
+
+		TArray<TSubclassOf<AActor>> RoomTypes;
+		RoomTypes.Init(AActor::StaticClass(), 4);
+		FDungeonLayout Layout;
+		ADungeonGenerator::MakeLayout(GridSize, GridSize, TestRoomSize, RoomTypes, RandomSeed, Layout);
+		UPathfindingSubsystem::ConnectDungeonNodes(Layout.NodeLocations, Layout.NodeKinds, TestRoomSize, OutAdjacency);
+		OutPositions = MoveTemp(Layout.NodeLocations);
+	}
+
+	/**
+	 * Checks a path found between two nodes against the Dijkstra distance between them.
+	 * @param bFound Whether the search said it found a path.
+	 * @param Path The path, in reverse order.
+	 * @param ShortestDistance The Dijkstra distance, UE_MAX_FLT if there is no path.
+	 * @return What is wrong with the path, or an empty string if nothing is.
+	 */
+	FString CheckPath(const FNavigationGraph& Graph, int32 StartIndex, int32 EndIndex, bool bFound, const TArray<FVector>& Path,
+		float ShortestDistance)
+	{
+		if (bFound != (ShortestDistance < UE_MAX_FLT))
+		{
+			return bFound ? TEXT("found a path where there is none") : TEXT("found no path where there is one");
+		}
+		if (!bFound)
+		{
+			return FString();
+		}
+
+		// Paths are in reverse order, so they run from the end node back to the start node.
+		float Length = 0.0f;
+		bool bConnected = !Path.IsEmpty() && Path[0] == Graph.Positions[EndIndex] && Path.Last() == Graph.Positions[StartIndex];
+		for (int32 i = 1; i < Path.Num(); i++)
+		{
+			const int32 Edge = Graph.FindEdge(Graph.FindNearestNode(Path[i]), Graph.FindNearestNode(Path[i - 1]));
+			bConnected &= Edge != INDEX_NONE && !Graph.IsEdgeBlocked(Edge);
+			Length += FVector::Distance(Path[i - 1], Path[i]);
+		}
+		if (!bConnected)
+		{
+			return TEXT("found a path that doesn't follow the graph's unblocked edges");
+		}
+		if (Length > ShortestDistance + 1.0f)
+		{
+			return FString::Printf(TEXT("found a path %.1f long where the shortest is %.1f"), Length, ShortestDistance);
+		}
+		return FString();
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPathfindingShortestDungeonPathsTest, "AGP.Pathfinding.ShortestDungeonPaths",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+/**
+ * Lays out a small dungeon with a fixed seed the same way ADungeonGenerator does, connects it the same way the
+ * subsystem does, and searches between every pair of nodes with each of the graph's acceleration structures. Fails if
+ * any path is longer than the Dijkstra result, walks between nodes that aren't connected, or if a search disagrees with
+ * Dijkstra about whether there is a path at all. Needs no world, so it runs headless, for example with
+ * -nullrhi -ExecCmds="Automation RunTests AGP.Pathfinding;Quit".
+ */
+bool FPathfindingShortestDungeonPathsTest::RunTest(const FString& Parameters)
+{
+	TArray<FVector> Positions;
+	TArray<TArray<int32>> Adjacency;
+	MakeTestDungeon(Positions, Adjacency);
+	if (!TestTrue(TEXT("The dungeon has more than one node"), Positions.Num() > 1))
+	{
+		return false;
+	}
+
+	FNavigationGraphBuildSettings RoutingTableSettings;
+	RoutingTableSettings.RoutingTableMaxNodes = MAX_int32;
+	FNavigationGraphBuildSettings HierarchySettings;
+	HierarchySettings.HierarchyClusterSize = TestRoomSize * 2;
+	FNavigationGraphBuildSettings LandmarkSettings;
+	LandmarkSettings.NumLandmarks = 4;
+	const TPair<const TCHAR*, FNavigationGraphBuildSettings> Variants[] = {
+		{ TEXT("A*"), FNavigationGraphBuildSettings() },
+		{ TEXT("Routing table"), RoutingTableSettings },
+		{ TEXT("Hierarchy"), HierarchySettings },
+		{ TEXT("Landmarks"), LandmarkSettings },
+	};
+
+	FNavigationSearchScratch Scratch;
+	TArray<FVector> Path;
+	TArray<float> Distances;
+	for (const TPair<const TCHAR*, FNavigationGraphBuildSettings>& Variant : Variants)
+	{
+		const FNavigationGraphPtr NavGraph = FNavigationGraph::Build(Positions, Adjacency, 1, Variant.Value);
+		int32 NumFailures = 0;
+		for (int32 StartIndex = 0; StartIndex < NavGraph->Num(); StartIndex++)
+		{
+			GetShortestDistances(*NavGraph, StartIndex, Distances);
+			for (int32 EndIndex = 0; EndIndex < NavGraph->Num(); EndIndex++)
+			{
+				const bool bFound = FNavigationSearch::FindPath(*NavGraph, StartIndex, EndIndex, Scratch, Path);
+				const FString Failure = CheckPath(*NavGraph, StartIndex, EndIndex, bFound, Path, Distances[EndIndex]);
+
+				// Only the first few failures are worth reading.
+				if (!Failure.IsEmpty() && NumFailures++ < 10)
+				{
+					AddError(FString::Printf(TEXT("%s: from node %d to node %d %s"), Variant.Key, StartIndex, EndIndex, *Failure));
+				}
+			}
+		}
+		if (NumFailures > 10)
+		{
+			AddError(FString::Printf(TEXT("%s: %d more paths failed"), Variant.Key, NumFailures - 10));
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPathfindingRepairedDungeonPathsTest, "AGP.Pathfinding.RepairedDungeonPaths",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+/**
+ * Follows D* Lite paths across the same dungeon while nodes ahead are blocked and unblocked, repairing them the way the
+ * subsystem repairs tracked paths: the start is moved and then the edge changes are applied. The start sometimes
+ * steps off the path, as an agent that has been pushed aside would. Fails if any repaired path is longer than the
+ * Dijkstra result on the new snapshot, uses a blocked edge, or disagrees with Dijkstra about whether there is a path.
+ */
+bool FPathfindingRepairedDungeonPathsTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumQueries = 100;
+	constexpr int32 RepairsPerQuery = 8;
+
+	TArray<FVector> Positions;
+	TArray<TArray<int32>> Adjacency;
+	MakeTestDungeon(Positions, Adjacency);
+	if (!TestTrue(TEXT("The dungeon has more than one node"), Positions.Num() > 1))
+	{
+		return false;
+	}
+	const FNavigationGraphPtr BaseGraph = FNavigationGraph::Build(Positions, Adjacency, 1);
+
+	// Blocking a node sets the cost of every edge into or out of it, and unblocking it puts their lengths back.
+	auto SetNodeBlocked = [](const FNavigationGraph& Graph, int32 Node, bool bBlocked, TArray<TPair<int32, float>>& OutCostChanges)
+	{
+		auto AddChange = [&Graph, bBlocked, &OutCostChanges](int32 Edge)
+		{
+			OutCostChanges.Emplace(Edge, bBlocked ? FNavigationGraph::BlockedCost
+				: FVector::Distance(Graph.Positions[Graph.GetEdgeSource(Edge)], Graph.Positions[Graph.Neighbours[Edge]]));
+		};
+		for (int32 Edge = Graph.GetNeighbourBegin(Node); Edge < Graph.GetNeighbourEnd(Node); Edge++)
+		{
+			AddChange(Edge);
+		}
+		for (int32 i = Graph.ReverseOffsets[Node]; i < Graph.ReverseOffsets[Node + 1]; i++)
+		{
+			AddChange(Graph.ReverseEdges[i]);
+		}
+	};
+
+	FRandomStream Random(1234);
+	FNavigationIncrementalSearch Search;
+	TArray<FVector> Path;
+	TArray<float> Distances;
+	uint32 Version = 1;
+	int32 NumRepairs = 0;
+	int32 NumFailures = 0;
+	for (int32 Query = 0; Query < NumQueries; Query++)
+	{
+		FNavigationGraphPtr NavGraph = BaseGraph;
+		const int32 GoalIndex = Random.RandRange(0, NavGraph->Num() - 1);
+		if (!Search.Start(NavGraph, Random.RandRange(0, NavGraph->Num() - 1), GoalIndex)) continue;
+
+		TArray<int32> BlockedNodes;
+		for (int32 Repair = 0; Repair < RepairsPerQuery; Repair++)
+		{
+			// Paths run from the goal back to the start, so the start is the last node and the agent walks backwards
+			// through the array.
+			Search.GetPath(Path);
+			if (Path.Num() < 3) break;
+			const int32 Steps = Random.RandRange(1, FMath::Min(2, Path.Num() - 2));
+			int32 StartIndex = NavGraph->FindNearestNode(Path[Path.Num() - 1 - Steps]);
+			const int32 NeighbourBegin = NavGraph->GetNeighbourBegin(StartIndex);
+			const int32 NeighbourEnd = NavGraph->GetNeighbourEnd(StartIndex);
+			if (Random.RandRange(0, 2) == 0 && NeighbourBegin < NeighbourEnd)
+			{
+				StartIndex = NavGraph->Neighbours[Random.RandRange(NeighbourBegin, NeighbourEnd - 1)];
+			}
+
+			// Block a node between the new start and the goal, and every so often reopen the oldest blocked one.
+			TArray<TPair<int32, float>> CostChanges;
+			if (Path.Num() - 2 - Steps >= 1)
+			{
+				const int32 BlockedNode = NavGraph->FindNearestNode(Path[Random.RandRange(1, Path.Num() - 2 - Steps)]);
+				SetNodeBlocked(*NavGraph, BlockedNode, true, CostChanges);
+				BlockedNodes.Add(BlockedNode);
+			}
+			if (Repair % 3 == 2 && !BlockedNodes.IsEmpty())
+			{
+				SetNodeBlocked(*NavGraph, BlockedNodes[0], false, CostChanges);
+				BlockedNodes.RemoveAt(0);
+			}
+			TArray<int32> ChangedEdges;
+			for (const TPair<int32, float>& Change : CostChanges)
+			{
+				ChangedEdges.Add(Change.Key);
+			}
+			NavGraph = FNavigationGraph::WithEdgeCosts(*NavGraph, CostChanges, ++Version);
+
+			Search.MoveStart(StartIndex);
+			Search.ApplyEdgeChanges(NavGraph, ChangedEdges);
+			const bool bFound = Search.GetPath(Path);
+			NumRepairs++;
+
+			GetShortestDistances(*NavGraph, StartIndex, Distances);
+			const FString Failure = CheckPath(*NavGraph, StartIndex, GoalIndex, bFound, Path, Distances[GoalIndex]);
+			if (!Failure.IsEmpty() && NumFailures++ < 10)
+			{
+				AddError(FString::Printf(TEXT("Query %d, repair %d: from node %d to node %d %s"), Query, Repair, StartIndex,
+					GoalIndex, *Failure));
+			}
+		}
+	}
+	if (NumFailures > 10)
+	{
+		AddError(FString::Printf(TEXT("%d more repaired paths failed"), NumFailures - 10));
+	}
+	TestTrue(TEXT("Some paths were repaired"), NumRepairs > 0);
+	return true;
+}
+
+#endif